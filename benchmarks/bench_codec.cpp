@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <string>
+#include <vector>
+#include "telemetry_codec.hpp"
+#include "bench_harness.hpp"
+
+namespace {
+
+// one block of 1 kHz ticks: 4 motors driven forward at pwm 60 with software
+// pwm, encoder edges every other tick, a mode change half way
+std::vector<FlightRecord> makeRecords()
+{
+    std::vector<FlightRecord> records;
+    uint64_t time = 1000000;
+    for (int32_t i = 0; i < k_telemetryBlockRecords; i++) {
+        FlightRecord rec {};
+        rec.seq = i + 1;
+        time += 1000 + (i % 7) - 3;
+        rec.timestamp = time;
+        rec.ctrlMode = (i < k_telemetryBlockRecords / 2) ? 0 : 2;
+        rec.motorNum = 4;
+        for (int32_t m = 0; m < k_flightRecMotors; m++) {
+            auto& motor = rec.motor[m];
+            motor.runState = 1;
+            motor.pwmCount = static_cast<uint8_t>(i % 20);
+            motor.nowState = (motor.pwmCount < 12) ? 1 : 0;
+            motor.runPwm = 60;
+            motor.encoder = static_cast<uint32_t>(i / 2 + m);
+            motor.actualSteps = i / 2;
+        }
+        rec.checksum = flightRecChecksum(rec);
+        records.push_back(rec);
+    }
+    return records;
+}
+
+void reportRate(BenchRunner& runner, const std::string& name, size_t encodedBytes)
+{
+    auto& results = runner.getResults();
+    if (results.empty() || (results.back().name != name)) {
+        return;
+    }
+    const double rawBytes = (double)k_telemetryBlockRecords * sizeof(FlightRecord);
+    std::printf("%-40s %12.1f MB/s of records, %.1f bytes/record (raw %zu)\n", name.c_str(),
+                rawBytes * 1000 / results.back().nsPerOp, (double)encodedBytes / k_telemetryBlockRecords,
+                sizeof(FlightRecord));
+}
+
+}  // namespace
+
+void benchCodec(BenchRunner& runner)
+{
+    const auto records = makeRecords();
+    std::string block;
+    TelemetryCodec::encode(records, block);
+
+    runner.run("codec/encode_block", [&]() {
+        std::string out;
+        out.reserve(block.size());
+        benchKeep(TelemetryCodec::encode(records, out));
+    }, 10, 100);
+    reportRate(runner, "codec/encode_block", block.size());
+
+    std::vector<FlightRecord> decoded;
+    decoded.reserve(records.size());
+    runner.run("codec/decode_block", [&]() {
+        decoded.clear();
+        benchKeep(TelemetryCodec::decode(block, decoded));
+    }, 10, 100);
+    reportRate(runner, "codec/decode_block", block.size());
+}
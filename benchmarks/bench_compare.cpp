@@ -0,0 +1,77 @@
+// SPDX-License-Identifier: GPL-2.0
+// compare two carbench result files by median time per op.
+//   bench_compare base.json new.json [threshold%]
+// exit 1 when any benchmark is slower than threshold (default 10%).
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <string>
+#include <nlohmann/json.hpp>
+
+namespace {
+
+bool load_result(const char* fileName, std::map<std::string, double>& result)
+{
+    std::ifstream file(fileName);
+    if (!file.is_open()) {
+        std::fprintf(stderr, "[bench_compare] fail to open %s\n", fileName);
+        return false;
+    }
+
+    auto root = nlohmann::json::parse(file, nullptr, false);
+    if (root.is_discarded() || !root.contains("benchmarks")) {
+        std::fprintf(stderr, "[bench_compare] %s is not a carbench result\n", fileName);
+        return false;
+    }
+
+    for (const auto& item : root["benchmarks"]) {
+        result[item.value("name", "")] = item.value("p50_ns", 0.0);
+    }
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        std::fprintf(stderr, "usage: %s base.json new.json [threshold%%]\n", argv[0]);
+        return 2;
+    }
+
+    const double threshold = (argc > 3) ? std::atof(argv[3]) : 10.0;
+    std::map<std::string, double> base, current;
+    if (!load_result(argv[1], base) || !load_result(argv[2], current)) {
+        return 2;
+    }
+
+    int32_t regression = 0;
+    std::printf("%-40s %12s %12s %9s\n", "benchmark", "base ns", "new ns", "change");
+    for (const auto& [name, value] : current) {
+        auto it = base.find(name);
+        if (it == base.end() || it->second <= 0) {
+            std::printf("%-40s %12s %12.1f %9s\n", name.c_str(), "-", value, "new");
+            continue;
+        }
+
+        const double change = (value - it->second) * 100.0 / it->second;
+        const char* flag = "";
+        if (change > threshold) {
+            flag = "  REGRESSION";
+            regression++;
+        } else if (change < -threshold) {
+            flag = "  improved";
+        }
+        std::printf("%-40s %12.1f %12.1f %+8.1f%%%s\n", name.c_str(), it->second, value, change, flag);
+    }
+    for (const auto& [name, value] : base) {
+        if (current.find(name) == current.end()) {
+            std::printf("%-40s %12.1f %12s %9s\n", name.c_str(), value, "-", "removed");
+        }
+    }
+
+    std::printf("%d regression(s) over %.1f%%\n", regression, threshold);
+    return regression ? 1 : 0;
+}
@@ -0,0 +1,233 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <filesystem>
+#include <fstream>
+#include <stdlib.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+#include "car_ctrl.hpp"
+#include "bench_harness.hpp"
+
+namespace {
+
+// gpio and pwm sysfs tree on tmpfs: export/unexport, gpioN/{direction,value,edge}
+// and pwmchipN/pwmM/{period,duty_cycle,enable} files
+class FakeSysfs
+{
+public:
+    FakeSysfs()
+    {
+        char name[] = "/dev/shm/carbench.XXXXXX";
+        char nameTmp[] = "/tmp/carbench.XXXXXX";
+        const char* dir = mkdtemp(name);
+        m_root = dir ? dir : mkdtemp(nameTmp);
+        touch(m_root / "export");
+        touch(m_root / "unexport");
+        Gpio::setSysfsRoot(m_root.string());
+        PwmChannel::setSysfsRoot(m_root.string());
+    }
+
+    ~FakeSysfs()
+    {
+        if (m_watchFd >= 0) {
+            close(m_watchFd);
+        }
+        Gpio::setSysfsRoot("/sys/class/gpio");
+        PwmChannel::setSysfsRoot("/sys/class/pwm");
+        std::error_code ec;
+        std::filesystem::remove_all(m_root, ec);
+    }
+
+    void addPin(int32_t pin)
+    {
+        auto dir = m_root / ("gpio" + std::to_string(pin));
+        std::filesystem::create_directories(dir);
+        touch(dir / "direction");
+        touch(dir / "value");
+        touch(dir / "edge");
+    }
+
+    void addPwm(int32_t chip, int32_t channel)
+    {
+        auto chipDir = m_root / ("pwmchip" + std::to_string(chip));
+        auto dir = chipDir / ("pwm" + std::to_string(channel));
+        std::filesystem::create_directories(dir);
+        touch(chipDir / "export");
+        touch(chipDir / "unexport");
+        touch(dir / "period");
+        touch(dir / "duty_cycle");
+        touch(dir / "enable");
+    }
+
+    // log writes to the attributes of a channel, in order
+    bool watchPwm(int32_t chip, int32_t channel)
+    {
+        m_watchFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        return (m_watchFd >= 0) && (inotify_add_watch(m_watchFd, pwmDir(chip, channel).c_str(), IN_MODIFY) >= 0);
+    }
+
+    // attributes written since the last call
+    std::vector<std::string> takeWrites()
+    {
+        std::vector<std::string> writes;
+        alignas(inotify_event) char buffer[4096];
+        ssize_t len;
+        while ((m_watchFd >= 0) && ((len = read(m_watchFd, buffer, sizeof(buffer))) > 0)) {
+            for (char* pos = buffer; pos < buffer + len;) {
+                auto* event = reinterpret_cast<inotify_event*>(pos);
+                writes.emplace_back(event->name);
+                pos += sizeof(inotify_event) + event->len;
+            }
+        }
+        return writes;
+    }
+
+    // value of an attribute. sysfs ignores the offset, the fake file does not,
+    // so a shorter number written at 0 leaves digits of a longer one after it
+    int64_t readPwm(int32_t chip, int32_t channel, const char* attr)
+    {
+        std::ifstream in(pwmDir(chip, channel) / attr);
+        int64_t value = -1;
+        in >> value;
+        return value;
+    }
+
+private:
+    std::filesystem::path pwmDir(int32_t chip, int32_t channel)
+    {
+        return m_root / ("pwmchip" + std::to_string(chip)) / ("pwm" + std::to_string(channel));
+    }
+
+    static void touch(const std::filesystem::path& file)
+    {
+        std::ofstream out(file);
+    }
+
+    std::filesystem::path m_root;
+    int                   m_watchFd {-1};
+};
+
+}  // namespace
+
+bool checkControl()
+{
+    int32_t failed = 0;
+    auto expect = [&](bool ok, const char* what) {
+        std::printf("%-40s %s\n", what, ok ? "ok" : "FAILED");
+        failed += ok ? 0 : 1;
+    };
+    using Writes = std::vector<std::string>;
+
+    // kernel pwm channel: setup clears enable and duty before period, duty
+    // goes before enable when driving, stop only drops enable
+    {
+        FakeSysfs sysfs;
+        sysfs.addPin(7);
+        sysfs.addPin(8);
+        sysfs.addPwm(0, 0);
+        expect(sysfs.watchPwm(0, 0), "pwm/watch_fake_sysfs");
+
+        Motor motor({7, 8}, nullptr, MotorPwmOption{0, 0, 50000});
+        expect(motor.isHwPwm(), "pwm/channel_taken");
+        expect(sysfs.takeWrites() == Writes{"enable", "duty_cycle", "period", "duty_cycle"}, "pwm/setup_order");
+        expect((sysfs.readPwm(0, 0, "period") == 50000) && (sysfs.readPwm(0, 0, "duty_cycle") == 0)
+               && (sysfs.readPwm(0, 0, "enable") == 0), "pwm/setup_values");
+
+        motor.setRunState(MotorState::Forward);
+        motor.setRunPwm(40);
+        motor.applyHwPwm();
+        expect(sysfs.takeWrites() == Writes{"duty_cycle", "enable"}, "pwm/drive_order");
+        expect((sysfs.readPwm(0, 0, "period") == 50000) && (sysfs.readPwm(0, 0, "duty_cycle") == 20000)
+               && (sysfs.readPwm(0, 0, "enable") == 1), "pwm/drive_values");
+
+        motor.setRunState(MotorState::Stop);
+        motor.applyHwPwm();
+        expect(sysfs.takeWrites() == Writes{"enable"}, "pwm/stop_order");
+        expect((sysfs.readPwm(0, 0, "duty_cycle") == 20000) && (sysfs.readPwm(0, 0, "enable") == 0),
+               "pwm/stop_values");
+    }
+
+    // no pwmchip: the motor keeps software pwm on its pins
+    {
+        FakeSysfs sysfs;
+        sysfs.addPin(7);
+        sysfs.addPin(8);
+        Motor motor({7, 8}, nullptr, MotorPwmOption{0, 0, 50000});
+        expect(!motor.isHwPwm(), "pwm/missing_chip_fallback");
+    }
+
+    return !failed;
+}
+
+void benchControl(BenchRunner& runner)
+{
+    {
+        FakeSysfs sysfs;
+        sysfs.addPin(7);
+        Gpio gpio(7, GPIO_DIR_OUT, GPIO_EDGE_NONE);
+        int32_t value = 0;
+        runner.run("gpio/setValue_fake_sysfs", [&]() {
+            value ^= 1;
+            benchKeep(gpio.setValue(value));
+        });
+    }
+
+    {
+        FakeSysfs sysfs;
+        sysfs.addPin(7);
+        sysfs.addPin(8);
+        Motor motor({7, 8});
+        bool forward = false;
+        runner.run("motor/setNowState_fake_sysfs", [&]() {
+            forward = !forward;
+            motor.setNowState(forward ? MotorState::Forward : MotorState::Stop);
+        });
+    }
+
+    // speed change of a motor on kernel pwm: one duty write, no edges
+    {
+        FakeSysfs sysfs;
+        sysfs.addPin(7);
+        sysfs.addPin(8);
+        sysfs.addPwm(0, 0);
+        Motor motor({7, 8}, nullptr, MotorPwmOption{0, 0, 50000});
+        motor.setRunState(MotorState::Forward);
+        int32_t pwm = 0;
+        runner.run("motor/applyHwPwm_fake_sysfs", [&]() {
+            pwm = (pwm + 7) % Motor::getMaxPwm();
+            motor.setRunPwm(pwm);
+            motor.applyHwPwm();
+        });
+    }
+
+    // one speed loop wake per pwm step with 4 running motors on simulated gpio
+    {
+        SimBackend sim;
+        sim.setLogEnable(false);
+        asio::io_context context;
+        CarOption option;
+        option.paramFile = CARBENCH_PARAM_FILE;
+        option.deviceName = "nanopim1";
+        option.sim = &sim;
+        option.startThread = false;
+        CarCtrl carCtrl{context, option};
+        carCtrl.setMotorSpeedLevel(5);
+        carCtrl.setCarMoving(CarDirection::dirUp);
+
+        // virtual time runs k_speedTickUs per op, feed the deadman watchdog as
+        // a driving client would, else it stops all motors during warm-up.
+        // sim wheels get no encoder edges, the stall check would boost and stop them
+        CarSpeed& carSpeed = carCtrl.getCarSpeed();
+        carSpeed.setStallCheck(false);
+        int32_t tick = 0;
+        runner.run("speed/controlTick_4motor", [&]() {
+            sim.advanceTime(k_speedTickUs);
+            if (++tick == 100) {
+                tick = 0;
+                carCtrl.keepAlive();
+            }
+            benchKeep(carSpeed.controlTick());
+        });
+        carCtrl.setAllMotorState(0);
+    }
+}
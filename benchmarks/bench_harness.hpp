@@ -0,0 +1,90 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+struct BenchResult
+{
+    std::string name;
+    int64_t     iterations;
+    double      nsPerOp;     // mean of all batches
+    double      p50;         // ns per op, median batch
+    double      p99;         // ns per op, 99th percentile batch
+};
+
+class BenchRunner
+{
+public:
+    explicit BenchRunner(std::string filter) : m_filter(std::move(filter))
+    {
+    }
+    virtual ~BenchRunner() = default;
+
+    /**
+     * @brief time fun in batches. per-op time of every batch is one sample
+     *
+     * @param name: benchmark name, group/item
+     * @param fun: operation to measure
+     * @param batchSize: calls per sample
+     * @param batches: samples after one warm-up batch
+     */
+    template<typename Fun>
+    void run(const std::string& name, Fun&& fun, int64_t batchSize = 1000, int32_t batches = 100)
+    {
+        if (!m_filter.empty() && (name.find(m_filter) == std::string::npos)) {
+            return;
+        }
+
+        for (int64_t i = 0; i < batchSize; i++) {
+            fun();
+        }
+
+        std::vector<double> samples;
+        samples.reserve(batches);
+        double total = 0;
+        for (int32_t b = 0; b < batches; b++) {
+            auto start = std::chrono::steady_clock::now();
+            for (int64_t i = 0; i < batchSize; i++) {
+                fun();
+            }
+            auto elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start);
+            samples.push_back(elapsed.count() / batchSize);
+            total += elapsed.count();
+        }
+        std::sort(samples.begin(), samples.end());
+
+        BenchResult result {name, batchSize * batches, total / (batchSize * batches),
+                            samples[samples.size() / 2], samples[samples.size() * 99 / 100]};
+        std::printf("%-40s %12.1f ns/op  p50 %10.1f  p99 %10.1f\n", name.c_str(),
+                    result.nsPerOp, result.p50, result.p99);
+        m_results.push_back(result);
+    }
+
+    std::vector<BenchResult>& getResults() { return m_results; }
+
+private:
+    std::string              m_filter;
+    std::vector<BenchResult> m_results;
+};
+
+// benchmark groups
+void benchCodec(BenchRunner& runner);
+void benchControl(BenchRunner& runner);
+void benchHttp(BenchRunner& runner);
+void benchMetrics(BenchRunner& runner);
+void benchParam(BenchRunner& runner);
+void benchRpc(BenchRunner& runner);
+
+// checks of the same fixtures, print each and return false on a failure
+bool checkControl();
+
+// keep result of fun from being optimized out
+template<typename T>
+inline void benchKeep(T&& value)
+{
+    asm volatile("" : : "r,m"(value) : "memory");
+}
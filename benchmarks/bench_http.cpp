@@ -0,0 +1,148 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <atomic>
+#include <cstdlib>
+#include <new>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include "http_parser.hpp"
+#include "bench_harness.hpp"
+
+// heap allocations of the whole process, read as a difference around a loop
+static std::atomic<uint64_t> g_allocCount {0};
+
+void* operator new(size_t size)
+{
+    g_allocCount.fetch_add(1, std::memory_order_relaxed);
+    if (void* ptr = std::malloc(size ? size : 1)) {
+        return ptr;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+namespace {
+
+// what the status page polls every second
+constexpr std::string_view k_request =
+    "GET /api/status?car=agv2 HTTP/1.1\r\n"
+    "Host: 192.168.1.20:8080\r\n"
+    "Connection: keep-alive\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/126.0 Safari/537.36\r\n"
+    "Accept: */*\r\n"
+    "Referer: http://192.168.1.20:8080/\r\n"
+    "Accept-Encoding: gzip, deflate\r\n"
+    "Accept-Language: en-US,en;q=0.9\r\n"
+    "\r\n";
+
+constexpr int32_t k_pipelined = 8;
+
+std::string_view findParam(std::string_view query, std::string_view key)
+{
+    while (!query.empty()) {
+        const auto end = query.find('&');
+        const auto token = query.substr(0, end);
+        if ((token.size() > key.size()) && token.starts_with(key) && (token[key.size()] == '=')) {
+            return token.substr(key.size() + 1);
+        }
+        query.remove_prefix((end == std::string_view::npos) ? query.size() : end + 1);
+    }
+    return {};
+}
+
+// the web server before the incremental parser: copy the read into a request
+// string, search it whole, split the request line with istringstream twice
+size_t legacyParse(std::string_view read)
+{
+    std::string request;
+    request.append(read.data(), read.size());
+    if (request.find("\r\n\r\n") == std::string::npos) {
+        return 0;
+    }
+
+    std::string path;
+    for (int32_t pass = 0; pass < 2; pass++) {
+        const auto lineEnd = request.find("\r\n");
+        const std::string requestLine = request.substr(0, lineEnd);
+        std::istringstream stream(requestLine);
+        std::string method;
+        std::string target;
+        std::string httpVersion;
+        stream >> method >> target >> httpVersion;
+        const auto queryPos = target.find('?');
+        path = target.substr(0, queryPos);
+        if (pass) {
+            const std::string query = target.substr(queryPos + 1);
+            const std::string prefix = std::string("car") + "=";
+            const auto car = query.substr(query.find(prefix) + prefix.size());
+            return path.size() + car.size();
+        }
+    }
+    return 0;
+}
+
+void reportRate(BenchRunner& runner, const std::string& name, int32_t requests, double allocs)
+{
+    auto& results = runner.getResults();
+    if (results.empty() || (results.back().name != name)) {
+        return;
+    }
+    std::printf("%-40s %12.0f requests/s, %.1f allocations/request\n", name.c_str(),
+                requests * 1e9 / results.back().nsPerOp, allocs / requests);
+}
+
+// allocations of one call of fun
+template<typename Fun>
+double countAllocs(Fun&& fun)
+{
+    const uint64_t before = g_allocCount.load(std::memory_order_relaxed);
+    fun();
+    return static_cast<double>(g_allocCount.load(std::memory_order_relaxed) - before);
+}
+
+}  // namespace
+
+void benchHttp(BenchRunner& runner)
+{
+    auto legacy = [&]() { benchKeep(legacyParse(k_request)); };
+    runner.run("http/parse_legacy", legacy, 1000, 100);
+    reportRate(runner, "http/parse_legacy", 1, countAllocs(legacy));
+
+    cli::HttpParser parser;
+    cli::HttpRequest request;
+    auto single = [&]() {
+        parser.reset();
+        if (parser.parse(k_request, request) == cli::HttpParser::Status::Done) {
+            benchKeep(request.path.size() + findParam(request.query, "car").size());
+        }
+    };
+    runner.run("http/parse_incremental", single, 1000, 100);
+    reportRate(runner, "http/parse_incremental", 1, countAllocs(single));
+
+    // a keep-alive connection with pipelined requests in one read
+    std::string pipelined;
+    for (int32_t i = 0; i < k_pipelined; i++) {
+        pipelined += k_request;
+    }
+    auto burst = [&]() {
+        std::string_view data = pipelined;
+        parser.reset();
+        while (parser.parse(data, request) == cli::HttpParser::Status::Done) {
+            benchKeep(request.path.size() + findParam(request.query, "car").size());
+            data.remove_prefix(parser.getLength());
+            parser.reset();
+        }
+    };
+    runner.run("http/parse_pipelined", burst, 100, 100);
+    reportRate(runner, "http/parse_pipelined", k_pipelined, countAllocs(burst));
+}
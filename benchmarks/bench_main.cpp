@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: GPL-2.0
+// micro benchmarks of control and io hot paths.
+//   carbench [-f filter] [-o result.json]
+//   carbench -c                  checks on the fixtures only, exit 1 on a failure
+//   bench_compare base.json new.json [threshold%]
+
+#include <chrono>
+#include <fstream>
+#include <unistd.h>
+#include <nlohmann/json.hpp>
+#include <xapi/easylog.hpp>
+#include "bench_harness.hpp"
+
+namespace {
+
+bool write_json(const std::string& fileName, std::vector<BenchResult>& results)
+{
+    char host[64] {0};
+    gethostname(host, sizeof(host) - 1);
+
+    nlohmann::json root;
+    root["context"]["host"] = host;
+    root["context"]["time"] = std::chrono::duration_cast<std::chrono::seconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    root["benchmarks"] = nlohmann::json::array();
+    for (const auto& result : results) {
+        root["benchmarks"].push_back({{"name", result.name},
+                                      {"iterations", result.iterations},
+                                      {"ns_per_op", result.nsPerOp},
+                                      {"p50_ns", result.p50},
+                                      {"p99_ns", result.p99}});
+    }
+
+    std::ofstream file(fileName);
+    if (!file.is_open()) {
+        std::fprintf(stderr, "[carbench] fail to open %s\n", fileName.c_str());
+        return false;
+    }
+    file << root.dump(2) << "\n";
+    return true;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    std::string filter, outFile;
+    bool check = false;
+    int c;
+    while ((c = getopt(argc, argv, "f:o:ch")) != -1) {
+        switch (c) {
+        case 'c':
+            check = true;
+            break;
+        case 'f':
+            filter = optarg;
+            break;
+        case 'o':
+            outFile = optarg;
+            break;
+        default:
+            std::fprintf(stderr, "usage: %s [-f filter] [-o result.json] | -c\n", argv[0]);
+            return 1;
+        }
+    }
+
+    easylog_options logOption;
+    logOption.log_dir = "/tmp/";
+    logOption.log_level = spdlog::level::err;
+    init_log(logOption);
+
+    if (check) {
+        return checkControl() ? 0 : 1;
+    }
+
+    BenchRunner runner(filter);
+    benchCodec(runner);
+    benchControl(runner);
+    benchHttp(runner);
+    benchMetrics(runner);
+    benchParam(runner);
+    benchRpc(runner);
+
+    if (!outFile.empty() && !write_json(outFile, runner.getResults())) {
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,52 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <memory>
+#include <string>
+#include <vector>
+#include <xapi/metrics.hpp>
+#include "bench_harness.hpp"
+
+namespace {
+
+// about the series of agvctrl and agvintf together, one handler per rpc
+constexpr int32_t k_handlers = 26;
+
+}  // namespace
+
+void benchMetrics(BenchRunner& runner)
+{
+    metrics::Counter counter {"carbench_events_total", "events of the benchmark"};
+    metrics::Histogram histogram {"carbench_tick_seconds", "ticks of the benchmark", metrics::k_latencyBoundsUs, 1e6};
+
+    // instrumented paths: a relaxed add on the shard of this thread
+    runner.run("metrics/counter_inc", [&]() { counter.inc(); }, 10000, 100);
+    int64_t value = 0;
+    runner.run("metrics/histogram_observe", [&]() {
+        histogram.observe(value);
+        value = (value + 37) & 4095;
+    }, 10000, 100);
+
+    std::vector<std::unique_ptr<metrics::Histogram>> handlers;
+    for (int32_t i = 0; i < k_handlers; i++) {
+        handlers.push_back(std::make_unique<metrics::Histogram>("carbench_rpc_duration_seconds", "rpc of the benchmark",
+            metrics::k_latencyBoundsUs, 1e6, "handler=\"handler" + std::to_string(i) + "\""));
+        handlers.back()->observe(i * 100);
+    }
+
+    // a scrape: render this process, then merge it with a car of the fleet
+    std::string text;
+    runner.run("metrics/render", [&]() {
+        text.clear();
+        metrics::render(text);
+        benchKeep(text.size());
+    }, 100, 100);
+
+    std::string merged;
+    const metrics::Exposition parts[] = {{text, {}}, {text, "car=\"agv2\""}};
+    runner.run("metrics/merge", [&]() {
+        merged.clear();
+        metrics::merge(parts, merged);
+        benchKeep(merged.size());
+    }, 100, 100);
+    std::printf("%-40s %12zu bytes rendered, %zu merged\n", "metrics/scrape", text.size(), merged.size());
+}
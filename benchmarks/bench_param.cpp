@@ -0,0 +1,21 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <xapi/param_json.hpp>
+#include "bench_harness.hpp"
+
+void benchParam(BenchRunner& runner)
+{
+    ParamJson param(CARBENCH_PARAM_FILE);
+
+    runner.run("param/getJsonParam_int", [&]() {
+        int32_t motorNum = 0;
+        benchKeep(param.getJsonParam("nanopim1.motor_num", motorNum));
+        benchKeep(motorNum);
+    });
+
+    runner.run("param/getJsonParam_vector", [&]() {
+        std::vector<int32_t> pwm;
+        benchKeep(param.getJsonParam("nanopim1.pwm.five", pwm));
+        benchKeep(pwm.data());
+    });
+}
@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <xapi/cmn_singleton.hpp>
+#include <ylt/coro_rpc/coro_rpc_server.hpp>
+#include <ylt/struct_pack.hpp>
+#include <ylt/util/function_name.h>
+#include <ylt/util/type_traits.h>
+#include <rpc_service.hpp>
+#include "car_ctrl.hpp"
+#include "bench_harness.hpp"
+
+namespace {
+
+constexpr uint16_t k_benchRpcPort = rpc_port + 100;
+
+// pack and unpack arguments and return value as the rpc protocol carries them
+template<auto func>
+void benchPackHandler(BenchRunner& runner)
+{
+    using Traits = util::function_traits<decltype(func)>;
+    using Params = typename Traits::parameters_type;
+    using Return = typename Traits::return_type;
+
+    const std::string name = "struct_pack/" + std::string(coro_rpc::get_func_name<func>());
+    runner.run(name, [&]() {
+        if constexpr (!std::is_void_v<Params>) {
+            Params params {};
+            auto buffer = struct_pack::serialize(params);
+            auto result = struct_pack::deserialize<Params>(buffer);
+            benchKeep(result.has_value());
+        }
+        if constexpr (!std::is_void_v<Return>) {
+            Return value {};
+            auto buffer = struct_pack::serialize(value);
+            auto result = struct_pack::deserialize<Return>(buffer);
+            benchKeep(result.has_value());
+        }
+    });
+}
+
+template<auto... funcs>
+void benchPackHandlers(BenchRunner& runner, RpcHandlerList<funcs...>)
+{
+    (benchPackHandler<funcs>(runner), ...);
+}
+
+}  // namespace
+
+void benchRpc(BenchRunner& runner)
+{
+    benchPackHandlers(runner, RpcHandlers{});
+
+    // full loopback call: client, struct_pack, socket, server, CarCtrl on simulated gpio
+    SimBackend sim;
+    sim.setLogEnable(false);
+    coro_rpc::coro_rpc_server server(1, k_benchRpcPort);
+    auto& context = server.get_io_context_pool().get_executor()->context();
+
+    CarOption option;
+    option.paramFile = CARBENCH_PARAM_FILE;
+    option.deviceName = "nanopim1";
+    option.sim = &sim;
+    option.startThread = false;
+    CarCtrl carCtrl{context, option};
+    cmn::setSingletonInstance(&carCtrl);
+    rpc_register_handlers(server, RpcHandlers{});
+
+    auto started = server.async_start();
+    if (started.hasResult()) {
+        ctrllog::error("bench: fail to start rpc server on port {}", k_benchRpcPort);
+        cmn::resetSingletonInstance<CarCtrl>();
+        return;
+    }
+
+    coro_rpc::coro_rpc_client client;
+    syncAwait(client.connect("127.0.0.1", std::to_string(k_benchRpcPort)));
+    runner.run("rpc/loopback_getActualSteps", [&]() {
+        benchKeep(rpc_call_int_param<getActualSteps>(client, 1));
+    }, 100, 50);
+
+    // the same command as agvcar calls it, for comparison with the loopback
+    runner.run("rpc/direct_getActualSteps", [&]() {
+        benchKeep(getActualSteps(1));
+    });
+
+    client.close();
+    server.stop();
+    cmn::resetSingletonInstance<CarCtrl>();
+}
@@ -0,0 +1,65 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <asio.hpp>
+#include <video/video_ctrl.hpp>
+
+namespace cli
+{
+
+/**
+ * @brief mjpeg fan-out of the web cameras
+ *  the video thread only tells that a frame is ready. the hub takes its
+ *  handle once on the io thread, adds one part header and hands the part to
+ *  every waiting viewer, the jpeg itself is never copied. a viewer sends the
+ *  newest part when its write completes, parts in between are skipped for a
+ *  slow one. without viewers a frame is not even taken.
+ */
+class CameraHub
+{
+public:
+    static constexpr int32_t k_cameraNum = 2;
+
+    CameraHub(asio::io_context& context, VideoCtrl& videoCtrl);
+    ~CameraHub();
+
+    // stream camera to socket until the viewer goes away
+    void subscribe(std::shared_ptr<asio::ip::tcp::socket> socket, int32_t camera);
+
+private:
+    // boundary and part header of one frame, shared by all viewers
+    struct Part
+    {
+        std::shared_ptr<const VideoFrame> frame;
+        std::string                       header;
+    };
+
+    struct Viewer;
+
+    struct Channel
+    {
+        std::shared_ptr<const Part>          latest;
+        std::vector<std::shared_ptr<Viewer>> idle;            // wait for next part
+        int32_t                              viewers {0};
+        std::atomic<bool>                    pending {false}; // frame posted to io thread
+    };
+
+    void publish(int32_t camera);
+    void next(std::shared_ptr<Viewer> viewer);
+    void send(std::shared_ptr<Viewer> viewer, std::shared_ptr<const Part> part);
+    void drop(std::shared_ptr<Viewer> viewer);
+
+    asio::io_context&                 m_context;
+    VideoCtrl&                        m_videoCtrl;
+    std::array<Channel, k_cameraNum>  m_channels;
+    std::vector<std::shared_ptr<Viewer>> m_waking;    // idle of a channel while sending
+};
+
+}  // namespace cli
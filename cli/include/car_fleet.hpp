@@ -0,0 +1,153 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <type_traits>
+#include <variant>
+#include <vector>
+#include <async_simple/coro/Collect.h>
+#include <async_simple/coro/SyncAwait.h>
+#include <xapi/easylog.hpp>
+#include <ylt/coro_rpc/coro_rpc_client.hpp>
+#include <ylt/coro_io/load_balancer.hpp>
+#include <ylt/util/type_traits.h>
+#include <rpc_service.hpp>
+
+namespace cli
+{
+
+/**
+ * @brief agvctrl endpoints of many cars
+ *  a car is a load balancer over its addresses (wifi, ethernet), each address
+ *  a client pool, so a call takes a free connection of a live address.
+ *  broadcast sends to all cars at once and waits for the slowest, a fleet
+ *  stop costs one round trip, not one per car.
+ */
+class CarFleet
+{
+public:
+    // result of rpc function, monostate for void
+    template<auto func>
+    using Value = std::conditional_t<std::is_void_v<typename util::function_traits<decltype(func)>::return_type>,
+                                     std::monostate,
+                                     typename util::function_traits<decltype(func)>::return_type>;
+
+    template<auto func>
+    struct Reply
+    {
+        std::string car;
+        std::optional<Value<func>> value;   // empty when car did not answer
+    };
+
+    CarFleet() = default;
+    virtual ~CarFleet() = default;
+
+    // fleet file: {"cars": {"name": ["host:port", ...]}}, cars are added to fleet
+    int32_t loadFile(const std::string& fileName);
+
+    // hosts of one car are tried in turn, dead ones skipped
+    int32_t addCar(const std::string& name, const std::vector<std::string>& hosts);
+    int32_t removeCar(const std::string& name);
+    std::vector<std::string> getNames();
+    std::vector<std::string> getHosts(const std::string& name);
+
+    template<auto func, typename... Args>
+    std::optional<Value<func>> call(const std::string& name, Args... args)
+    {
+        auto car = findCar(name);
+        if (car == nullptr) {
+            apilog::warn("fleet: no car {}", name);
+            return std::nullopt;
+        }
+        return async_simple::coro::syncAwait(callCar<func>(car, args...));
+    }
+
+    // for callers that must not block, resumes on an rpc io thread
+    template<auto func, typename... Args>
+    async_simple::coro::Lazy<std::optional<Value<func>>> callAsync(std::string name, Args... args)
+    {
+        auto car = findCar(name);
+        if (car == nullptr) {
+            apilog::warn("fleet: no car {}", name);
+            co_return std::nullopt;
+        }
+        co_return co_await callCar<func>(car, args...);
+    }
+
+    template<auto func, typename... Args>
+    std::vector<Reply<func>> broadcast(Args... args)
+    {
+        return async_simple::coro::syncAwait(broadcastAsync<func>(args...));
+    }
+
+    // for callers that must not block, resumes on an rpc io thread
+    template<auto func, typename... Args>
+    async_simple::coro::Lazy<std::vector<Reply<func>>> broadcastAsync(Args... args)
+    {
+        std::vector<std::shared_ptr<Car>> cars;
+        {
+            std::lock_guard lock(m_mutex);
+            for (const auto& [name, car] : m_cars) {
+                cars.push_back(car);
+            }
+        }
+
+        std::vector<async_simple::coro::Lazy<std::optional<Value<func>>>> calls;
+        for (const auto& car : cars) {
+            calls.push_back(callCar<func>(car, args...));
+        }
+        auto results = co_await async_simple::coro::collectAll(std::move(calls));
+
+        std::vector<Reply<func>> replies;
+        for (size_t i = 0; i < cars.size(); i++) {
+            Reply<func> reply {cars[i]->name, std::nullopt};
+            if (!results[i].hasError()) {
+                reply.value = std::move(results[i].value());
+            }
+            replies.push_back(std::move(reply));
+        }
+        co_return replies;
+    }
+
+    // a dead car fails a broadcast after this, not after tcp timeouts
+    static constexpr std::chrono::milliseconds k_callTimeout {1000};
+
+private:
+    struct Car
+    {
+        std::string name;
+        std::vector<std::string> hosts;
+        coro_io::load_balancer<coro_rpc::coro_rpc_client> balancer;
+    };
+
+    template<auto func, typename... Args>
+    static async_simple::coro::Lazy<std::optional<Value<func>>> callCar(std::shared_ptr<Car> car, Args... args)
+    {
+        auto ret = co_await car->balancer.send_request(
+            [&](coro_rpc::coro_rpc_client& client, std::string_view host) {
+                return client.call<func>(args...);
+            });
+        if (!ret || !ret.value()) {
+            apilog::warn("fleet: {} to car {} failed", coro_rpc::get_func_name<func>(), car->name);
+            co_return std::nullopt;
+        }
+        if constexpr (std::is_void_v<typename util::function_traits<decltype(func)>::return_type>) {
+            co_return std::monostate{};
+        } else {
+            co_return std::move(ret.value().value());
+        }
+    }
+
+    std::shared_ptr<Car> findCar(const std::string& name);
+
+    std::mutex m_mutex;
+    std::map<std::string, std::shared_ptr<Car>> m_cars;
+};
+
+}  // namespace cli
@@ -2,11 +2,19 @@
 
 #pragma once
 
+#include <charconv>
 #include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <vector>
 
 #include <asio.hpp>
+#include <camera_hub.hpp>
+#include <car_fleet.hpp>
 #include <cli_car.hpp>
+#include <http_parser.hpp>
+#include <status_events.hpp>
 #include <video/video_ctrl.hpp>
 
 namespace cli
@@ -15,28 +23,107 @@ namespace cli
 class CarWebServer
 {
 public:
-    CarWebServer(asio::io_context& context, CliCar& cliCar, VideoCtrl& videoCtrl, uint16_t port);
+    CarWebServer(asio::io_context& context, CliCar& cliCar, CarFleet& fleet, VideoCtrl& videoCtrl, uint16_t port);
     ~CarWebServer();
 
 private:
+    class Connection;
+    class DriveSocket;
+
     void accept();
-    void handleConnection(std::shared_ptr<asio::ip::tcp::socket> socket);
     void handleCameraStream(std::shared_ptr<asio::ip::tcp::socket> socket, int32_t cameraId);
-    void sendCameraFrame(std::shared_ptr<asio::ip::tcp::socket> socket, int32_t cameraId);
+    void handleEventStream(std::shared_ptr<asio::ip::tcp::socket> socket, const HttpRequest& request);
+    // websocket upgrade of /api/drive, early are bytes read after the request
+    void handleDriveSocket(std::shared_ptr<asio::ip::tcp::socket> socket, const HttpRequest& request,
+                           std::string_view early);
+
+    // local car when car is empty, else the named car of fleet. default value when no answer
+    template<auto func, typename... Args>
+    auto callCar(const std::string& car, Args... args)
+    {
+        using Return = decltype(func(args...));
+        if constexpr (std::is_void_v<Return>) {
+            if (car.empty()) {
+                rpc_call_void_param<func>(m_cliCar.getClient(), args...);
+            } else {
+                m_fleet.call<func>(car, args...);
+            }
+        } else {
+            if (car.empty()) {
+                return rpc_call_param<func>(m_cliCar.getClient(), args...);
+            }
+            return m_fleet.call<func>(car, args...).value_or(Return{});
+        }
+    }
+
+    // callCar that does not block on a fleet car, the local car answers in place
+    template<auto func, typename... Args>
+    async_simple::coro::Lazy<decltype(func(std::declval<Args>()...))> callCarAsync(std::string car, Args... args)
+    {
+        using Return = decltype(func(args...));
+        if constexpr (std::is_void_v<Return>) {
+            if (car.empty()) {
+                rpc_call_void_param<func>(m_cliCar.getClient(), args...);
+            } else {
+                co_await m_fleet.callAsync<func>(car, args...);
+            }
+        } else {
+            if (car.empty()) {
+                co_return rpc_call_param<func>(m_cliCar.getClient(), args...);
+            }
+            auto value = co_await m_fleet.callAsync<func>(car, args...);
+            co_return std::move(value).value_or(Return{});
+        }
+    }
 
-    std::string buildStatusJson();
+    std::string buildStatusJson(const std::string& car);
+    // status for events, a fleet car is sampled without blocking the io thread
+    void sampleStatus(const std::string& car, StatusEvents::Done done);
+    async_simple::coro::Lazy<std::string> sampleFleetStatus(std::string car);
+    // motors holds speed, pwm, ctrlStep and actualStep of each motor
+    static std::string formatStatusJson(int32_t speedLevel, int32_t motorNum, int32_t ctrlMode,
+                                        const std::vector<int32_t>& motors);
+    async_simple::coro::Lazy<std::string> buildFleetJson();
+    // nullopt when a query parameter is malformed
+    async_simple::coro::Lazy<std::optional<std::string>> buildHistoryJson(std::string car, std::string_view query);
     std::string buildCameraInfoJson();
-    std::string handleRequest(const std::string& request);
-    std::string httpResponse(int code, const std::string& status,
-                             const std::string& contentType, const std::string& body);
-    static std::string getRequestPath(const std::string& request);
-    static int32_t getCameraStreamId(const std::string& path);
-    static std::string urlDecode(const std::string& value);
-    static std::string getQueryParam(const std::string& query, const std::string& key);
+    // prometheus text of agvintf and the agvctrl of every car
+    async_simple::coro::Lazy<std::string> buildMetricsText();
+    // request of the local car
+    std::string handleRequest(const HttpRequest& request);
+    // routes of one car, "" is the local car
+    async_simple::coro::Lazy<std::string> handleCarRequest(HttpRequest request, std::string car);
+    // routes that wait for fleet cars, answered by handleAsyncRequest off the io thread
+    static bool isAsyncRequest(const HttpRequest& request);
+    // views of request stay valid, the connection reads nothing until the answer
+    async_simple::coro::Lazy<std::string> handleAsyncRequest(HttpRequest request);
+    // answer and close, for requests that would own the socket
+    static void sendAndClose(std::shared_ptr<asio::ip::tcp::socket> socket, std::string response);
+    std::string httpResponse(int code, const std::string& status, const std::string& contentType,
+                             const std::string& body, bool keepAlive = true);
+    // -1 when path is no camera stream
+    static int32_t getCameraStreamId(std::string_view path);
+    static std::string urlDecode(std::string_view value);
+    static std::string getQueryParam(std::string_view query, std::string_view key);
+    // value stays fallback when key is absent, false when it is no integer of T
+    template<typename T>
+    static bool getQueryInt(std::string_view query, std::string_view key, T fallback, T& value)
+    {
+        const auto text = getQueryParam(query, key);
+        if (text.empty()) {
+            value = fallback;
+            return true;
+        }
+        auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+        return (ec == std::errc{}) && (ptr == text.data() + text.size());
+    }
 
     asio::io_context&       m_context;
     CliCar&                 m_cliCar;
+    CarFleet&               m_fleet;
     VideoCtrl&              m_videoCtrl;
+    CameraHub               m_cameraHub;
+    StatusEvents            m_statusEvents;
     asio::ip::tcp::acceptor m_acceptor;
 };
 
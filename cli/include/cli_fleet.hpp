@@ -0,0 +1,30 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+#include <cli/cli.h>
+#include <cli_impl.h>
+#include <memory>
+#include <car_fleet.hpp>
+
+namespace cli
+{
+class CliCommandGroup;
+
+class CliFleet : public CliCommandGroup
+{
+public:
+    CliFleet() : CliCommandGroup("fleet")
+    {
+    }
+    virtual ~CliFleet() = default;
+
+    void initCliCommand(std::unique_ptr<Menu>& rootMenu) override;
+    CarFleet& getFleet() { return m_fleet; }
+
+    static constexpr const char* k_fleetFile = "fleet.json";
+
+private:
+    CarFleet m_fleet;
+};
+
+}  // namespace cli
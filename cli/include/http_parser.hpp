@@ -0,0 +1,74 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace cli
+{
+
+struct HttpHeader
+{
+    std::string_view name;
+    std::string_view value;
+};
+
+// views into the connection buffer, valid until the next read of the connection
+struct HttpRequest
+{
+    std::string_view method;
+    std::string_view target;
+    std::string_view path;
+    std::string_view query;                 // after '?', without it
+    int32_t          minorVersion {1};      // HTTP/1.x
+    std::array<HttpHeader, 32> headers;
+    size_t           headerNum {0};
+    std::string_view body;
+    bool             keepAlive {true};
+
+    // value of header, name is case-insensitive. empty when missing
+    std::string_view getHeader(std::string_view name) const;
+    // comma separated header lists token, e.g. Connection: keep-alive, Upgrade
+    bool hasToken(std::string_view name, std::string_view token) const;
+};
+
+/**
+ * @brief incremental http/1.1 request parser
+ *  parse() is called with the unparsed bytes of a connection after each read.
+ *  the end of the header is searched in new bytes only, request line and
+ *  header lines are split into views of the buffer once the header is
+ *  complete, nothing is copied or allocated. a request ends after
+ *  Content-Length bytes of body, the next pipelined request starts there.
+ */
+class HttpParser
+{
+public:
+    enum class Status {
+        Done,       // request is filled, getLength() bytes used
+        More,       // read more bytes
+        Error       // answer getErrorCode() and close
+    };
+
+    static constexpr size_t k_maxHeaderBytes = 8192;
+    static constexpr size_t k_maxBodyBytes   = 65536;
+
+    Status  parse(std::string_view data, HttpRequest& request);
+    size_t  getLength()    { return m_length; }
+    int32_t getErrorCode() { return m_errorCode; }
+
+    // before next request of connection
+    void    reset();
+
+private:
+    Status  fail(int32_t code);
+    bool    parseHeader(std::string_view header, HttpRequest& request);
+
+    size_t  m_scanned {0};          // bytes searched for end of header
+    size_t  m_headerLength {0};     // with empty line, 0 until found
+    size_t  m_length {0};
+    int32_t m_errorCode {0};
+};
+
+}  // namespace cli
@@ -0,0 +1,73 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+
+#include <chrono>
+#include <functional>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <asio.hpp>
+
+namespace cli
+{
+
+/**
+ * @brief server-sent status events of the cars
+ *  each car with listeners is sampled once per k_period, the event is
+ *  serialized once and written to all its listeners, so the rpc cost does
+ *  not grow with open dashboards. a listener still writing gets the newest
+ *  event when done, older ones are skipped. the timer stops without listeners.
+ *  a sample may finish later, a car still sampled is skipped in the next period.
+ */
+class StatusEvents
+{
+public:
+    static constexpr auto k_period = std::chrono::milliseconds(1000);
+
+    // sample calls done with the status json of a car, "" is the local car.
+    // done runs in the io thread, at once or when the car answered
+    using Done = std::function<void(std::string json)>;
+    using Sample = std::function<void(const std::string& car, Done done)>;
+
+    StatusEvents(asio::io_context& context, Sample sample);
+
+    // stream events of car to socket until the listener goes away
+    void subscribe(std::shared_ptr<asio::ip::tcp::socket> socket, const std::string& car);
+
+private:
+    struct Event
+    {
+        uint64_t    seq;
+        std::string data;       // id and data lines
+    };
+
+    struct Listener;
+
+    struct Channel
+    {
+        std::shared_ptr<const Event>           latest;
+        std::vector<std::shared_ptr<Listener>> idle;       // wait for next event
+        int32_t                                listeners {0};
+        bool                                   sampling {false};
+    };
+
+    void tick();
+    void sample(const std::string& car, Channel& channel);
+    void publish(Channel& channel, const std::string& json);
+    void next(std::shared_ptr<Listener> listener);
+    void send(std::shared_ptr<Listener> listener, std::shared_ptr<const Event> event);
+    void drop(std::shared_ptr<Listener> listener);
+
+    asio::io_context&                                   m_context;
+    Sample                                              m_sample;
+    asio::steady_timer                                  m_timer;
+    bool                                                m_running {false};
+    std::map<std::string, Channel>                      m_channels;
+    std::vector<std::shared_ptr<Listener>>              m_waking;   // idle of a channel while sending
+    uint64_t                                            m_seq {0};
+};
+
+}  // namespace cli
@@ -0,0 +1,51 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace cli
+{
+
+// rfc 6455 frames of a server. client frames are masked, they are unmasked
+// in place in the read buffer. fragmented messages are not used by the
+// control page and are refused like an oversized frame
+class WebSocket
+{
+public:
+    enum Opcode : uint8_t {
+        opText   = 0x1,
+        opBinary = 0x2,
+        opClose  = 0x8,
+        opPing   = 0x9,
+        opPong   = 0xa
+    };
+
+    struct Frame
+    {
+        uint8_t          opcode;
+        std::string_view payload;
+    };
+
+    static constexpr size_t k_maxPayload = 1024;
+    static constexpr size_t k_needMore   = 0;
+    static constexpr size_t k_badFrame   = SIZE_MAX;
+
+    // Sec-WebSocket-Accept of Sec-WebSocket-Key
+    static std::string acceptKey(std::string_view key);
+
+    /**
+     * @brief parse one client frame at start of data, unmask its payload
+     *
+     * @return bytes of frame, k_needMore or k_badFrame
+     */
+    static size_t parseFrame(std::span<char> data, Frame& frame);
+
+    // append one unmasked final frame
+    static void putFrame(std::string& out, uint8_t opcode, std::string_view payload);
+};
+
+}  // namespace cli
@@ -0,0 +1,141 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <camera_hub.hpp>
+
+#include <array>
+
+#include <fmt/format.h>
+#include <xapi/easylog.hpp>
+#include <xapi/metrics.hpp>
+
+namespace cli
+{
+
+namespace
+{
+
+constexpr std::string_view k_streamHeader =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: multipart/x-mixed-replace; boundary=frame\r\n"
+    "Cache-Control: no-cache, no-store, must-revalidate\r\n"
+    "Pragma: no-cache\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n";
+
+constexpr std::string_view k_partEnd = "\r\n";
+
+metrics::Gauge   g_viewers {"agvintf_web_streams", "open streams of the web server", "kind=\"camera\""};
+metrics::Counter g_partsSent {"agvintf_camera_parts_total", "mjpeg parts written to viewers"};
+
+}  // namespace
+
+struct CameraHub::Viewer
+{
+    std::shared_ptr<asio::ip::tcp::socket> socket;
+    int32_t                                camera;
+    uint64_t                               sentSeq {0};
+};
+
+CameraHub::CameraHub(asio::io_context& context, VideoCtrl& videoCtrl) :
+    m_context{context},
+    m_videoCtrl{videoCtrl}
+{
+    // one post per frame at most, a frame arriving before it ran is taken with it
+    m_videoCtrl.setWebFrameListener([this](int32_t camera) {
+        if ((camera < 0) || (camera >= k_cameraNum) || m_channels[camera].pending.exchange(true)) {
+            return;
+        }
+        asio::post(m_context, [this, camera]() {
+            publish(camera);
+        });
+    });
+}
+
+CameraHub::~CameraHub()
+{
+    m_videoCtrl.setWebFrameListener({});
+}
+
+void CameraHub::subscribe(std::shared_ptr<asio::ip::tcp::socket> socket, int32_t camera)
+{
+    auto viewer = std::make_shared<Viewer>(std::move(socket), camera);
+    m_channels[camera].viewers++;
+    g_viewers.add(1);
+    ctrllog::info("camera {} viewer added, {} viewers", camera, m_channels[camera].viewers);
+    asio::async_write(*viewer->socket, asio::buffer(k_streamHeader),
+        [this, viewer](const asio::error_code& ec, std::size_t) {
+            if (ec) {
+                drop(viewer);
+                return;
+            }
+            next(viewer);
+        });
+}
+
+void CameraHub::publish(int32_t camera)
+{
+    auto& channel = m_channels[camera];
+    channel.pending = false;
+    if (!channel.viewers) {
+        return;
+    }
+    auto frame = m_videoCtrl.getWebFrame(camera);
+    if (!frame || frame->data.empty() || (channel.latest && (channel.latest->frame == frame))) {
+        return;
+    }
+
+    auto part = std::make_shared<Part>();
+    part->header = fmt::format("--frame\r\nContent-Type: image/jpeg\r\nContent-Length: {}\r\n\r\n",
+                               frame->data.size());
+    part->frame = std::move(frame);
+    channel.latest = std::move(part);
+
+    // send() only starts writes, idle is refilled by their completions
+    m_waking.swap(channel.idle);
+    for (auto& viewer : m_waking) {
+        send(viewer, channel.latest);
+    }
+    m_waking.clear();
+}
+
+void CameraHub::next(std::shared_ptr<Viewer> viewer)
+{
+    auto& channel = m_channels[viewer->camera];
+    if (channel.latest && (channel.latest->frame->seq > viewer->sentSeq)) {
+        send(viewer, channel.latest);
+    } else {
+        channel.idle.push_back(std::move(viewer));
+    }
+}
+
+void CameraHub::send(std::shared_ptr<Viewer> viewer, std::shared_ptr<const Part> part)
+{
+    viewer->sentSeq = part->frame->seq;
+    g_partsSent.inc();
+    const std::array<asio::const_buffer, 3> buffers {asio::buffer(part->header), asio::buffer(part->frame->data),
+                                                     asio::buffer(k_partEnd)};
+    asio::async_write(*viewer->socket, buffers,
+        [this, viewer, part](const asio::error_code& ec, std::size_t) {
+            if (ec) {
+                drop(viewer);
+                return;
+            }
+            next(viewer);
+        });
+}
+
+void CameraHub::drop(std::shared_ptr<Viewer> viewer)
+{
+    auto& channel = m_channels[viewer->camera];
+    if (!--channel.viewers) {
+        channel.latest.reset();     // the next viewer starts with a fresh frame
+    }
+    g_viewers.add(-1);
+    ctrllog::info("camera {} viewer gone, {} viewers", viewer->camera, channel.viewers);
+
+    asio::error_code ec;
+    viewer->socket->shutdown(asio::ip::tcp::socket::shutdown_both, ec);
+    viewer->socket->close(ec);
+}
+
+}  // namespace cli
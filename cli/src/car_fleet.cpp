@@ -0,0 +1,88 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <car_fleet.hpp>
+
+#include <filesystem>
+#include <xapi/param_json.hpp>
+
+namespace cli
+{
+
+int32_t CarFleet::loadFile(const std::string& fileName)
+{
+    std::error_code ec;
+    if (!std::filesystem::exists(fileName, ec)) {
+        return 0;
+    }
+
+    ParamJson param(fileName);
+    std::map<std::string, std::vector<std::string>> cars;
+    if (!param.getJsonParam("cars", cars)) {
+        apilog::warn("fleet: no cars in {}", fileName);
+        return -1;
+    }
+
+    int32_t added = 0;
+    for (const auto& [name, hosts] : cars) {
+        if (addCar(name, hosts) == 0) {
+            added++;
+        }
+    }
+    apilog::info("fleet: {} cars from {}", added, fileName);
+    return added;
+}
+
+int32_t CarFleet::addCar(const std::string& name, const std::vector<std::string>& hosts)
+{
+    if (name.empty() || hosts.empty()) {
+        apilog::warn("fleet: car {} needs a name and at least one host", name);
+        return -1;
+    }
+
+    coro_io::load_balancer<coro_rpc::coro_rpc_client>::load_balancer_config config;
+    config.pool_config.client_config.connect_timeout_duration = k_callTimeout;
+    config.pool_config.client_config.request_timeout_duration = k_callTimeout;
+    std::vector<std::string_view> hostViews(hosts.begin(), hosts.end());
+
+    auto car = std::make_shared<Car>(Car{name, hosts,
+        coro_io::load_balancer<coro_rpc::coro_rpc_client>::create(hostViews, config)});
+
+    std::lock_guard lock(m_mutex);
+    if (m_cars.contains(name)) {
+        apilog::warn("fleet: car {} exists", name);
+        return -1;
+    }
+    m_cars.emplace(name, std::move(car));
+    return 0;
+}
+
+int32_t CarFleet::removeCar(const std::string& name)
+{
+    std::lock_guard lock(m_mutex);
+    return m_cars.erase(name) ? 0 : -1;
+}
+
+std::vector<std::string> CarFleet::getNames()
+{
+    std::lock_guard lock(m_mutex);
+    std::vector<std::string> names;
+    for (const auto& [name, car] : m_cars) {
+        names.push_back(name);
+    }
+    return names;
+}
+
+std::vector<std::string> CarFleet::getHosts(const std::string& name)
+{
+    auto car = findCar(name);
+    return car ? car->hosts : std::vector<std::string>{};
+}
+
+std::shared_ptr<CarFleet::Car> CarFleet::findCar(const std::string& name)
+{
+    std::lock_guard lock(m_mutex);
+    auto it = m_cars.find(name);
+    return (it != m_cars.end()) ? it->second : nullptr;
+}
+
+}  // namespace cli
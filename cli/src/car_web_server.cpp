@@ -2,14 +2,17 @@
 
 #include <car_web_server.hpp>
 
+#include <algorithm>
 #include <cctype>
-#include <array>
 #include <chrono>
-#include <functional>
+#include <cstring>
 #include <sstream>
+#include <vector>
 
 #include <fmt/format.h>
+#include <fmt/ranges.h>
 #include <xapi/easylog.hpp>
+#include <xapi/metrics.hpp>
 #include <rpc_service.hpp>
 
 using namespace async_simple::coro;
@@ -116,6 +119,11 @@ constexpr const char* k_indexHtml = R"html(<!DOCTYPE html>
           <button class="secondary" onclick="steer(0)">Center</button>
           <button class="secondary" onclick="steer(1)">Right</button>
         </div>
+        <div class="row">
+          <label>Live</label>
+          <button id="liveToggle" class="secondary" onclick="toggleLive()">Start</button>
+          <span id="liveText">arrows or WASD drive, Q rotates</span>
+        </div>
         <div class="row camera-control" id="cameraControlRow">
           <label>Camera</label>
           <button id="cameraToggle" class="secondary" onclick="toggleCamera()">Hide Camera</button>
@@ -144,22 +152,93 @@ async function api(path, method='GET') {
   return res.json();
 }
 function setStatus(msg) { document.getElementById('statusText').textContent = msg || ''; }
+function showStatus(data) {
+  document.getElementById('summary').textContent =
+    `Speed level ${data.speedLevel}, motors ${data.motorNum}, mode ${data.ctrlMode}`;
+  const tbody = document.getElementById('motors');
+  tbody.innerHTML = '';
+  for (const motor of data.motors) {
+    const row = document.createElement('tr');
+    row.innerHTML = `<td>${motor.id}</td><td>${motor.speed}</td><td>${motor.pwm}</td><td>${motor.ctrlStep}</td><td>${motor.actualStep}</td>`;
+    tbody.appendChild(row);
+  }
+}
 async function refresh() {
+  if (live) {
+    return;
+  }
   try {
-    const data = await api('/api/status');
-    document.getElementById('summary').textContent =
-      `Speed level ${data.speedLevel}, motors ${data.motorNum}, mode ${data.ctrlMode}`;
-    const tbody = document.getElementById('motors');
-    tbody.innerHTML = '';
-    for (const motor of data.motors) {
-      const row = document.createElement('tr');
-      row.innerHTML = `<td>${motor.id}</td><td>${motor.speed}</td><td>${motor.pwm}</td><td>${motor.ctrlStep}</td><td>${motor.actualStep}</td>`;
-      tbody.appendChild(row);
-    }
+    showStatus(await api('/api/status'));
   } catch (err) {
     setStatus('Failed to load status');
   }
 }
+// live drive: 8 byte setpoints at 20 Hz, acks carry seq for round trip time,
+// status comes as text on the same socket
+let live = null;
+const liveKeys = new Set();
+function toggleLive() {
+  if (live) {
+    live.close();
+    return;
+  }
+  const ws = new WebSocket(`ws://${location.host}/api/drive`);
+  ws.binaryType = 'arraybuffer';
+  const sent = new Map();
+  let seq = 0;
+  let timer = null;
+  ws.onopen = () => {
+    live = ws;
+    document.getElementById('liveToggle').textContent = 'Stop';
+    timer = setInterval(() => {
+      const axis = (plus, minus) => (liveKeys.has(plus) ? 100 : 0) - (liveKeys.has(minus) ? 100 : 0);
+      const frame = new DataView(new ArrayBuffer(8));
+      seq = (seq + 1) & 0xffff;
+      frame.setUint16(0, seq, true);
+      frame.setUint8(2, 1);
+      frame.setInt8(3, axis('d', 'a'));
+      frame.setInt8(4, axis('w', 's'));
+      frame.setInt8(5, liveKeys.has('q') ? 100 : 0);
+      frame.setUint8(6, Number(document.getElementById('speedLevel').value) || 0);
+      sent.set(seq, performance.now());
+      ws.send(frame.buffer);
+    }, 50);
+  };
+  ws.onmessage = (event) => {
+    if (typeof event.data === 'string') {
+      showStatus(JSON.parse(event.data));
+      return;
+    }
+    const ack = new DataView(event.data);
+    const start = sent.get(ack.getUint16(0, true));
+    sent.delete(ack.getUint16(0, true));
+    if (sent.size > 100) {
+      sent.clear();
+    }
+    if (start !== undefined) {
+      document.getElementById('liveText').textContent =
+        `round trip ${(performance.now() - start).toFixed(1)} ms, car ${(ack.getUint32(4, true) / 1000).toFixed(1)} ms`;
+    }
+  };
+  ws.onclose = () => {
+    clearInterval(timer);
+    live = null;
+    document.getElementById('liveToggle').textContent = 'Start';
+    document.getElementById('liveText').textContent = 'stopped';
+  };
+}
+const liveKeyMap = { ArrowUp: 'w', ArrowDown: 's', ArrowLeft: 'a', ArrowRight: 'd' };
+function liveKey(event, down) {
+  const key = liveKeyMap[event.key] || event.key.toLowerCase();
+  if (!live || !['w', 'a', 's', 'd', 'q'].includes(key) || event.target.tagName === 'INPUT') {
+    return;
+  }
+  event.preventDefault();
+  down ? liveKeys.add(key) : liveKeys.delete(key);
+}
+document.addEventListener('keydown', (event) => liveKey(event, true));
+document.addEventListener('keyup', (event) => liveKey(event, false));
+window.addEventListener('blur', () => liveKeys.clear());
 async function setSpeed() {
   const level = document.getElementById('speedLevel').value;
   await api(`/api/speed?level=${level}`, 'POST');
@@ -255,17 +334,95 @@ function toggleCamera() {
 }
 initCameras();
 refresh();
-setInterval(refresh, 1000);
+// status is pushed once a second, one sample of the car for all open pages
+const events = new EventSource('/api/events');
+events.onmessage = (event) => {
+  if (!live) {
+    showStatus(JSON.parse(event.data));
+  }
+};
 </script>
 </body>
 </html>)html";
 
+metrics::Gauge     g_connections {"agvintf_http_connections", "open http connections of the web server"};
+metrics::Histogram g_requestSeconds {"agvintf_http_request_duration_seconds", "time to answer one http request",
+                                     metrics::k_latencyBoundsUs, 1e6};
+metrics::Counter   g_responses[] = {
+    {"agvintf_http_responses_total", "http responses by status class", "code=\"1xx\""},
+    {"agvintf_http_responses_total", "http responses by status class", "code=\"2xx\""},
+    {"agvintf_http_responses_total", "http responses by status class", "code=\"3xx\""},
+    {"agvintf_http_responses_total", "http responses by status class", "code=\"4xx\""},
+    {"agvintf_http_responses_total", "http responses by status class", "code=\"5xx\""}};
+
+std::string getStatusText(int32_t code)
+{
+    switch (code) {
+    case 400: return "Bad Request";
+    case 411: return "Length Required";
+    case 413: return "Content Too Large";
+    case 431: return "Request Header Fields Too Large";
+    case 505: return "HTTP Version Not Supported";
+    default:  return "Error";
+    }
+}
+
 }  // namespace
 
-CarWebServer::CarWebServer(asio::io_context& context, CliCar& cliCar, VideoCtrl& videoCtrl, uint16_t port) :
+// one persistent connection. pipelined requests are parsed in place from the
+// read buffer and answered in order with one write, the buffer and the
+// response string keep their capacity from request to request
+class CarWebServer::Connection : public std::enable_shared_from_this<Connection>
+{
+public:
+    Connection(CarWebServer& server, std::shared_ptr<asio::ip::tcp::socket> socket) :
+        m_server{server},
+        m_socket{std::move(socket)},
+        m_idleTimer{server.m_context},
+        m_buffer(k_readSize)
+    {
+        g_connections.add(1);
+    }
+    ~Connection()
+    {
+        g_connections.add(-1);
+    }
+
+    void start() { read(); }
+
+private:
+    static constexpr size_t k_readSize = 4096;
+    static constexpr auto   k_idleTimeout = std::chrono::seconds(30);
+
+    void read();
+    void process();
+    // route of isAsyncRequest, parsing goes on when the answer is posted back
+    void processAsync();
+    void write();
+    void close();
+
+    CarWebServer&                          m_server;
+    std::shared_ptr<asio::ip::tcp::socket> m_socket;
+    asio::steady_timer                     m_idleTimer;
+    std::vector<char>                      m_buffer;
+    size_t                                 m_begin {0};    // first unparsed byte
+    size_t                                 m_end {0};      // end of read bytes
+    HttpParser                             m_parser;
+    HttpRequest                            m_request;
+    std::string                            m_response;     // of pipelined requests
+    bool                                   m_close {false};
+};
+
+CarWebServer::CarWebServer(asio::io_context& context, CliCar& cliCar, CarFleet& fleet, VideoCtrl& videoCtrl,
+                           uint16_t port) :
     m_context{context},
     m_cliCar{cliCar},
+    m_fleet{fleet},
     m_videoCtrl{videoCtrl},
+    m_cameraHub{context, videoCtrl},
+    m_statusEvents{context, [this](const std::string& car, StatusEvents::Done done) {
+        sampleStatus(car, std::move(done));
+    }},
     m_acceptor{context, asio::ip::tcp::endpoint(asio::ip::tcp::v4(), port)}
 {
     ctrllog::info("car web server listening on port {}", port);
@@ -283,124 +440,194 @@ void CarWebServer::accept()
     auto socket = std::make_shared<asio::ip::tcp::socket>(m_context);
     m_acceptor.async_accept(*socket, [this, socket](const asio::error_code& ec) {
         if (!ec) {
-            handleConnection(socket);
+            std::make_shared<Connection>(*this, socket)->start();
         }
         accept();
     });
 }
 
-void CarWebServer::handleConnection(std::shared_ptr<asio::ip::tcp::socket> socket)
+void CarWebServer::Connection::read()
 {
-    auto request = std::make_shared<std::string>();
-    auto buffer = std::make_shared<std::array<char, 4096>>();
-
-    auto readMore = std::make_shared<std::function<void()>>();
-    *readMore = [this, socket, request, buffer, readMore]() {
-        socket->async_read_some(asio::buffer(*buffer),
-            [this, socket, request, buffer, readMore](const asio::error_code& ec, std::size_t length) {
-                if (ec) {
-                    return;
-                }
-
-                request->append(buffer->data(), length);
-                if (request->find("\r\n\r\n") == std::string::npos) {
-                    (*readMore)();
-                    return;
-                }
-
-                const auto path = getRequestPath(*request);
-                if (path == "/api/camera" || path == "/api/camera/0" || path == "/api/camera/1") {
-                    handleCameraStream(socket, getCameraStreamId(path));
-                    return;
-                }
-
-                const std::string response = handleRequest(*request);
-                asio::async_write(*socket, asio::buffer(response),
-                    [socket](const asio::error_code& writeEc, std::size_t) {
-                        asio::error_code closeEc;
-                        socket->shutdown(asio::ip::tcp::socket::shutdown_both, closeEc);
-                        socket->close(closeEc);
-                        (void)writeEc;
-                    });
-            });
-    };
+    // unparsed tail to front, grow only for a request larger than the buffer,
+    // the parser limits bound the growth
+    if (m_begin) {
+        std::memmove(m_buffer.data(), m_buffer.data() + m_begin, m_end - m_begin);
+        m_end -= m_begin;
+        m_begin = 0;
+    }
+    if (m_end == m_buffer.size()) {
+        m_buffer.resize(m_buffer.size() * 2);
+    }
 
-    (*readMore)();
+    auto self = shared_from_this();
+    m_idleTimer.expires_after(k_idleTimeout);
+    m_idleTimer.async_wait([self](const asio::error_code& ec) {
+        if (!ec) {
+            self->close();
+        }
+    });
+    m_socket->async_read_some(asio::buffer(m_buffer.data() + m_end, m_buffer.size() - m_end),
+        [self](const asio::error_code& ec, std::size_t length) {
+            self->m_idleTimer.cancel();
+            if (ec) {
+                self->close();
+                return;
+            }
+            self->m_end += length;
+            self->process();
+        });
 }
 
-void CarWebServer::handleCameraStream(std::shared_ptr<asio::ip::tcp::socket> socket, int32_t cameraId)
+void CarWebServer::Connection::process()
 {
-    if (!m_videoCtrl.isCameraExist(cameraId)) {
-        const std::string response = httpResponse(404, "Not Found", "text/plain", "camera not found");
-        asio::async_write(*socket, asio::buffer(response),
-            [socket](const asio::error_code&, std::size_t) {
-                asio::error_code ec;
-                socket->shutdown(asio::ip::tcp::socket::shutdown_both, ec);
-                socket->close(ec);
-            });
-        return;
-    }
+    while (!m_close) {
+        const std::string_view data(m_buffer.data() + m_begin, m_end - m_begin);
+        const auto status = m_parser.parse(data, m_request);
+        if (status == HttpParser::Status::More) {
+            break;
+        }
+        if (status == HttpParser::Status::Error) {
+            const int32_t code = m_parser.getErrorCode();
+            m_response += m_server.httpResponse(code, getStatusText(code), "text/plain", getStatusText(code), false);
+            m_close = true;
+            break;
+        }
 
-    static const std::string header =
-        "HTTP/1.1 200 OK\r\n"
-        "Content-Type: multipart/x-mixed-replace; boundary=frame\r\n"
-        "Cache-Control: no-cache, no-store, must-revalidate\r\n"
-        "Pragma: no-cache\r\n"
-        "Connection: keep-alive\r\n"
-        "\r\n";
+        // streams own the socket from here, answer requests before them first
+        const int32_t cameraId = getCameraStreamId(m_request.path);
+        if (cameraId >= 0) {
+            if (!m_response.empty()) {
+                break;
+            }
+            m_server.handleCameraStream(m_socket, cameraId);
+            return;
+        }
+        if ((m_request.method == "GET") && (m_request.path == "/api/events")) {
+            if (!m_response.empty()) {
+                break;
+            }
+            m_server.handleEventStream(m_socket, m_request);
+            return;
+        }
+        if ((m_request.path == "/api/drive") && m_request.hasToken("Upgrade", "websocket")) {
+            if (!m_response.empty()) {
+                break;
+            }
+            m_server.handleDriveSocket(m_socket, m_request, data.substr(m_parser.getLength()));
+            return;
+        }
 
-    asio::async_write(*socket, asio::buffer(header),
-        [this, socket, cameraId](const asio::error_code& ec, std::size_t) {
-            if (!ec) {
-                sendCameraFrame(socket, cameraId);
+        if (isAsyncRequest(m_request)) {
+            if (!m_response.empty()) {
+                break;
             }
-        });
+            processAsync();
+            return;
+        }
+
+        {
+            metrics::ScopedTimer timer(g_requestSeconds);
+            m_response += m_server.handleRequest(m_request);
+        }
+        m_close = !m_request.keepAlive;
+        m_begin += m_parser.getLength();
+        m_parser.reset();
+    }
+
+    if (!m_response.empty()) {
+        write();
+    } else if (m_close) {
+        close();
+    } else {
+        read();
+    }
 }
 
-void CarWebServer::sendCameraFrame(std::shared_ptr<asio::ip::tcp::socket> socket, int32_t cameraId)
+void CarWebServer::Connection::processAsync()
 {
-    auto jpeg = std::make_shared<std::vector<uint8_t>>();
-    if (!m_videoCtrl.getWebFrame(cameraId, *jpeg) || jpeg->empty()) {
-        auto timer = std::make_shared<asio::steady_timer>(m_context, std::chrono::milliseconds(100));
-        timer->async_wait([this, socket, cameraId, timer](const asio::error_code& ec) {
-            if (!ec) {
-                sendCameraFrame(socket, cameraId);
+    // rpc io thread completes the answer, the connection state is only
+    // touched again on the io thread, as in sampleStatus
+    auto self = shared_from_this();
+    const auto start = std::chrono::steady_clock::now();
+    m_server.handleAsyncRequest(m_request).start([self, start](async_simple::Try<std::string> result) {
+        asio::post(self->m_server.m_context, [self, start, result = std::move(result)]() mutable {
+            if (result.hasError()) {
+                self->m_response += self->m_server.httpResponse(500, "Internal Server Error", "text/plain",
+                                                                "internal error", self->m_request.keepAlive);
+            } else {
+                self->m_response += std::move(result.value());
             }
+            g_requestSeconds.observe(std::chrono::duration_cast<std::chrono::microseconds>(
+                std::chrono::steady_clock::now() - start).count());
+            self->m_close = !self->m_request.keepAlive;
+            self->m_begin += self->m_parser.getLength();
+            self->m_parser.reset();
+            self->process();
         });
+    });
+}
+
+void CarWebServer::Connection::write()
+{
+    auto self = shared_from_this();
+    asio::async_write(*m_socket, asio::buffer(m_response), [self](const asio::error_code& ec, std::size_t) {
+        self->m_response.clear();
+        if (ec || self->m_close) {
+            self->close();
+            return;
+        }
+        self->process();
+    });
+}
+
+void CarWebServer::Connection::close()
+{
+    asio::error_code ec;
+    m_socket->shutdown(asio::ip::tcp::socket::shutdown_both, ec);
+    m_socket->close(ec);
+}
+
+void CarWebServer::handleCameraStream(std::shared_ptr<asio::ip::tcp::socket> socket, int32_t cameraId)
+{
+    if (!m_videoCtrl.isCameraExist(cameraId)) {
+        sendAndClose(std::move(socket), httpResponse(404, "Not Found", "text/plain", "camera not found", false));
         return;
     }
 
-    auto partHeader = std::make_shared<std::string>(fmt::format(
-        "--frame\r\nContent-Type: image/jpeg\r\nContent-Length: {}\r\n\r\n", jpeg->size()));
+    m_cameraHub.subscribe(std::move(socket), cameraId);
+}
 
-    asio::async_write(*socket, asio::buffer(*partHeader),
-        [this, socket, cameraId, partHeader, jpeg](const asio::error_code& ec, std::size_t) {
-            if (ec) {
-                return;
-            }
+void CarWebServer::sendAndClose(std::shared_ptr<asio::ip::tcp::socket> socket, std::string response)
+{
+    auto data = std::make_shared<std::string>(std::move(response));
+    asio::async_write(*socket, asio::buffer(*data), [socket, data](const asio::error_code&, std::size_t) {
+        asio::error_code ec;
+        socket->shutdown(asio::ip::tcp::socket::shutdown_both, ec);
+        socket->close(ec);
+    });
+}
 
-            asio::async_write(*socket, asio::buffer(*jpeg),
-                [this, socket, cameraId](const asio::error_code& writeEc, std::size_t) {
-                    if (writeEc) {
-                        return;
-                    }
-
-                    auto timer = std::make_shared<asio::steady_timer>(m_context, std::chrono::milliseconds(100));
-                    timer->async_wait([this, socket, cameraId, timer](const asio::error_code& timerEc) {
-                        if (!timerEc) {
-                            sendCameraFrame(socket, cameraId);
-                        }
-                    });
-                });
-        });
+void CarWebServer::handleEventStream(std::shared_ptr<asio::ip::tcp::socket> socket, const HttpRequest& request)
+{
+    const auto car = getQueryParam(request.query, "car");
+    if (!car.empty() && m_fleet.getHosts(car).empty()) {
+        sendAndClose(std::move(socket), httpResponse(404, "Not Found", "application/json",
+                                                     R"({"ok":false,"error":"no such car"})", false));
+        return;
+    }
+
+    m_statusEvents.subscribe(std::move(socket), car);
 }
 
-int32_t CarWebServer::getCameraStreamId(const std::string& path)
+int32_t CarWebServer::getCameraStreamId(std::string_view path)
 {
+    if (path == "/api/camera" || path == "/api/camera/0") {
+        return 0;
+    }
     if (path == "/api/camera/1") {
         return 1;
     }
-    return 0;
+    return -1;
 }
 
 std::string CarWebServer::buildCameraInfoJson()
@@ -418,41 +645,49 @@ std::string CarWebServer::buildCameraInfoJson()
     return body.str();
 }
 
-std::string CarWebServer::getRequestPath(const std::string& request)
+Lazy<std::string> CarWebServer::buildMetricsText()
 {
-    const auto lineEnd = request.find("\r\n");
-    if (lineEnd == std::string::npos) {
-        return {};
-    }
-
-    const std::string requestLine = request.substr(0, lineEnd);
-    std::istringstream stream(requestLine);
-    std::string method;
-    std::string target;
-    std::string httpVersion;
-    stream >> method >> target >> httpVersion;
+    // agvintf from its registry, agvctrl of every fleet car with one broadcast,
+    // their samples are labelled with the car. the local agvctrl is the fleet
+    // car "local", in one binary it shares the registry rendered here. a dead
+    // car costs this scrape one rpc timeout, not the io thread
+    std::string local;
+    metrics::render(local);
+    const auto replies = co_await m_fleet.broadcastAsync<getMetrics>();
 
-    const auto queryPos = target.find('?');
-    if (queryPos != std::string::npos) {
-        return target.substr(0, queryPos);
+    std::vector<std::string> labels;
+    labels.reserve(replies.size());
+    for (const auto& reply : replies) {
+        labels.push_back(fmt::format("car=\"{}\"", reply.car));
+    }
+    std::vector<metrics::Exposition> parts {{local, {}}};
+    for (size_t i = 0; i < replies.size(); i++) {
+        if (replies[i].value) {
+            parts.push_back({*replies[i].value, labels[i]});
+        }
     }
-    return target;
+
+    std::string text;
+    text.reserve(local.size() * (parts.size() + 1));
+    metrics::merge(parts, text);
+    co_return text;
 }
 
-std::string CarWebServer::httpResponse(int code, const std::string& status,
-                                       const std::string& contentType, const std::string& body)
+std::string CarWebServer::httpResponse(int code, const std::string& status, const std::string& contentType,
+                                       const std::string& body, bool keepAlive)
 {
+    g_responses[std::clamp(code / 100, 1, 5) - 1].inc();
     return fmt::format(
         "HTTP/1.1 {} {}\r\n"
         "Content-Type: {}\r\n"
         "Content-Length: {}\r\n"
-        "Connection: close\r\n"
+        "Connection: {}\r\n"
         "Access-Control-Allow-Origin: *\r\n"
         "\r\n{}",
-        code, status, contentType, body.size(), body);
+        code, status, contentType, body.size(), keepAlive ? "keep-alive" : "close", body);
 }
 
-std::string CarWebServer::urlDecode(const std::string& value)
+std::string CarWebServer::urlDecode(std::string_view value)
 {
     std::string decoded;
     decoded.reserve(value.size());
@@ -479,17 +714,16 @@ std::string CarWebServer::urlDecode(const std::string& value)
     return decoded;
 }
 
-std::string CarWebServer::getQueryParam(const std::string& query, const std::string& key)
+std::string CarWebServer::getQueryParam(std::string_view query, std::string_view key)
 {
-    const std::string prefix = key + "=";
     std::size_t start = 0;
     while (start < query.size()) {
         const auto end = query.find('&', start);
-        const auto token = query.substr(start, end == std::string::npos ? std::string::npos : end - start);
-        if (token.rfind(prefix, 0) == 0) {
-            return urlDecode(token.substr(prefix.size()));
+        const auto token = query.substr(start, end == std::string_view::npos ? std::string_view::npos : end - start);
+        if ((token.size() > key.size()) && token.starts_with(key) && (token[key.size()] == '=')) {
+            return urlDecode(token.substr(key.size() + 1));
         }
-        if (end == std::string::npos) {
+        if (end == std::string_view::npos) {
             break;
         }
         start = end + 1;
@@ -497,13 +731,76 @@ std::string CarWebServer::getQueryParam(const std::string& query, const std::str
     return {};
 }
 
-std::string CarWebServer::buildStatusJson()
+std::string CarWebServer::buildStatusJson(const std::string& car)
 {
-    auto& client = m_cliCar.getClient();
-    const int32_t motorNum = rpc_call_int_param<getMotorNum>(client);
-    const int32_t speedLevel = rpc_call_int_param<getMotorSpeedLevel>(client);
-    const int32_t ctrlMode = rpc_call_int_param<getCtrlMode>(client);
+    const int32_t motorNum = callCar<getMotorNum>(car);
+    const int32_t speedLevel = callCar<getMotorSpeedLevel>(car);
+    const int32_t ctrlMode = callCar<getCtrlMode>(car);
+
+    std::vector<int32_t> motors;
+    for (int32_t ii = 1; ii <= motorNum; ++ii) {
+        motors.push_back(callCar<getActualSpeed>(car, ii));
+        motors.push_back(callCar<getMotorPwm>(car, ii));
+        motors.push_back(callCar<getCtrlSteps>(car, ii));
+        motors.push_back(callCar<getActualSteps>(car, ii));
+    }
+    return formatStatusJson(speedLevel, motorNum, ctrlMode, motors);
+}
 
+void CarWebServer::sampleStatus(const std::string& car, StatusEvents::Done done)
+{
+    if (car.empty()) {
+        // local agvctrl, a function call in one binary
+        done(buildStatusJson(car));
+        return;
+    }
+
+    sampleFleetStatus(car).start([this, done = std::move(done)](async_simple::Try<std::string> result) {
+        std::string json = result.hasError() ? formatStatusJson(0, 0, 0, {}) : std::move(result.value());
+        asio::post(m_context, [done, json = std::move(json)]() { done(json); });
+    });
+}
+
+async_simple::coro::Lazy<std::string> CarWebServer::sampleFleetStatus(std::string car)
+{
+    // calls of a step go out together, an offline car stops after the first
+    // step, so it costs one rpc timeout per sample
+    using Call = async_simple::coro::Lazy<std::optional<int32_t>>;
+    auto valueOf = [](const async_simple::Try<std::optional<int32_t>>& result) -> std::optional<int32_t> {
+        return result.hasError() ? std::nullopt : result.value();
+    };
+
+    std::vector<Call> calls;
+    calls.push_back(m_fleet.callAsync<getMotorNum>(car));
+    calls.push_back(m_fleet.callAsync<getMotorSpeedLevel>(car));
+    calls.push_back(m_fleet.callAsync<getCtrlMode>(car));
+    const auto head = co_await async_simple::coro::collectAll(std::move(calls));
+    const auto motorNum = valueOf(head[0]);
+    const auto speedLevel = valueOf(head[1]);
+    const auto ctrlMode = valueOf(head[2]);
+    if (!motorNum || !speedLevel || !ctrlMode) {
+        co_return formatStatusJson(speedLevel.value_or(0), 0, ctrlMode.value_or(0), {});
+    }
+
+    calls.clear();
+    for (int32_t ii = 1; ii <= *motorNum; ++ii) {
+        calls.push_back(m_fleet.callAsync<getActualSpeed>(car, ii));
+        calls.push_back(m_fleet.callAsync<getMotorPwm>(car, ii));
+        calls.push_back(m_fleet.callAsync<getCtrlSteps>(car, ii));
+        calls.push_back(m_fleet.callAsync<getActualSteps>(car, ii));
+    }
+    const auto results = co_await async_simple::coro::collectAll(std::move(calls));
+    std::vector<int32_t> motors;
+    motors.reserve(results.size());
+    for (const auto& result : results) {
+        motors.push_back(valueOf(result).value_or(0));
+    }
+    co_return formatStatusJson(*speedLevel, *motorNum, *ctrlMode, motors);
+}
+
+std::string CarWebServer::formatStatusJson(int32_t speedLevel, int32_t motorNum, int32_t ctrlMode,
+                                           const std::vector<int32_t>& motors)
+{
     std::ostringstream body;
     body << fmt::format(R"({{"speedLevel":{},"motorNum":{},"ctrlMode":{},"motors":[)",
                         speedLevel, motorNum, ctrlMode);
@@ -512,111 +809,224 @@ std::string CarWebServer::buildStatusJson()
         if (ii > 1) {
             body << ',';
         }
+        const int32_t* motor = motors.data() + (ii - 1) * 4;
         body << fmt::format(
             R"({{"id":{},"speed":{},"pwm":{},"ctrlStep":{},"actualStep":{}}})",
-            ii,
-            rpc_call_int_param<getActualSpeed>(client, ii),
-            rpc_call_int_param<getMotorPwm>(client, ii),
-            rpc_call_int_param<getCtrlSteps>(client, ii),
-            rpc_call_int_param<getActualSteps>(client, ii));
+            ii, motor[0], motor[1], motor[2], motor[3]);
     }
 
     body << "]}";
     return body.str();
 }
 
-std::string CarWebServer::handleRequest(const std::string& request)
+Lazy<std::string> CarWebServer::buildFleetJson()
 {
-    const auto lineEnd = request.find("\r\n");
-    if (lineEnd == std::string::npos) {
-        return httpResponse(400, "Bad Request", "text/plain", "bad request");
+    // one broadcast, a dead car costs one timeout for the whole list
+    std::ostringstream body;
+    body << R"({"cars":[)";
+    bool first = true;
+    for (const auto& reply : co_await m_fleet.broadcastAsync<getMotorSpeedLevel>()) {
+        if (!first) {
+            body << ',';
+        }
+        first = false;
+        body << fmt::format(R"({{"name":"{}","online":{},"speedLevel":{}}})", reply.car,
+                            reply.value ? "true" : "false", reply.value.value_or(0));
     }
+    body << "]}";
+    co_return body.str();
+}
 
-    const std::string requestLine = request.substr(0, lineEnd);
-    std::istringstream stream(requestLine);
-    std::string method;
-    std::string target;
-    std::string httpVersion;
-    stream >> method >> target >> httpVersion;
+Lazy<std::optional<std::string>> CarWebServer::buildHistoryJson(std::string car, std::string_view query)
+{
+    // chart-ready: one time axis, min/max/mean series per motor
+    const auto metric = getQueryParam(query, "metric");
+    int64_t from = 0;
+    int64_t to = 0;
+    int32_t resolution = 0;
+    if (!getQueryInt<int64_t>(query, "from", -600000, from) || !getQueryInt<int64_t>(query, "to", 0, to)
+        || !getQueryInt<int32_t>(query, "resolution", 0, resolution)) {
+        co_return std::nullopt;
+    }
 
-    std::string path = target;
-    std::string query;
-    const auto queryPos = target.find('?');
-    if (queryPos != std::string::npos) {
-        path = target.substr(0, queryPos);
-        query = target.substr(queryPos + 1);
+    const auto series = co_await callCarAsync<getTelemetryHistory>(
+        car, metric.empty() ? std::string{"speed"} : metric, from, to, resolution);
+    if (!series.resolution) {
+        co_return R"({"ok":false,"error":"unknown metric"})";
     }
+    auto joinSeries = [](const std::vector<std::vector<int32_t>>& values) {
+        std::string text = "[";
+        for (size_t i = 0; i < values.size(); i++) {
+            text += fmt::format("{}[{}]", i ? "," : "", fmt::join(values[i], ","));
+        }
+        return text + "]";
+    };
+    co_return fmt::format(R"({{"metric":"{}","resolution":{},"time":[{}],"min":{},"max":{},"mean":{}}})",
+                          series.metric, series.resolution, fmt::join(series.time, ","),
+                          joinSeries(series.min), joinSeries(series.max), joinSeries(series.mean));
+}
+
+std::string CarWebServer::handleRequest(const HttpRequest& request)
+{
+    // local car, rpc_call answers in place so the coroutine is done at once
+    return syncAwait(handleCarRequest(request, {}));
+}
+
+Lazy<std::string> CarWebServer::handleCarRequest(HttpRequest request, std::string car)
+{
+    const auto method = request.method;
+    const auto path = request.path;
+    const auto query = request.query;
+    auto respond = [&](int code, const std::string& status, const std::string& contentType,
+                       const std::string& body) {
+        return httpResponse(code, status, contentType, body, request.keepAlive);
+    };
 
     if (method == "GET" && (path == "/" || path == "/index.html")) {
-        return httpResponse(200, "OK", "text/html; charset=utf-8", k_indexHtml);
+        co_return respond(200, "OK", "text/html; charset=utf-8", k_indexHtml);
     }
 
     if (method == "GET" && path == "/api/status") {
-        return httpResponse(200, "OK", "application/json", buildStatusJson());
+        if (car.empty()) {
+            co_return respond(200, "OK", "application/json", buildStatusJson(car));
+        }
+        const auto body = co_await sampleFleetStatus(car);
+        co_return respond(200, "OK", "application/json", body);
+    }
+
+    if (method == "GET" && path == "/api/history") {
+        const auto body = co_await buildHistoryJson(car, query);
+        if (!body) {
+            co_return respond(400, "Bad Request", "application/json",
+                              R"({"ok":false,"error":"from, to and resolution must be integers"})");
+        }
+        co_return respond(200, "OK", "application/json", *body);
     }
 
     if (method == "GET" && path == "/api/camera/info") {
-        return httpResponse(200, "OK", "application/json", buildCameraInfoJson());
+        co_return respond(200, "OK", "application/json", buildCameraInfoJson());
     }
 
     if (method == "POST" && path == "/api/stop") {
-        rpc_call_void_param<setAllMotorState>(m_cliCar.getClient(), 0);
-        return httpResponse(200, "OK", "application/json", R"({"ok":true})");
+        co_await callCarAsync<setAllMotorState>(car, 0);
+        co_return respond(200, "OK", "application/json", R"({"ok":true})");
     }
 
     if (method == "POST" && path == "/api/speed") {
         const auto levelStr = getQueryParam(query, "level");
         if (levelStr.empty()) {
-            return httpResponse(400, "Bad Request", "application/json", R"({"ok":false,"error":"missing level"})");
+            co_return respond(400, "Bad Request", "application/json", R"({"ok":false,"error":"missing level"})");
         }
-        const int32_t level = std::stoi(levelStr);
-        rpc_call_int_param<setMotorSpeedLevel>(m_cliCar.getClient(), level);
-        return httpResponse(200, "OK", "application/json", R"({"ok":true})");
+        int32_t level = 0;
+        if (!getQueryInt<int32_t>(query, "level", 0, level)) {
+            co_return respond(400, "Bad Request", "application/json",
+                              R"({"ok":false,"error":"level must be an integer"})");
+        }
+        co_await callCarAsync<setMotorSpeedLevel>(car, level);
+        co_return respond(200, "OK", "application/json", R"({"ok":true})");
     }
 
     if (method == "POST" && path == "/api/step") {
         const auto directionStr = getQueryParam(query, "direction");
         const auto stepsStr = getQueryParam(query, "steps");
         if (directionStr.empty() || stepsStr.empty()) {
-            return httpResponse(400, "Bad Request", "application/json",
-                                R"({"ok":false,"error":"missing direction or steps"})");
+            co_return respond(400, "Bad Request", "application/json",
+                              R"({"ok":false,"error":"missing direction or steps"})");
         }
 
-        const int32_t direction = std::stoi(directionStr);
-        const int32_t steps = std::stoi(stepsStr);
-        const int32_t motorNum = rpc_call_int_param<getMotorNum>(m_cliCar.getClient());
+        int32_t direction = 0;
+        int32_t steps = 0;
+        if (!getQueryInt<int32_t>(query, "direction", 0, direction)
+            || !getQueryInt<int32_t>(query, "steps", 0, steps)) {
+            co_return respond(400, "Bad Request", "application/json",
+                              R"({"ok":false,"error":"direction and steps must be integers"})");
+        }
+        const int32_t motorNum = co_await callCarAsync<getMotorNum>(car);
 
         if (direction == 0) {
-            rpc_call_int_param<setCarSteps>(m_cliCar.getClient(), CarDirection::dirUp, steps);
+            co_await callCarAsync<setCarSteps>(car, CarDirection::dirUp, steps);
         } else if (direction == 1) {
-            rpc_call_int_param<setCarSteps>(m_cliCar.getClient(), CarDirection::dirLeft, steps);
+            co_await callCarAsync<setCarSteps>(car, CarDirection::dirLeft, steps);
         } else if (direction == 2) {
             if (motorNum < 4) {
-                return httpResponse(400, "Bad Request", "application/json",
-                                    R"({"ok":false,"error":"rotation requires 4 motors"})");
+                co_return respond(400, "Bad Request", "application/json",
+                                  R"({"ok":false,"error":"rotation requires 4 motors"})");
             }
-            rpc_call_int_param<setCarSteps>(m_cliCar.getClient(), CarDirection::dirRotation, steps);
+            co_await callCarAsync<setCarSteps>(car, CarDirection::dirRotation, steps);
         } else {
-            return httpResponse(400, "Bad Request", "application/json", R"({"ok":false,"error":"invalid direction"})");
+            co_return respond(400, "Bad Request", "application/json", R"({"ok":false,"error":"invalid direction"})");
         }
 
-        return httpResponse(200, "OK", "application/json", R"({"ok":true})");
+        co_return respond(200, "OK", "application/json", R"({"ok":true})");
     }
 
     if (method == "POST" && path == "/api/steer") {
         const auto dirStr = getQueryParam(query, "dir");
-        const auto timeStr = getQueryParam(query, "time");
         if (dirStr.empty()) {
-            return httpResponse(400, "Bad Request", "application/json", R"({"ok":false,"error":"missing dir"})");
+            co_return respond(400, "Bad Request", "application/json", R"({"ok":false,"error":"missing dir"})");
         }
 
-        const int32_t dir = std::stoi(dirStr);
-        const uint32_t time = timeStr.empty() ? 0U : static_cast<uint32_t>(std::stoul(timeStr));
-        rpc_call_int_param<setSteerTurn>(m_cliCar.getClient(), dir, time);
-        return httpResponse(200, "OK", "application/json", R"({"ok":true})");
+        int32_t dir = 0;
+        uint32_t time = 0;
+        if (!getQueryInt<int32_t>(query, "dir", 0, dir) || !getQueryInt<uint32_t>(query, "time", 0U, time)) {
+            co_return respond(400, "Bad Request", "application/json",
+                              R"({"ok":false,"error":"dir and time must be integers"})");
+        }
+        co_await callCarAsync<setSteerTurn>(car, dir, time);
+        co_return respond(200, "OK", "application/json", R"({"ok":true})");
+    }
+
+    co_return respond(404, "Not Found", "text/plain", "not found");
+}
+
+bool CarWebServer::isAsyncRequest(const HttpRequest& request)
+{
+    // ?car=name addresses a car of fleet, without it the local car
+    if (!getQueryParam(request.query, "car").empty()) {
+        return true;
+    }
+    if (request.method == "GET") {
+        return (request.path == "/metrics") || (request.path == "/api/fleet");
     }
+    return (request.method == "POST") && (request.path == "/api/fleet/stop");
+}
 
-    return httpResponse(404, "Not Found", "text/plain", "not found");
+Lazy<std::string> CarWebServer::handleAsyncRequest(HttpRequest request)
+{
+    // rpc calls go out together and resume on an rpc io thread, an offline
+    // car costs this request one rpc timeout, other connections go on
+    auto respond = [&](int code, const std::string& status, const std::string& contentType,
+                       const std::string& body) {
+        return httpResponse(code, status, contentType, body, request.keepAlive);
+    };
+
+    if (request.path == "/metrics") {
+        const auto text = co_await buildMetricsText();
+        co_return respond(200, "OK", "text/plain; version=0.0.4; charset=utf-8", text);
+    }
+
+    if (request.path == "/api/fleet") {
+        const auto body = co_await buildFleetJson();
+        co_return respond(200, "OK", "application/json", body);
+    }
+
+    if (request.path == "/api/fleet/stop") {
+        int32_t failed = 0;
+        const auto replies = co_await m_fleet.broadcastAsync<setAllMotorState>(0);
+        for (const auto& reply : replies) {
+            failed += reply.value ? 0 : 1;
+        }
+        co_return respond(200, "OK", "application/json",
+                          fmt::format(R"({{"ok":{},"cars":{},"failed":{}}})", failed ? "false" : "true",
+                                      replies.size(), failed));
+    }
+
+    // any route of a fleet car
+    const auto car = getQueryParam(request.query, "car");
+    if (m_fleet.getHosts(car).empty()) {
+        co_return respond(404, "Not Found", "application/json", R"({"ok":false,"error":"no such car"})");
+    }
+    co_return co_await handleCarRequest(request, car);
 }
 
 }  // namespace cli
@@ -1,7 +1,11 @@
 // SPDX-License-Identifier: GPL-2.0
 
+#include <chrono>
+#include <fstream>
+#include <thread>
 #include <xapi/cmn_singleton.hpp>
 #include <xapi/easylog.hpp>
+#include <fmt/ranges.h>
 #include <cli_impl.h>
 #include <cli_car.hpp>
 #include <video/sound_intf.hpp>
@@ -21,7 +25,9 @@ void CliCar::initCliCommand(std::unique_ptr<Menu>& rootMenu)
     auto cliMenu = std::make_unique<Menu>(name);
     auto& soundIntf = cmn::getSingletonInstance<SoundIntf>();
 
+#ifndef CARCTRL_SINGLE_BINARY
     syncAwait(m_client.connect("localhost", std::to_string(rpc_port)));
+#endif
 
     cliMenu->Insert("show-param",
                     [&](std::ostream& out) {
@@ -158,6 +164,111 @@ void CliCar::initCliCommand(std::unique_ptr<Menu>& rootMenu)
                         rpc_call_int_param<setSteerTurn>(m_client, dir, time);
                     },
                     "set steer direction and time. dir: >0 left, =0 stop, <0 right. time: 0 stop, >0 time");
+    cliMenu->Insert("show-watchdog",
+                    [&](std::ostream& out) {
+                        int32_t trips = rpc_call_int_param<getWatchdogTrips>(m_client);
+                        int32_t latency = rpc_call_int_param<getWatchdogLatency>(m_client);
+                        out << fmt::format("watchdog trips={} max latency={} us\n", trips, latency);
+                    },
+                    "show deadman watchdog trips and trigger latency");
+    cliMenu->Insert("show-jitter",
+                    [&](std::ostream& out) {
+                        auto jitter = rpc_call_param<getLoopJitter>(m_client);
+                        out << fmt::format("speed loop: policy {} pwm step {} us wakes {}\n",
+                                           jitter.policy, jitter.periodUs, jitter.ticks);
+                        out << fmt::format("max wake latency {} us, max period error {} us\n",
+                                           jitter.maxWakeLatency, jitter.maxPeriodError);
+                        out << fmt::format("{:>14} {:>12} {:>12}\n", "bucket(us)", "wake", "period");
+                        for (size_t i = 0; i < jitter.wakeHist.size() && i < jitter.periodHist.size(); i++) {
+                            if (!jitter.wakeHist[i] && !jitter.periodHist[i]) {
+                                continue;
+                            }
+                            uint32_t low = i ? (1u << (i - 1)) : 0;
+                            std::string range = (i + 1 < jitter.wakeHist.size())
+                                ? fmt::format("{}-{}", low, (1u << i) - 1) : fmt::format(">={}", low);
+                            out << fmt::format("{:>14} {:>12} {:>12}\n", range,
+                                               jitter.wakeHist[i], jitter.periodHist[i]);
+                        }
+                    },
+                    "show speed loop wake latency and period error histogram");
+    cliMenu->Insert("show-encoder",
+                    [&](std::ostream& out) {
+                        constexpr std::string_view faultName[] = {"-", "stall", "slip"};
+                        auto state = rpc_call_param<getEncoderState>(m_client);
+                        out << fmt::format("{:>6} {:>6} {:>12} {:>10} {:>10} {:>10} {:>8} {:>6} {:>7} {:>6}\n",
+                                           "motor", "input", "edges", "dropped", "glitches", "period(us)",
+                                           "rate", "fault", "stalls", "slips");
+                        for (size_t i = 0; i < state.size(); i++) {
+                            const auto& item = state[i];
+                            auto fault = ((item.fault >= 0) && (item.fault <= 2)) ? faultName[item.fault] : "?";
+                            out << fmt::format("{:>6} {:>6} {:>12} {:>10} {:>10} {:>10} {:>8} {:>6} {:>7} {:>6}\n",
+                                               i + 1, item.input, item.edges, item.dropped, item.glitches,
+                                               item.periodUs, item.rate, fault, item.stalls, item.slips);
+                        }
+                    },
+                    "show encoder edges, dropped edges, glitches, stalls and slips of each motor");
+    cliMenu->Insert("save-record", {"file: local file for flightrec", "seconds: time to record"},
+                    [&](std::ostream& out, std::string fileName, int32_t seconds) {
+                        // compact blocks of the flight recorder, about 15 bytes per tick over the link
+                        std::ofstream file(fileName, std::ios::binary | std::ios::trunc);
+                        if (!file.is_open()) {
+                            out << "fail to open " << fileName << "\n";
+                            return;
+                        }
+
+                        auto chunk = rpc_call_param<getFlightRecords>(m_client, uint64_t{0});
+                        if (!chunk.lastSeq) {
+                            out << "flight recorder of agvctrl is off\n";
+                            return;
+                        }
+                        file << chunk.header;
+                        uint64_t firstSeq = chunk.lastSeq;
+                        size_t bytes = 0;
+                        auto end = std::chrono::steady_clock::now() + std::chrono::seconds(seconds);
+                        while (std::chrono::steady_clock::now() < end) {
+                            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+                            chunk = rpc_call_param<getFlightRecords>(m_client, chunk.lastSeq);
+                            file << chunk.blocks;
+                            bytes += chunk.blocks.size();
+                        }
+                        uint64_t records = chunk.lastSeq - std::min(chunk.lastSeq, firstSeq);
+                        out << fmt::format("{} records, {} bytes, {:.1f} bytes/record\n", records, bytes,
+                                           records ? (double)bytes / records : 0.0);
+                    },
+                    "save flight records of agvctrl to a local file, decode with flightrec");
+    cliMenu->Insert("calibrate",
+                    [&](std::ostream& out) {
+                        if (rpc_call_int_param<autoCalibrate>(m_client, 1) < 0) {
+                            out << "calibrate is running or not possible\n";
+                            return;
+                        }
+                        out << "put car on a stand, wheels run forward through pwm sweep\n";
+
+                        CalibrateState state;
+                        int32_t progress = -1;
+                        do {
+                            std::this_thread::sleep_for(std::chrono::seconds(1));
+                            state = rpc_call_param<getCalibrateState>(m_client);
+                            if (state.progress != progress) {
+                                progress = state.progress;
+                                out << fmt::format("progress {}%\n", progress) << std::flush;
+                            }
+                        } while (state.state == CALIBRATE_RUNNING);
+
+                        for (size_t motor = 0; motor < state.rate.size(); motor++) {
+                            out << fmt::format("motor {} rate: {}\n", motor + 1, fmt::join(state.rate[motor], " "));
+                        }
+                        for (size_t level = 0; level < state.pwm.size(); level++) {
+                            out << fmt::format("level {} pwm: {}\n", level, fmt::join(state.pwm[level], " "));
+                        }
+                        out << state.message << "\n";
+                    },
+                    "calibrate pwm table of speed levels, car on a stand");
+    cliMenu->Insert("calibrate-cancel",
+                    [&](std::ostream& out) {
+                        rpc_call_int_param<autoCalibrate>(m_client, 0);
+                    },
+                    "cancel pwm calibration");
     cliMenu->Insert("stop-motor",
                     [&](std::ostream& out) {
                         rpc_call_void_param<setAllMotorState>(m_client, 0);
@@ -0,0 +1,138 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <chrono>
+#include <sstream>
+#include <fmt/format.h>
+#include <fmt/ranges.h>
+#include <cli_impl.h>
+#include <cli_fleet.hpp>
+#include <rpc_service.hpp>
+
+namespace cli
+{
+namespace
+{
+
+std::vector<std::string> splitHosts(const std::string& hosts)
+{
+    std::vector<std::string> items;
+    std::istringstream stream(hosts);
+    std::string item;
+    while (std::getline(stream, item, ',')) {
+        if (!item.empty()) {
+            items.push_back(item);
+        }
+    }
+    return items;
+}
+
+int64_t elapsedUs(std::chrono::steady_clock::time_point start)
+{
+    return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+}  // namespace
+
+void CliFleet::initCliCommand(std::unique_ptr<Menu>& rootMenu)
+{
+    const std::string name = getGroupName();
+    auto cliMenu = std::make_unique<Menu>(name);
+
+#ifndef CARCTRL_SINGLE_BINARY
+    m_fleet.addCar("local", {fmt::format("localhost:{}", rpc_port)});
+#endif
+    m_fleet.loadFile(k_fleetFile);
+
+    cliMenu->Insert("show",
+                    [&](std::ostream& out) {
+                        auto start = std::chrono::steady_clock::now();
+                        auto replies = m_fleet.broadcast<getMotorSpeedLevel>();
+                        out << fmt::format("{} cars, polled in {} us\n", replies.size(), elapsedUs(start));
+                        for (const auto& reply : replies) {
+                            out << fmt::format("{:<12} {:<8} {:<10} {}\n", reply.car,
+                                               reply.value ? "online" : "offline",
+                                               reply.value ? fmt::format("level {}", *reply.value) : "-",
+                                               fmt::join(m_fleet.getHosts(reply.car), ","));
+                        }
+                    },
+                    "show cars of fleet, their hosts and speed level");
+
+    cliMenu->Insert("add", {"name: car name", "hosts: host:port, comma separated for more addresses"},
+                    [&](std::ostream& out, const std::string& car, const std::string& hosts) {
+                        if (m_fleet.addCar(car, splitHosts(hosts)) < 0) {
+                            out << "fail to add car " << car << "\n";
+                        }
+                    },
+                    "add car to fleet");
+
+    cliMenu->Insert("remove", {"name: car name"},
+                    [&](std::ostream& out, const std::string& car) {
+                        if (m_fleet.removeCar(car) < 0) {
+                            out << "no car " << car << "\n";
+                        }
+                    },
+                    "remove car from fleet");
+
+    cliMenu->Insert("show-param", {"name: car name"},
+                    [&](std::ostream& out, const std::string& car) {
+                        auto motorNum = m_fleet.call<getMotorNum>(car);
+                        if (!motorNum) {
+                            out << "car " << car << " does not answer\n";
+                            return;
+                        }
+                        out << "speed level: " << m_fleet.call<getMotorSpeedLevel>(car).value_or(0) << "\n";
+                        out << "motor number: " << *motorNum << "\n";
+                        for (int32_t ii = 1; ii <= *motorNum; ii++) {
+                            out << fmt::format("motor {} pwm={} step={}\n", ii,
+                                               m_fleet.call<getMotorPwm>(car, ii).value_or(0),
+                                               m_fleet.call<getActualSteps>(car, ii).value_or(0));
+                        }
+                    },
+                    "show speed level, pwm and steps of one car");
+
+    cliMenu->Insert("set-speedlevel", {"name: car name, all for fleet", "speed: 1-9 for speed level"},
+                    [&](std::ostream& out, const std::string& car, int32_t speed) {
+                        if (car != "all") {
+                            if (!m_fleet.call<setMotorSpeedLevel>(car, speed)) {
+                                out << "car " << car << " does not answer\n";
+                            }
+                            return;
+                        }
+                        for (const auto& reply : m_fleet.broadcast<setMotorSpeedLevel>(speed)) {
+                            if (!reply.value) {
+                                out << "car " << reply.car << " does not answer\n";
+                            }
+                        }
+                    },
+                    "set speed level of one car or of all cars");
+
+    cliMenu->Insert("stop", {"name: car name, all for fleet"},
+                    [&](std::ostream& out, const std::string& car) {
+                        if (car != "all") {
+                            if (!m_fleet.call<setAllMotorState>(car, 0)) {
+                                out << "car " << car << " does not answer\n";
+                            }
+                            return;
+                        }
+
+                        // all cars at once, done after the slowest answer
+                        auto start = std::chrono::steady_clock::now();
+                        auto replies = m_fleet.broadcast<setAllMotorState>(0);
+                        int32_t failed = 0;
+                        for (const auto& reply : replies) {
+                            if (!reply.value) {
+                                out << "car " << reply.car << " does not answer\n";
+                                failed++;
+                            }
+                        }
+                        out << fmt::format("stopped {} of {} cars in {} us\n", replies.size() - failed,
+                                           replies.size(), elapsedUs(start));
+                    },
+                    "stop all motors of one car or of all cars");
+
+    if (rootMenu != nullptr) {
+        rootMenu->Insert(std::move(cliMenu));
+    }
+}
+
+}  // namespace cli
@@ -3,6 +3,7 @@
 #include <cli_impl.h>
 #include <cli_example.h>
 #include <cli_car.hpp>
+#include <cli_fleet.hpp>
 #include <cli_video.hpp>
 #include <car_web_server.hpp>
 #include <cli/filehistorystorage.h>
@@ -36,12 +37,15 @@ void CliImpl::initCliCommand()
 
     //static CliExample cliExample;
     static CliCar     cliCar;
+    static CliFleet   cliFleet;
     static CliVideo   cliVideo;
 
     cmn::setSingletonInstance<CliCar>(&cliCar);
+    cmn::setSingletonInstance<CliFleet>(&cliFleet);
 
     //addCommandGroup(cliExample);
     addCommandGroup(cliCar);
+    addCommandGroup(cliFleet);
     addCommandGroup(cliVideo);
 
     // setup cli
@@ -84,8 +88,9 @@ void CliImpl::runCliImpl()
     });
 
     auto& cliCar = cmn::getSingletonInstance<CliCar>();
+    auto& cliFleet = cmn::getSingletonInstance<CliFleet>();
     auto& videoCtrl = cmn::getSingletonInstance<VideoCtrl>();
-    CarWebServer webServer(m_scheduler.AsioContext(), cliCar, videoCtrl, k_MWebServerPort);
+    CarWebServer webServer(m_scheduler.AsioContext(), cliCar, cliFleet.getFleet(), videoCtrl, k_MWebServerPort);
 
     m_scheduler.Run();
 }
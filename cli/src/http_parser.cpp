@@ -0,0 +1,166 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <http_parser.hpp>
+
+#include <algorithm>
+#include <charconv>
+
+namespace cli
+{
+
+namespace
+{
+
+bool equalNoCase(std::string_view a, std::string_view b)
+{
+    return (a.size() == b.size()) && std::equal(a.begin(), a.end(), b.begin(), [](char x, char y) {
+        return ((x | 0x20) == (y | 0x20));
+    });
+}
+
+std::string_view trim(std::string_view value)
+{
+    while (!value.empty() && ((value.front() == ' ') || (value.front() == '\t'))) {
+        value.remove_prefix(1);
+    }
+    while (!value.empty() && ((value.back() == ' ') || (value.back() == '\t'))) {
+        value.remove_suffix(1);
+    }
+    return value;
+}
+
+// next line without CRLF, data moves past it
+std::string_view takeLine(std::string_view& data)
+{
+    const auto end = data.find("\r\n");
+    const auto line = data.substr(0, end);
+    data.remove_prefix((end == std::string_view::npos) ? data.size() : end + 2);
+    return line;
+}
+
+}  // namespace
+
+std::string_view HttpRequest::getHeader(std::string_view name) const
+{
+    for (size_t i = 0; i < headerNum; i++) {
+        if (equalNoCase(headers[i].name, name)) {
+            return headers[i].value;
+        }
+    }
+    return {};
+}
+
+bool HttpRequest::hasToken(std::string_view name, std::string_view token) const
+{
+    auto list = getHeader(name);
+    while (!list.empty()) {
+        const auto comma = list.find(',');
+        if (equalNoCase(trim(list.substr(0, comma)), token)) {
+            return true;
+        }
+        list.remove_prefix((comma == std::string_view::npos) ? list.size() : comma + 1);
+    }
+    return false;
+}
+
+void HttpParser::reset()
+{
+    m_scanned = 0;
+    m_headerLength = 0;
+    m_length = 0;
+    m_errorCode = 0;
+}
+
+HttpParser::Status HttpParser::fail(int32_t code)
+{
+    m_errorCode = code;
+    return Status::Error;
+}
+
+HttpParser::Status HttpParser::parse(std::string_view data, HttpRequest& request)
+{
+    if (!m_headerLength) {
+        // search new bytes only, the end mark may straddle two reads
+        const size_t from = (m_scanned > 3) ? m_scanned - 3 : 0;
+        const auto end = data.find("\r\n\r\n", from);
+        if (end == std::string_view::npos) {
+            m_scanned = data.size();
+            return (data.size() > k_maxHeaderBytes) ? fail(431) : Status::More;
+        }
+        if (end + 4 > k_maxHeaderBytes) {
+            return fail(431);
+        }
+        m_headerLength = end + 4;
+    }
+
+    if (!parseHeader(data.substr(0, m_headerLength), request)) {
+        return Status::Error;
+    }
+
+    size_t bodyLength = 0;
+    const auto contentLength = request.getHeader("Content-Length");
+    if (!contentLength.empty()) {
+        auto [ptr, ec] = std::from_chars(contentLength.data(), contentLength.data() + contentLength.size(),
+                                         bodyLength);
+        if ((ec != std::errc{}) || (ptr != contentLength.data() + contentLength.size())) {
+            return fail(400);
+        }
+        if (bodyLength > k_maxBodyBytes) {
+            return fail(413);
+        }
+    } else if (!request.getHeader("Transfer-Encoding").empty()) {
+        return fail(411);
+    }
+
+    if (data.size() < m_headerLength + bodyLength) {
+        return Status::More;
+    }
+    request.body = data.substr(m_headerLength, bodyLength);
+    m_length = m_headerLength + bodyLength;
+    return Status::Done;
+}
+
+bool HttpParser::parseHeader(std::string_view header, HttpRequest& request)
+{
+    // request line: method SP target SP HTTP/1.x
+    auto line = takeLine(header);
+    const auto methodEnd = line.find(' ');
+    const auto targetEnd = line.find(' ', methodEnd + 1);
+    if ((methodEnd == std::string_view::npos) || (targetEnd == std::string_view::npos)) {
+        fail(400);
+        return false;
+    }
+    request.method = line.substr(0, methodEnd);
+    request.target = line.substr(methodEnd + 1, targetEnd - methodEnd - 1);
+    const auto version = line.substr(targetEnd + 1);
+    if ((version.size() != 8) || (version.substr(0, 7) != "HTTP/1.") || (version[7] < '0') || (version[7] > '9')) {
+        fail(505);
+        return false;
+    }
+    request.minorVersion = version[7] - '0';
+
+    const auto queryPos = request.target.find('?');
+    request.path = request.target.substr(0, queryPos);
+    request.query = (queryPos == std::string_view::npos) ? std::string_view{} : request.target.substr(queryPos + 1);
+
+    request.headerNum = 0;
+    while (!(line = takeLine(header)).empty()) {
+        const auto colon = line.find(':');
+        if ((colon == std::string_view::npos) || (colon == 0) || (line[0] == ' ') || (line[0] == '\t')) {
+            fail(400);
+            return false;
+        }
+        if (request.headerNum == request.headers.size()) {
+            fail(431);
+            return false;
+        }
+        request.headers[request.headerNum++] = {line.substr(0, colon), trim(line.substr(colon + 1))};
+    }
+
+    request.keepAlive = (request.minorVersion >= 1) ? !request.hasToken("Connection", "close")
+                                                    : request.hasToken("Connection", "keep-alive");
+    request.body = {};
+    return true;
+}
+
+}  // namespace cli
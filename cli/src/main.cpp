@@ -9,6 +9,9 @@
 #include <remote_key.hpp>
 #include <video/sound_intf.hpp>
 #include <video/video_ctrl.hpp>
+#ifdef CARCTRL_SINGLE_BINARY
+#include "car_ctrl.hpp"
+#endif
 
 int32_t main(int argc, char **argv)
 {
@@ -29,6 +32,12 @@ int32_t main(int argc, char **argv)
     cli::CliImpl cliImpl;
     cmn::setSingletonInstance(&cliImpl);
 
+#ifdef CARCTRL_SINGLE_BINARY
+    // car control runs in this process. rpc calls go to rpc_service directly
+    CarCtrl carCtrl{cliImpl.getIoContext()};
+    cmn::setSingletonInstance(&carCtrl);
+#endif
+
     RemoteKey remoteKey{cliImpl.getIoContext()};
     cmn::setSingletonInstance(&remoteKey);
 
@@ -0,0 +1,158 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <status_events.hpp>
+
+#include <fmt/format.h>
+#include <xapi/easylog.hpp>
+#include <xapi/metrics.hpp>
+
+namespace cli
+{
+
+namespace
+{
+
+constexpr std::string_view k_streamHeader =
+    "HTTP/1.1 200 OK\r\n"
+    "Content-Type: text/event-stream\r\n"
+    "Cache-Control: no-cache\r\n"
+    "Connection: keep-alive\r\n"
+    "Access-Control-Allow-Origin: *\r\n"
+    "\r\n"
+    "retry: 2000\n\n";
+
+metrics::Gauge   g_listeners {"agvintf_web_streams", "open streams of the web server", "kind=\"events\""};
+metrics::Counter g_samples {"agvintf_status_samples_total", "car status samples taken for event listeners"};
+
+}  // namespace
+
+struct StatusEvents::Listener
+{
+    std::shared_ptr<asio::ip::tcp::socket> socket;
+    std::string                            car;
+    uint64_t                               sentSeq {0};
+};
+
+StatusEvents::StatusEvents(asio::io_context& context, Sample sample) :
+    m_context{context},
+    m_sample{std::move(sample)},
+    m_timer{context}
+{
+}
+
+void StatusEvents::subscribe(std::shared_ptr<asio::ip::tcp::socket> socket, const std::string& car)
+{
+    auto listener = std::make_shared<Listener>(std::move(socket), car);
+    auto& channel = m_channels[car];
+    channel.listeners++;
+    g_listeners.add(1);
+    ctrllog::info("status events of car '{}': {} listeners", car, channel.listeners);
+
+    // a new car is sampled at once, later ones share the periodic sample
+    if (!channel.latest) {
+        sample(car, channel);
+    }
+    if (!m_running) {
+        m_running = true;
+        tick();
+    }
+
+    asio::async_write(*listener->socket, asio::buffer(k_streamHeader),
+        [this, listener](const asio::error_code& ec, std::size_t) {
+            if (ec) {
+                drop(listener);
+                return;
+            }
+            next(listener);
+        });
+}
+
+void StatusEvents::tick()
+{
+    m_timer.expires_after(k_period);
+    m_timer.async_wait([this](const asio::error_code& ec) {
+        if (ec) {
+            return;
+        }
+        if (m_channels.empty()) {
+            m_running = false;
+            return;
+        }
+        for (auto& [car, channel] : m_channels) {
+            sample(car, channel);
+        }
+        tick();
+    });
+}
+
+void StatusEvents::sample(const std::string& car, Channel& channel)
+{
+    // an offline car answers after the rpc timeout, do not stack samples on it
+    if (channel.sampling) {
+        return;
+    }
+    channel.sampling = true;
+    m_sample(car, [this, car](std::string json) {
+        auto it = m_channels.find(car);
+        if (it == m_channels.end()) {
+            return;     // listeners went away meanwhile
+        }
+        it->second.sampling = false;
+        publish(it->second, json);
+    });
+}
+
+void StatusEvents::publish(Channel& channel, const std::string& json)
+{
+    g_samples.inc();
+    auto event = std::make_shared<Event>();
+    event->seq = ++m_seq;
+    event->data = fmt::format("id: {}\ndata: {}\n\n", event->seq, json);
+    channel.latest = std::move(event);
+
+    // send() only starts writes, idle is refilled by their completions
+    m_waking.swap(channel.idle);
+    for (auto& listener : m_waking) {
+        send(listener, channel.latest);
+    }
+    m_waking.clear();
+}
+
+void StatusEvents::next(std::shared_ptr<Listener> listener)
+{
+    auto& channel = m_channels[listener->car];
+    if (channel.latest && (channel.latest->seq > listener->sentSeq)) {
+        send(listener, channel.latest);
+    } else {
+        channel.idle.push_back(std::move(listener));
+    }
+}
+
+void StatusEvents::send(std::shared_ptr<Listener> listener, std::shared_ptr<const Event> event)
+{
+    listener->sentSeq = event->seq;
+    asio::async_write(*listener->socket, asio::buffer(event->data),
+        [this, listener, event](const asio::error_code& ec, std::size_t) {
+            if (ec) {
+                drop(listener);
+                return;
+            }
+            next(listener);
+        });
+}
+
+void StatusEvents::drop(std::shared_ptr<Listener> listener)
+{
+    auto it = m_channels.find(listener->car);
+    if ((it != m_channels.end()) && !--it->second.listeners) {
+        m_channels.erase(it);
+    }
+    g_listeners.add(-1);
+    ctrllog::info("status events of car '{}': listener gone", listener->car);
+
+    asio::error_code ec;
+    listener->socket->shutdown(asio::ip::tcp::socket::shutdown_both, ec);
+    listener->socket->close(ec);
+}
+
+}  // namespace cli
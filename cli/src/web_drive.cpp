@@ -0,0 +1,397 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <car_web_server.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <optional>
+#include <vector>
+
+#include <fmt/format.h>
+#include <xapi/easylog.hpp>
+#include <xapi/metrics.hpp>
+#include <web_socket.hpp>
+
+namespace cli
+{
+
+namespace
+{
+
+// setpoint of the browser, 8 bytes little endian
+//   u16 seq, u8 type, i8 x (-100 left..100 right), i8 y (-100 back..100 forward),
+//   i8 rotation (>0 rotates), u8 speed level (1-9, 0 from stick), u8 reserved
+// answered with an ack of 8 bytes
+//   u16 seq, u8 type | 0x80, i8 result, u32 us from setpoint read to rpc done
+enum SetpointType : uint8_t {
+    setpointDrive = 1,
+    setpointStop  = 2
+};
+
+constexpr size_t  k_setpointSize = 8;
+constexpr uint8_t k_ackFlag      = 0x80;
+
+metrics::Gauge     g_driveSockets {"agvintf_web_streams", "open streams of the web server", "kind=\"drive\""};
+metrics::Histogram g_setpointSeconds {"agvintf_drive_setpoint_seconds", "setpoint read to rpc done",
+                                      metrics::k_latencyBoundsUs, 1e6};
+
+}  // namespace
+
+// joystick control of one browser over a websocket. the car is only called
+// when direction or speed level change, else the setpoint feeds the deadman
+// watchdog. setpoints stopping for k_setpointTimeout or the socket going away
+// stop the car. one setpoint is in flight at a time, a setpoint read meanwhile
+// replaces the one waiting, so a slow car gets the newest and never blocks the
+// io thread. the ack goes out when the car answered
+class CarWebServer::DriveSocket : public std::enable_shared_from_this<DriveSocket>
+{
+public:
+    DriveSocket(CarWebServer& server, std::shared_ptr<asio::ip::tcp::socket> socket, std::string car) :
+        m_server{server},
+        m_socket{std::move(socket)},
+        m_car{std::move(car)},
+        m_timer{server.m_context},
+        m_buffer(k_readSize)
+    {
+    }
+
+    void start(std::string_view handshake, std::string_view early);
+
+private:
+    static constexpr size_t  k_readSize = 2048;
+    static constexpr auto    k_statusPeriod = std::chrono::milliseconds(250);
+    static constexpr auto    k_setpointTimeout = std::chrono::milliseconds(500);
+    static constexpr int32_t k_deadZone = 15;
+
+    struct Setpoint
+    {
+        uint16_t     seq;
+        uint8_t      type;
+        CarDirection dir;
+        int32_t      level;
+        std::chrono::steady_clock::time_point start;
+        bool         ack;           // false for stops of deadman and close
+    };
+
+    void read();
+    void process();
+    void onSetpoint(std::string_view payload);
+    // apply now, or wait for the setpoint in flight
+    void queue(const Setpoint& setpoint);
+    void apply(const Setpoint& setpoint);
+    void onApplied(const Setpoint& setpoint, int32_t result);
+    async_simple::coro::Lazy<int32_t> drive(CarDirection dir, int32_t level);
+    void tick();
+    void send(uint8_t opcode, std::string_view payload);
+    void flush();
+    void close(uint16_t code);
+    void shutdown();
+
+    CarWebServer&                          m_server;
+    std::shared_ptr<asio::ip::tcp::socket> m_socket;
+    std::string                            m_car;
+    asio::steady_timer                     m_timer;
+    std::vector<char>                      m_buffer;
+    size_t                                 m_end {0};
+    std::string                            m_pending;      // frames queued while writing
+    std::string                            m_sending;
+    bool                                   m_writing {false};
+    bool                                   m_closing {false};
+    bool                                   m_sampling {false};     // status of car not answered yet
+    bool                                   m_calling {false};      // setpoint in flight
+    std::optional<Setpoint>                m_queued;               // newest setpoint read meanwhile
+    CarDirection                           m_dir {CarDirection::dirInvalid};
+    int32_t                                m_level {0};
+    std::chrono::steady_clock::time_point  m_lastSetpoint;
+};
+
+void CarWebServer::DriveSocket::start(std::string_view handshake, std::string_view early)
+{
+    ctrllog::info("drive socket of car '{}' opened", m_car);
+    g_driveSockets.add(1);
+    m_buffer.resize(std::max(k_readSize, early.size()));
+    std::memcpy(m_buffer.data(), early.data(), early.size());
+    m_end = early.size();
+    m_pending.append(handshake);
+    flush();
+    tick();
+    process();
+}
+
+void CarWebServer::DriveSocket::read()
+{
+    auto self = shared_from_this();
+    m_socket->async_read_some(asio::buffer(m_buffer.data() + m_end, m_buffer.size() - m_end),
+        [self](const asio::error_code& ec, std::size_t length) {
+            if (ec) {
+                self->close(0);
+                return;
+            }
+            self->m_end += length;
+            self->process();
+        });
+}
+
+void CarWebServer::DriveSocket::process()
+{
+    size_t begin = 0;
+    while (!m_closing) {
+        WebSocket::Frame frame;
+        const size_t length = WebSocket::parseFrame(std::span<char>(m_buffer.data() + begin, m_end - begin), frame);
+        if (length == WebSocket::k_needMore) {
+            break;
+        }
+        if (length == WebSocket::k_badFrame) {
+            close(1002);
+            return;
+        }
+        begin += length;
+
+        switch (frame.opcode) {
+        case WebSocket::opBinary:
+            onSetpoint(frame.payload);
+            break;
+        case WebSocket::opPing:
+            send(WebSocket::opPong, frame.payload);
+            break;
+        case WebSocket::opClose:
+            close(1000);
+            return;
+        default:
+            break;
+        }
+    }
+    if (m_closing) {
+        return;
+    }
+
+    std::memmove(m_buffer.data(), m_buffer.data() + begin, m_end - begin);
+    m_end -= begin;
+    read();
+}
+
+void CarWebServer::DriveSocket::onSetpoint(std::string_view payload)
+{
+    if (payload.size() != k_setpointSize) {
+        return;
+    }
+    const auto start = std::chrono::steady_clock::now();
+    m_lastSetpoint = start;
+
+    const auto* bytes = reinterpret_cast<const uint8_t*>(payload.data());
+    const uint16_t seq = bytes[0] | (bytes[1] << 8);
+    const uint8_t type = bytes[2];
+    const int32_t x = static_cast<int8_t>(bytes[3]);
+    const int32_t y = static_cast<int8_t>(bytes[4]);
+    const int32_t rotation = static_cast<int8_t>(bytes[5]);
+    int32_t level = bytes[6];
+
+    // strongest axis picks the direction, its deflection the speed level
+    CarDirection dir = CarDirection::dirInvalid;
+    const int32_t magnitude = std::max({std::abs(x), std::abs(y), rotation});
+    if ((type == setpointDrive) && (magnitude >= k_deadZone)) {
+        if (std::abs(y) == magnitude) {
+            dir = (y > 0) ? CarDirection::dirUp : CarDirection::dirDown;
+        } else if (std::abs(x) == magnitude) {
+            dir = (x < 0) ? CarDirection::dirLeft : CarDirection::dirRight;
+        } else {
+            dir = CarDirection::dirRotation;
+        }
+        if (!level) {
+            level = std::clamp((std::min(magnitude, 100) * 9 + 99) / 100, 1, 9);
+        }
+    }
+    queue({seq, type, dir, std::clamp(level, 1, 9), start, true});
+}
+
+void CarWebServer::DriveSocket::queue(const Setpoint& setpoint)
+{
+    if (m_calling) {
+        m_queued = setpoint;
+        return;
+    }
+    apply(setpoint);
+}
+
+void CarWebServer::DriveSocket::apply(const Setpoint& setpoint)
+{
+    m_calling = true;
+    auto call = (setpoint.type == setpointStop) ? drive(CarDirection::dirInvalid, -1)
+                                                : drive(setpoint.dir, setpoint.level);
+    auto self = shared_from_this();
+    std::move(call).start([self, setpoint](async_simple::Try<int32_t> result) {
+        const int32_t value = result.hasError() ? -1 : result.value();
+        asio::post(self->m_server.m_context, [self, setpoint, value]() { self->onApplied(setpoint, value); });
+    });
+}
+
+void CarWebServer::DriveSocket::onApplied(const Setpoint& setpoint, int32_t result)
+{
+    m_calling = false;
+    if (setpoint.ack && !m_closing) {
+        const auto usedUs = static_cast<uint32_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - setpoint.start).count());
+        g_setpointSeconds.observe(usedUs);
+        const uint16_t seq = setpoint.seq;
+        const char ack[k_setpointSize] = {
+            static_cast<char>(seq), static_cast<char>(seq >> 8), static_cast<char>(setpoint.type | k_ackFlag),
+            static_cast<char>(result), static_cast<char>(usedUs), static_cast<char>(usedUs >> 8),
+            static_cast<char>(usedUs >> 16), static_cast<char>(usedUs >> 24)};
+        send(WebSocket::opBinary, std::string_view(ack, sizeof(ack)));
+    }
+
+    if (m_queued) {
+        const Setpoint next = *m_queued;
+        m_queued.reset();
+        apply(next);
+    }
+}
+
+async_simple::coro::Lazy<int32_t> CarWebServer::DriveSocket::drive(CarDirection dir, int32_t level)
+{
+    // state changes before the first call, the rest may resume on an rpc io thread.
+    // level -1 stops even when the car is not driven by this socket
+    CarWebServer& server = m_server;
+    const std::string car = m_car;
+    if (dir == CarDirection::dirInvalid) {
+        const bool stop = (level < 0) || (m_dir != CarDirection::dirInvalid);
+        m_dir = CarDirection::dirInvalid;
+        if (stop) {
+            co_await server.callCarAsync<setAllMotorState>(car, 0);
+        }
+        co_return 0;
+    }
+
+    const bool setLevel = (level != m_level);
+    const bool move = (dir != m_dir);
+    m_level = level;
+    m_dir = dir;
+    if (setLevel) {
+        co_await server.callCarAsync<setMotorSpeedLevel>(car, level);
+    }
+    if (move) {
+        co_return co_await server.callCarAsync<setCarMoving>(car, dir);
+    }
+    co_return co_await server.callCarAsync<keepAlive>(car);
+}
+
+void CarWebServer::DriveSocket::tick()
+{
+    if (m_closing) {
+        return;
+    }
+    const bool stopQueued = m_queued && (m_queued->type == setpointStop);
+    if ((m_dir != CarDirection::dirInvalid) && !stopQueued
+        && (std::chrono::steady_clock::now() - m_lastSetpoint > k_setpointTimeout)) {
+        ctrllog::warn("drive socket of car '{}': no setpoint for {} ms, stop", m_car, k_setpointTimeout.count());
+        queue({0, setpointStop, CarDirection::dirInvalid, m_level, std::chrono::steady_clock::now(), false});
+    }
+
+    // status as the event stream samples it, a fleet car answers later and
+    // the deadman check above never waits for it. a slow car skips a period
+    auto self = shared_from_this();
+    if (!m_sampling) {
+        m_sampling = true;
+        m_server.sampleStatus(m_car, [self](std::string json) {
+            self->m_sampling = false;
+            if (!self->m_closing) {
+                self->send(WebSocket::opText, json);
+            }
+        });
+    }
+
+    m_timer.expires_after(k_statusPeriod);
+    m_timer.async_wait([self](const asio::error_code& ec) {
+        if (!ec) {
+            self->tick();
+        }
+    });
+}
+
+void CarWebServer::DriveSocket::send(uint8_t opcode, std::string_view payload)
+{
+    WebSocket::putFrame(m_pending, opcode, payload);
+    flush();
+}
+
+void CarWebServer::DriveSocket::flush()
+{
+    if (m_writing) {
+        return;
+    }
+    if (m_pending.empty()) {
+        if (m_closing) {
+            shutdown();
+        }
+        return;
+    }
+
+    m_writing = true;
+    m_sending.swap(m_pending);
+    auto self = shared_from_this();
+    asio::async_write(*m_socket, asio::buffer(m_sending), [self](const asio::error_code& ec, std::size_t) {
+        self->m_writing = false;
+        self->m_sending.clear();
+        if (ec) {
+            self->m_pending.clear();
+            self->close(0);
+        }
+        self->flush();
+    });
+}
+
+void CarWebServer::DriveSocket::close(uint16_t code)
+{
+    if (m_closing) {
+        return;
+    }
+    m_closing = true;
+    m_timer.cancel();
+    g_driveSockets.add(-1);
+
+    // a browser going away never leaves the car driving, the stop goes after the setpoint in flight
+    queue({0, setpointStop, CarDirection::dirInvalid, m_level, std::chrono::steady_clock::now(), false});
+    ctrllog::info("drive socket of car '{}' closed, car stopped", m_car);
+
+    if (code) {
+        const char payload[2] = {static_cast<char>(code >> 8), static_cast<char>(code)};
+        WebSocket::putFrame(m_pending, WebSocket::opClose, std::string_view(payload, sizeof(payload)));
+    }
+    flush();
+}
+
+void CarWebServer::DriveSocket::shutdown()
+{
+    asio::error_code ec;
+    m_socket->shutdown(asio::ip::tcp::socket::shutdown_both, ec);
+    m_socket->close(ec);
+}
+
+void CarWebServer::handleDriveSocket(std::shared_ptr<asio::ip::tcp::socket> socket, const HttpRequest& request,
+                                     std::string_view early)
+{
+    const auto car = getQueryParam(request.query, "car");
+    const auto key = request.getHeader("Sec-WebSocket-Key");
+    std::string refuse;
+    if (!car.empty() && m_fleet.getHosts(car).empty()) {
+        refuse = httpResponse(404, "Not Found", "application/json", R"({"ok":false,"error":"no such car"})", false);
+    } else if (key.empty() || (request.getHeader("Sec-WebSocket-Version") != "13")) {
+        refuse = httpResponse(400, "Bad Request", "text/plain", "websocket version 13 required", false);
+    }
+    if (!refuse.empty()) {
+        sendAndClose(std::move(socket), std::move(refuse));
+        return;
+    }
+
+    const auto handshake = fmt::format("HTTP/1.1 101 Switching Protocols\r\n"
+                                       "Upgrade: websocket\r\n"
+                                       "Connection: Upgrade\r\n"
+                                       "Sec-WebSocket-Accept: {}\r\n"
+                                       "\r\n",
+                                       WebSocket::acceptKey(key));
+    std::make_shared<DriveSocket>(*this, std::move(socket), car)->start(handshake, early);
+}
+
+}  // namespace cli
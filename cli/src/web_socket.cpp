@@ -0,0 +1,164 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <web_socket.hpp>
+
+#include <array>
+
+namespace cli
+{
+
+namespace
+{
+
+constexpr std::string_view k_acceptGuid = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+uint32_t rotl(uint32_t value, int32_t bits)
+{
+    return (value << bits) | (value >> (32 - bits));
+}
+
+// only for the handshake, one key per connection
+std::array<uint8_t, 20> sha1(std::string_view text)
+{
+    uint32_t h[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+    std::string msg(text);
+    const uint64_t bits = static_cast<uint64_t>(text.size()) * 8;
+    msg.push_back(static_cast<char>(0x80));
+    while (msg.size() % 64 != 56) {
+        msg.push_back(0);
+    }
+    for (int32_t i = 7; i >= 0; i--) {
+        msg.push_back(static_cast<char>(bits >> (i * 8)));
+    }
+
+    for (size_t block = 0; block < msg.size(); block += 64) {
+        uint32_t w[80];
+        for (int32_t i = 0; i < 16; i++) {
+            const auto* p = reinterpret_cast<const uint8_t*>(msg.data() + block + i * 4);
+            w[i] = (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | p[3];
+        }
+        for (int32_t i = 16; i < 80; i++) {
+            w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+        }
+        uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+        for (int32_t i = 0; i < 80; i++) {
+            uint32_t f, k;
+            if (i < 20) {
+                f = (b & c) | (~b & d);
+                k = 0x5a827999;
+            } else if (i < 40) {
+                f = b ^ c ^ d;
+                k = 0x6ed9eba1;
+            } else if (i < 60) {
+                f = (b & c) | (b & d) | (c & d);
+                k = 0x8f1bbcdc;
+            } else {
+                f = b ^ c ^ d;
+                k = 0xca62c1d6;
+            }
+            const uint32_t temp = rotl(a, 5) + f + e + k + w[i];
+            e = d;
+            d = c;
+            c = rotl(b, 30);
+            b = a;
+            a = temp;
+        }
+        h[0] += a;
+        h[1] += b;
+        h[2] += c;
+        h[3] += d;
+        h[4] += e;
+    }
+
+    std::array<uint8_t, 20> digest;
+    for (int32_t i = 0; i < 20; i++) {
+        digest[i] = static_cast<uint8_t>(h[i / 4] >> (24 - (i % 4) * 8));
+    }
+    return digest;
+}
+
+std::string base64(std::span<const uint8_t> data)
+{
+    static constexpr char k_table[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    for (size_t i = 0; i < data.size(); i += 3) {
+        uint32_t chunk = uint32_t(data[i]) << 16;
+        if (i + 1 < data.size()) {
+            chunk |= uint32_t(data[i + 1]) << 8;
+        }
+        if (i + 2 < data.size()) {
+            chunk |= data[i + 2];
+        }
+        out.push_back(k_table[(chunk >> 18) & 0x3f]);
+        out.push_back(k_table[(chunk >> 12) & 0x3f]);
+        out.push_back((i + 1 < data.size()) ? k_table[(chunk >> 6) & 0x3f] : '=');
+        out.push_back((i + 2 < data.size()) ? k_table[chunk & 0x3f] : '=');
+    }
+    return out;
+}
+
+}  // namespace
+
+std::string WebSocket::acceptKey(std::string_view key)
+{
+    std::string text(key);
+    text += k_acceptGuid;
+    return base64(sha1(text));
+}
+
+size_t WebSocket::parseFrame(std::span<char> data, Frame& frame)
+{
+    if (data.size() < 2) {
+        return k_needMore;
+    }
+    const auto* bytes = reinterpret_cast<uint8_t*>(data.data());
+    const bool fin = bytes[0] & 0x80;
+    const bool masked = bytes[1] & 0x80;
+    size_t length = bytes[1] & 0x7f;
+    size_t header = 2;
+    if (!fin || (bytes[0] & 0x70) || !masked || (length == 127)) {
+        return k_badFrame;
+    }
+    if (length == 126) {
+        if (data.size() < 4) {
+            return k_needMore;
+        }
+        length = (size_t(bytes[2]) << 8) | bytes[3];
+        header = 4;
+    }
+    if (length > k_maxPayload) {
+        return k_badFrame;
+    }
+    if (data.size() < header + 4 + length) {
+        return k_needMore;
+    }
+
+    const uint8_t* mask = bytes + header;
+    char* payload = data.data() + header + 4;
+    for (size_t i = 0; i < length; i++) {
+        payload[i] = static_cast<char>(payload[i] ^ mask[i % 4]);
+    }
+    frame.opcode = bytes[0] & 0x0f;
+    frame.payload = std::string_view(payload, length);
+    return header + 4 + length;
+}
+
+void WebSocket::putFrame(std::string& out, uint8_t opcode, std::string_view payload)
+{
+    out.push_back(static_cast<char>(0x80 | opcode));
+    if (payload.size() < 126) {
+        out.push_back(static_cast<char>(payload.size()));
+    } else if (payload.size() <= 0xffff) {
+        out.push_back(static_cast<char>(126));
+        out.push_back(static_cast<char>(payload.size() >> 8));
+        out.push_back(static_cast<char>(payload.size()));
+    } else {
+        out.push_back(static_cast<char>(127));
+        for (int32_t i = 7; i >= 0; i--) {
+            out.push_back(static_cast<char>(static_cast<uint64_t>(payload.size()) >> (i * 8)));
+        }
+    }
+    out.append(payload);
+}
+
+}  // namespace cli
@@ -1,6 +1,9 @@
 // SPDX-License-Identifier: GPL-2.0
 
 #pragma once
+#include <string>
+#include <type_traits>
+#include <vector>
 #include <xapi/easylog.hpp>
 #include <ylt/coro_rpc/coro_rpc_context.hpp>
 #include <ylt/coro_rpc/coro_rpc_client.hpp>
@@ -37,10 +40,156 @@ int32_t getCtrlMode();
 int32_t getMotorNum();
 int32_t setSteerTurn(int32_t dir, uint32_t time);
 
+// feed deadman watchdog in moving mode. latency in us
+int32_t keepAlive();
+int32_t getWatchdogTrips();
+int32_t getWatchdogLatency();
+
+// speed loop jitter since start. histogram bucket i counts [2^(i-1), 2^i) us
+struct LoopJitter
+{
+    std::string policy;
+    int32_t periodUs;           // pwm step
+    int32_t maxWakeLatency;     // us, wake later than planned
+    int32_t maxPeriodError;     // us, latency change between two timed wakes
+    uint64_t ticks;
+    std::vector<uint32_t> wakeHist;
+    std::vector<uint32_t> periodHist;
+};
+LoopJitter getLoopJitter();
+
+// encoder input of each motor. input: event (gpio character device), sysfs or none.
+// dropped edges are counted in edges, glitches are not.
+// fault: 0 none, 1 stall, 2 slip, see "stall" in param.json
+struct EncoderState
+{
+    std::string input;
+    uint64_t edges;
+    uint64_t dropped;           // kernel queue overflow, from sequence numbers
+    uint64_t glitches;          // closer than encoder_glitch_us to last edge
+    int32_t  periodUs;          // between last two edges, kernel timestamps
+    int32_t  rate;              // edges/s in last stall window
+    int32_t  fault;
+    uint32_t stalls;
+    uint32_t slips;
+};
+std::vector<EncoderState> getEncoderState();
+
+// pwm calibration on a stand. action 1 start, 0 cancel
+#define CALIBRATE_IDLE      0
+#define CALIBRATE_RUNNING   1
+#define CALIBRATE_DONE      2
+#define CALIBRATE_FAILED    -1
+
+struct CalibrateState
+{
+    int32_t state;
+    int32_t progress;                       // percent of sweep
+    std::string message;
+    std::vector<std::vector<int32_t>> rate; // encoder edges/s, [motor][sweep point]
+    std::vector<std::vector<int32_t>> pwm;  // result, [level][motor]
+};
+int32_t autoCalibrate(int32_t action);
+CalibrateState getCalibrateState();
+
+// telemetry history of speed loop, buckets of 1 ms, 10 ms, 1 s and 1 min.
+// metric: speed (encoder edges/s), pwm (negative backward), steps or mode.
+// from, to: unix ms, <= 0 relative to now. resolution: least ms per point,
+// 0 for auto, the level with at most 1000 points is taken
+struct TelemetrySeries
+{
+    std::string metric;
+    int32_t resolution;                     // ms per point of chosen level, 0 unknown metric
+    std::vector<int64_t> time;              // unix ms, start of point
+    std::vector<std::vector<int32_t>> min;  // [motor][point], mode has one series
+    std::vector<std::vector<int32_t>> max;
+    std::vector<std::vector<int32_t>> mean;
+};
+TelemetrySeries getTelemetryHistory(std::string metric, int64_t from, int64_t to, int32_t resolution);
+
+// flight records after fromSeq still in the ring of agvctrl, as compact blocks
+// of mcarctrl/include/telemetry_codec.hpp. a file of header once, then blocks
+// of each call, is read by flightrec
+struct FlightRecordChunk
+{
+    uint64_t lastSeq;           // fromSeq of next call, 0 without recorder
+    std::string header;
+    std::string blocks;
+};
+FlightRecordChunk getFlightRecords(uint64_t fromSeq);
+
+// prometheus text exposition of agvctrl, served with its own by agvintf /metrics
+std::string getMetrics();
+
 void quitApp(int32_t param);
 
+/**
+ * @brief compile-time list of rpc handlers
+ *  the server registers exactly this list. in single binary mode the rpc_call_*
+ *  helpers check the called function against it and dispatch directly.
+ */
+template<auto a, auto b>
+constexpr bool rpc_same_handler()
+{
+    if constexpr (std::is_same_v<decltype(a), decltype(b)>) {
+        return a == b;
+    } else {
+        return false;
+    }
+}
+
+template<auto... funcs>
+struct RpcHandlerList
+{
+    template<auto func>
+    static constexpr bool contains()
+    {
+        return (rpc_same_handler<func, funcs>() || ...);
+    }
+};
+
+using RpcHandlers = RpcHandlerList<getActualSpeed, setCtrlSteps, getCtrlSteps,
+                                   getActualSteps, setRunTime, setMotorSpeedLevel,
+                                   getMotorSpeedLevel, setAllMotorState, getCtrlMode,
+                                   getMotorNum, setMotorPwm, getMotorPwm, setCarSteps,
+                                   setCarMoving, setSteerTurn, keepAlive,
+                                   getWatchdogTrips, getWatchdogLatency, getLoopJitter,
+                                   getEncoderState, autoCalibrate, getCalibrateState,
+                                   getTelemetryHistory, getFlightRecords, getMetrics,
+                                   quitApp>;
+
+template<typename Server, auto... funcs>
+void rpc_register_handlers(Server& server, RpcHandlerList<funcs...>)
+{
+    server.template register_handler<funcs...>();
+}
+
 using namespace async_simple::coro;
 
+#ifdef CARCTRL_SINGLE_BINARY
+// agvctrl and agvintf linked in one executable: call service function without socket
+template<auto func, typename... Args>
+int32_t rpc_call_int_param([[maybe_unused]] coro_rpc::coro_rpc_client& client, Args... args)
+{
+    static_assert(RpcHandlers::contains<func>(), "function is not registered as rpc handler");
+    return func(std::forward<Args>(args)...);
+}
+
+template<auto func, typename... Args>
+void rpc_call_void_param([[maybe_unused]] coro_rpc::coro_rpc_client& client, Args... args)
+{
+    static_assert(RpcHandlers::contains<func>(), "function is not registered as rpc handler");
+    func(std::forward<Args>(args)...);
+}
+
+template<auto func, typename... Args>
+auto rpc_call_param([[maybe_unused]] coro_rpc::coro_rpc_client& client, Args... args)
+{
+    static_assert(RpcHandlers::contains<func>(), "function is not registered as rpc handler");
+    return func(std::forward<Args>(args)...);
+}
+#else
+
 template<auto func>
 int32_t rpc_call_int_param(coro_rpc::coro_rpc_client& client)
 {
@@ -72,4 +221,17 @@ void rpc_call_void_param(coro_rpc::coro_rpc_client& client, Args... args)
     if (!ret) {
         ctrllog::error("failed to call function...");
     }
-}
\ No newline at end of file
+}
+
+// any return type, default constructed value on failure
+template<auto func, typename... Args>
+auto rpc_call_param(coro_rpc::coro_rpc_client& client, Args... args)
+{
+    auto ret = syncAwait(client.call<func>(std::forward<Args>(args)...));
+    if (!ret) {
+        ctrllog::error("failed to call function...");
+        return decltype(func(std::forward<Args>(args)...)){};
+    }
+    return ret.value();
+}
+#endif
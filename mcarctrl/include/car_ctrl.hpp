@@ -5,6 +5,7 @@
 #include <rpc_service.hpp>
 #include "gpio.hpp"
 #include "car_speed.hpp"
+#include "pwm_calibrate.hpp"
 
 #define MOTOR_MAX_TIME    500
 #define MOTOR_SPEED_STEP  (MOTOR_MAX_TIME/MOTOR_MAX_SPEED)
@@ -16,7 +17,7 @@
 class CarCtrl
 {
 public:
-    CarCtrl(asio::io_context& context);
+    CarCtrl(asio::io_context& context, CarOption option = {});
     virtual ~CarCtrl();
 
     int32_t getActualSpeed(int32_t motor);
@@ -39,10 +40,29 @@ public:
 
     int32_t steerTurn(int32_t dir, uint32_t time);
 
+    int32_t keepAlive();
+    int32_t getWatchdogTrips();
+    int32_t getWatchdogLatency();
+    LoopJitter getLoopJitter();
+    std::vector<EncoderState> getEncoderState();
+    TelemetrySeries getTelemetryHistory(const std::string& metric, int64_t from, int64_t to, int32_t resolution);
+    FlightRecordChunk getFlightRecords(uint64_t fromSeq);
+
+    int32_t autoCalibrate(int32_t action);
+    CalibrateState getCalibrateState();
+
+    CarSpeed& getCarSpeed() { return m_carSpeed; }
+
+    // car of rpc handlers: the car bound to the calling thread, else the singleton.
+    // a host of many simulated cars binds each car to the threads of its server
+    static CarCtrl& current();
+    static void     bindThread(CarCtrl* carCtrl);
+
 private:
     static void runTimeCallback(const asio::error_code &e, void *ctxt);
 
     CarSpeed m_carSpeed;
     IoTimer  m_runTimer;
     int32_t  m_ctrlMode {CTRL_MODE_STEP};
+    PwmCalibrate m_calibrate {this, m_carSpeed};
 };
@@ -0,0 +1,73 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+// controller state kept over a restart of agvctrl
+struct MotorSnapshot
+{
+    int32_t runPwm;         // pwm of level or set by setMotorPwm
+    int32_t ctrlSteps;
+    int32_t actualSteps;
+    int32_t encoderCount;
+
+    bool operator==(const MotorSnapshot&) const = default;
+};
+
+struct CarSnapshot
+{
+    std::string deviceName;
+    int32_t     speedLevel {0};
+    std::vector<MotorSnapshot> motor;
+
+    bool operator==(const CarSnapshot&) const = default;
+};
+
+static constexpr uint32_t k_snapshotMagic    = 0x53564741;  // "AGVS"
+static constexpr uint16_t k_snapshotVersion  = 1;
+static constexpr int32_t  k_snapshotSlotSize = 512;
+
+// head of each slot, struct_pack of CarSnapshot follows
+struct SnapshotSlotHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t length;        // bytes of payload
+    uint64_t seq;           // newer slot has higher seq
+    uint64_t realtimeUs;    // wall clock of save
+    uint32_t checksum;      // fnv-1a of payload
+    uint32_t reserved;
+};
+static_assert(sizeof(SnapshotSlotHeader) == 32, "snapshot slot layout changed");
+
+/**
+ * @brief snapshot file with two slots, written in turn
+ *  save writes the older slot and syncs it, the other slot still holds the
+ *  last good snapshot. a crash in the middle of a write leaves a slot with a
+ *  bad checksum, load takes the valid slot with the higher sequence.
+ */
+class SnapshotStore
+{
+public:
+    SnapshotStore() = default;
+    virtual ~SnapshotStore();
+
+    bool open(const std::string& fileName);
+    void close();
+    bool isOpen() { return m_fd >= 0; }
+
+    // newest valid snapshot, false when there is none
+    bool load(CarSnapshot& snap);
+
+    // write slot and fdatasync, not for control thread
+    bool save(const CarSnapshot& snap);
+
+private:
+    bool readSlot(int32_t slot, SnapshotSlotHeader& header, CarSnapshot& snap);
+
+    std::string m_fileName;
+    int32_t     m_fd {-1};
+    uint64_t    m_seq {0};
+};
@@ -1,22 +1,46 @@
 // SPDX-License-Identifier: GPL-2.0
 
 #pragma once
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
 #include <xapi/iotimer.hpp>
+#include <xapi/iofilewatch.hpp>
 #include <xapi/cmn_thread.hpp>
 #include "motor.hpp"
+#include "motor_set.hpp"
 #include "steer.hpp"
+#include "car_snapshot.hpp"
+#include "flight_recorder.hpp"
+#include "pwm_scheduler.hpp"
+#include "stall_detector.hpp"
+#include "speed_config.hpp"
+#include "telemetry_history.hpp"
 
-static constexpr std::string_view k_deviceNamePc = "orangepipc";
-static constexpr std::string_view k_deviceNameM1 = "nanopim1";
-static constexpr std::string_view k_deviceNameOneplus = "orangepioneplus";
+static constexpr int32_t k_speedTickUs = 1000;  // pwm step, history sample and flight record period
+static constexpr int32_t k_jitterBuckets = 16;  // bucket i: [2^(i-1), 2^i) us, last is open
+
+// run options of car control. default is the real car with sysfs gpio
+struct CarOption
+{
+    std::string paramFile {"param.json"};
+    std::string deviceName;             // json item, empty to detect from hostname
+    SimBackend* sim {nullptr};          // simulated gpio and virtual clock
+    bool        startThread {true};     // false: caller drives controlTick()
+};
 
 class CarCtrl;
+struct LoopJitter;
+struct EncoderState;
+struct TelemetrySeries;
+struct FlightRecordChunk;
 
 class CarSpeed
 {
 public:
-    CarSpeed(asio::io_context& context, CarCtrl *carCtrl);
+    CarSpeed(asio::io_context& context, CarCtrl *carCtrl, CarOption option = {});
     virtual ~CarSpeed();
 
     int32_t getActualSpeed(int32_t motor);
@@ -37,20 +61,100 @@ public:
     void    setMotorPwm(int32_t motor, int32_t pwm);
     int32_t getMotorPwm(int32_t motor);
 
+    // pwm table [level][motor], current level takes the new values
+    void    setPwmTable(const std::vector<std::vector<int32_t>>& table);
+    int32_t getEncoderCount(int32_t motor);
+    std::vector<EncoderState> getEncoderState();
+
+    const CarOption&   getOption()   { return m_option; }
+    const std::string& getJsonItem() { return m_jsonItem; }
+
     // dir >0 turn left, <0 turn right, =0 stop.
     void    steerTurn(int32_t dir, uint32_t time = 0);
 
+    // deadman watchdog in CTRL_MODE_TIME. every setpoint or keep-alive feeds it,
+    // extraTime(ms) extends the window for commands with own duration.
+    void    feedWatchdog(int32_t extraTime = 0);
+    int32_t getWatchdogTrips();
+    int32_t getWatchdogLatency();
+
+    // stall and slip response, on by default
+    void    setStallCheck(bool enable) { m_stallDetector.setEnable(enable); }
+
+    // controlTick applies due pwm edges, watchdog, stall response and reloaded config, and
+    // returns steady time us of next wake. countEncoder counts encoder edges.
+    // called by speed thread, or by replay with virtual clock
+    int64_t controlTick();
+    void    countEncoder(int32_t motor, int32_t edges = 1);
+
+    // check param file again, pwm table and watchdog time are taken at next tick
+    int32_t reloadParam();
+
+    // wake latency and period error of speed thread, counted since start
+    LoopJitter getLoopJitter();
+
+    // min, max and mean of one metric per motor, from/to unix ms or <= 0 relative to now
+    TelemetrySeries getTelemetryHistory(const std::string& metric, int64_t from, int64_t to, int32_t resolution);
+
+    // encoded flight records after fromSeq, a few blocks per call
+    FlightRecordChunk getFlightRecords(uint64_t fromSeq);
+
 private:
     static void threadFun(void *ctxt);
     void        initJsonParam();
-    void        motorPwmCtrl();
+    void        initRealtime();
+    void        applyConfig(const SpeedConfig& config);
+    void        recordJitter(int64_t wakeLatency, int64_t periodError);
+    void        notifyPwmChange();
+    void        checkWatchdog();
+    void        checkStall(int64_t now);
+    void        recordTick(int64_t now);
+    void        saveSnapshot();
+    void        restoreSnapshot();
+    int64_t     getSteadyTimeUs();
+    Motor&      getMotor(int32_t motor) { return (*m_motorSet)[motor]; }
 
     asio::io_context& m_context;
+    CarOption         m_option;
+    std::string       m_jsonItem;
     cmn::CmnThread    m_speedThread;
     CarCtrl* m_carCtrl;
     Steer*   m_steer {nullptr};
     int32_t  m_motorNum { 0 };
     int32_t  m_speedLevel { 0 };
-    std::vector<Motor*> m_motor;
+    std::unique_ptr<MotorSet> m_motorSet;
     std::vector<std::vector<int32_t>> m_pwmVect;
+    std::mutex m_pwmMutex;                           // pwm table is replaced by calibration
+
+    std::shared_ptr<const SpeedConfig>              m_config;      // loaded at start, owns hardware
+    std::atomic<std::shared_ptr<const SpeedConfig>> m_newConfig;   // reloaded, wait for next tick
+    IoFileWatch                                     m_paramWatch;
+
+    PwmScheduler          m_pwmScheduler {k_speedTickUs};
+    std::atomic<uint32_t> m_pwmChange { 1 };         // bumped on every state or pwm change
+    uint32_t              m_pwmBuilt { 0 };          // change count of edge table
+    int                   m_wakeFd { -1 };           // eventfd, wake speed thread on change
+
+    StallDetector  m_stallDetector;
+
+    FlightRecorder m_recorder;
+    IoTimer        m_recorderTimer;
+    TelemetryHistory m_history;
+    int64_t        m_nextSample { 0 };               // steady time us of next grid point to record
+
+    SnapshotStore  m_snapshot;
+    IoTimer        m_snapshotTimer;
+    CarSnapshot    m_lastSnapshot;                   // saved last, io thread
+
+    std::atomic<int32_t> m_watchdogTime { 1000 };    // ms, 0 to disable
+    std::atomic<int64_t> m_watchdogDeadline { 0 };   // steady time us, 0 disarmed
+    std::atomic<int32_t> m_watchdogTrips { 0 };
+    std::atomic<int32_t> m_watchdogLatency { 0 };    // us, worst latency after deadline
+
+    RealtimeOption        m_rtOption;
+    std::atomic<uint32_t> m_wakeHist[k_jitterBuckets] {};
+    std::atomic<uint32_t> m_periodHist[k_jitterBuckets] {};
+    std::atomic<int32_t>  m_maxWakeLatency { 0 };    // us
+    std::atomic<int32_t>  m_maxPeriodError { 0 };    // us, absolute
+    std::atomic<uint64_t> m_loopTicks { 0 };
 };
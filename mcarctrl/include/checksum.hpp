@@ -0,0 +1,17 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+#include <cstddef>
+#include <stdint.h>
+
+// fnv-1a of the flight ring, telemetry blocks and snapshot slots. the value is
+// stored in files, keep it stable
+inline uint32_t fnv1a(const void* data, size_t size)
+{
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < size; i++) {
+        hash = (hash ^ bytes[i]) * 16777619u;
+    }
+    return hash;
+}
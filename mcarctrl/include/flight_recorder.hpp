@@ -0,0 +1,133 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+#include <atomic>
+#include <string>
+#include <vector>
+#include <stdint.h>
+#include "checksum.hpp"
+
+// binary telemetry of speed control loop in a memory-mapped ring file.
+// the file is shared with the decoder tool, keep layout stable and bump version on change.
+static constexpr uint32_t k_flightRecMagic   = 0x52564741;  // "AGVR"
+static constexpr uint16_t k_flightRecVersion = 1;
+static constexpr int32_t  k_flightRecMotors  = 4;
+
+struct FlightMotorRecord
+{
+    int8_t   runState;    // MotorState of command
+    int8_t   nowState;    // MotorState of output pins
+    uint8_t  pwmCount;    // software pwm counter
+    uint8_t  runPwm;
+    uint32_t encoder;     // raw encoder edge counter
+    int32_t  actualSteps;
+};
+
+struct FlightRecord
+{
+    uint64_t seq;         // sequence from 1, slot = (seq-1) % capacity
+    uint64_t timestamp;   // steady clock us
+    uint32_t checksum;    // of record with checksum 0
+    uint8_t  ctrlMode;
+    uint8_t  motorNum;
+    uint16_t reserved;
+    FlightMotorRecord motor[k_flightRecMotors];
+};
+static_assert(sizeof(FlightRecord) == 72, "flight record layout changed");
+
+struct FlightRecHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t recordSize;
+    uint32_t capacity;
+    uint32_t tickUs;          // record period
+    uint64_t realtimeUs;      // wall clock when file is opened
+    uint64_t steadyUs;        // steady clock when file is opened
+    std::atomic<uint64_t> writeSeq;  // last committed sequence
+    uint8_t  reserved[24];
+};
+static_assert(sizeof(FlightRecHeader) == 64, "flight record header layout changed");
+
+inline uint32_t flightRecChecksum(const FlightRecord& rec)
+{
+    // over record, checksum field counted as 0
+    FlightRecord tmp = rec;
+    tmp.checksum = 0;
+    return fnv1a(&tmp, sizeof(tmp));
+}
+
+class FlightRecorder
+{
+public:
+    FlightRecorder() = default;
+    virtual ~FlightRecorder();
+
+    /**
+     * @brief create ring file for seconds of records. previous file is kept as fileName.old
+     *
+     * @param fileName: ring file path
+     * @param seconds: history length
+     * @param tickUs: record period in us, one record per period
+     * @return true: recorder is ready
+     */
+    bool open(const std::string& fileName, int32_t seconds, int32_t tickUs);
+    void close();
+
+    // flush dirty pages to storage. not for control thread
+    void sync();
+
+    /**
+     * @brief keep the whole run in a compact file beside the ring. records are
+     *  encoded with TelemetryCodec in blocks, at about 1/5 of the ring bytes.
+     *  a full file is kept as fileName.old and a new one is started
+     *
+     * @param fileName: archive path, previous file is kept as fileName.old
+     * @param maxBytes: size of one archive file
+     */
+    bool openArchive(const std::string& fileName, int64_t maxBytes);
+
+    // encode records since last call and append them to archive. not for control thread
+    void archive();
+
+    // records after fromSeq still in ring, oldest first, torn ones dropped. not for control thread
+    size_t read(uint64_t fromSeq, size_t maxCount, std::vector<FlightRecord>& records);
+
+    // TelemetryFileHeader of this run, for encoded records sent elsewhere
+    void putFileHeader(std::string& out);
+
+    // append in control thread: no lock, no allocation, no syscall
+    inline void append(FlightRecord& rec)
+    {
+        if (m_record == nullptr) {
+            return;
+        }
+
+        rec.seq = ++m_seq;
+        rec.checksum = 0;
+        rec.checksum = flightRecChecksum(rec);
+        m_record[(rec.seq - 1) % m_capacity] = rec;
+        m_header->writeSeq.store(rec.seq, std::memory_order_release);
+    }
+
+    bool isOpen() { return m_record != nullptr; }
+
+private:
+    bool openArchiveFile();
+    void closeArchive();
+
+    int32_t          m_fd { -1 };
+    size_t           m_mapSize { 0 };
+    uint32_t         m_capacity { 0 };
+    uint64_t         m_seq { 0 };
+    FlightRecHeader* m_header { nullptr };
+    FlightRecord*    m_record { nullptr };
+
+    std::string      m_archiveName;
+    int32_t          m_archiveFd { -1 };
+    int64_t          m_archiveMax { 0 };
+    int64_t          m_archiveBytes { 0 };
+    uint64_t         m_archiveSeq { 0 };         // last archived record
+    std::vector<FlightRecord> m_archiveRecords;
+    std::string      m_archiveBuffer;
+};
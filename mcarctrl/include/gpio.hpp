@@ -1,7 +1,9 @@
 // SPDX-License-Identifier: GPL-2.0
 
 #pragma once
+#include <string>
 #include <stdint.h>
+#include "sim_backend.hpp"
 
 #define GPIO_DIR_IN         0
 #define GPIO_DIR_OUT        1
@@ -15,7 +17,7 @@
 class Gpio
 {
 public:
-    Gpio(int32_t pin, int32_t direction, int32_t edge);
+    Gpio(int32_t pin, int32_t direction, int32_t edge, SimBackend* sim = nullptr);
     virtual ~Gpio();
 
     int32_t setValue(int32_t value);
@@ -24,11 +26,18 @@ public:
     int32_t getEdge()        { return m_edge; }
     int32_t getGpioFd()      { return m_gpioFd; }
 
+    // root of gpio sysfs, change it to a fake tree for test and benchmark
+    static void setSysfsRoot(const std::string& root) { s_sysfsRoot = root; }
+    static const std::string& getSysfsRoot()          { return s_sysfsRoot; }
+
 private:
+    static inline std::string s_sysfsRoot {"/sys/class/gpio"};
+
     int32_t  m_pin;
     int32_t  m_direction;
     int32_t  m_edge;
     int32_t  m_gpioFd;
+    SimBackend* m_sim;
 
     int32_t  setDirection(int32_t direct);
     int32_t  setEdge();
@@ -0,0 +1,58 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+#include <atomic>
+#include <string>
+#include <stdint.h>
+
+/**
+ * @brief edge events of one input pin through the gpio character device (uapi v2)
+ *  the kernel queues every edge with a monotonic timestamp and a sequence
+ *  number, one read takes all queued edges. a gap in the sequence numbers
+ *  means the kernel queue overflowed and edges were dropped. edges closer
+ *  than the glitch time to the last accepted edge are rejected.
+ *  pin is the global number as in sysfs, chip and offset are found from it.
+ */
+class GpioEdge
+{
+public:
+    GpioEdge(int32_t pin, int32_t edge, int32_t glitchUs = 0);
+    virtual ~GpioEdge();
+
+    bool    isValid()   { return m_fd >= 0; }
+    int32_t getFd()     { return m_fd; }
+
+    // read queued events in one call. return edges counted, dropped edges
+    // included, glitches not. 0 when queue is empty, -1 on error
+    int32_t readEdges();
+
+    void    setGlitchUs(int32_t glitchUs)   { m_glitchNs = (int64_t)glitchUs * 1000; }
+    int64_t getLastEdgeNs()    { return m_lastEdgeNs.load(std::memory_order_relaxed); }
+    int64_t getEdgePeriodNs()  { return m_edgePeriodNs.load(std::memory_order_relaxed); }
+    uint64_t getEdges()        { return m_edges.load(std::memory_order_relaxed); }
+    uint64_t getDropped()      { return m_dropped.load(std::memory_order_relaxed); }
+    uint64_t getGlitches()     { return m_glitches.load(std::memory_order_relaxed); }
+
+    // directory of gpiochipN devices, change it for test
+    static void setDevRoot(const std::string& root) { s_devRoot = root; }
+
+    static constexpr int32_t k_eventBufferSize = 64;    // kernel queue per line
+    static constexpr int32_t k_readBatch = 16;          // events per read
+
+private:
+    static inline std::string s_devRoot {"/dev"};
+
+    int32_t findLine(std::string& chipDev, uint32_t& offset);
+
+    int32_t m_pin;
+    int32_t m_fd {-1};
+    int64_t m_glitchNs;
+    uint32_t m_lastSeqno {0};
+
+    // written by reader thread only, read by others
+    std::atomic<int64_t>  m_lastEdgeNs {0};
+    std::atomic<int64_t>  m_edgePeriodNs {0};
+    std::atomic<uint64_t> m_edges {0};
+    std::atomic<uint64_t> m_dropped {0};
+    std::atomic<uint64_t> m_glitches {0};
+};
@@ -1,8 +1,14 @@
 // SPDX-License-Identifier: GPL-2.0
 
 #pragma once
+#include <array>
+#include <atomic>
+#include <memory>
+#include <optional>
 #include <vector>
 #include "gpio.hpp"
+#include "gpio_edge.hpp"
+#include "pwm_channel.hpp"
 
 #define MOTOR_FRONT_LEFT    0
 #define MOTOR_FRONT_RIGHT   1
@@ -16,44 +22,104 @@ enum class MotorState : int32_t {
     Back = -1
 };
 
-class Motor
+// kernel pwm on the enable input of the bridge, chip < 0 for software pwm
+struct MotorPwmOption
+{
+    int32_t chip {-1};
+    int32_t channel {0};
+    int32_t periodNs {50000};
+
+    bool operator==(const MotorPwmOption&) const = default;
+};
+
+// per-tick state of the motors of one car, structure of arrays, index is motor.
+// the speed loop touches only these few cache lines. rpc and io threads set
+// and read the command and counter fields while the speed loop runs, those are
+// relaxed atomics: each value stands alone, ordering comes from the pwm change
+// counter. the others belong to the speed thread
+struct MotorBank
+{
+    std::array<std::atomic<MotorState>, MOTOR_NUM_MAX> runState {};
+    std::array<MotorState, MOTOR_NUM_MAX>              nowState {};
+    std::array<uint8_t, MOTOR_NUM_MAX>                 portState {};     // bit 0, 1: output pins
+    std::array<std::atomic<int32_t>, MOTOR_NUM_MAX>    ctrlPwm {};
+    std::array<int32_t, MOTOR_NUM_MAX>                 pwmBoost {};
+    std::array<std::atomic<int32_t>, MOTOR_NUM_MAX>    ctrlSteps {};
+    std::array<std::atomic<int32_t>, MOTOR_NUM_MAX>    actualSteps {};
+    std::array<std::atomic<int32_t>, MOTOR_NUM_MAX>    encoderCount {};
+    std::array<int32_t, MOTOR_NUM_MAX>                 actualSpeed {};
+};
+
+// pins and channels of one motor, run state in slot index of bank.
+// a motor without bank (test, benchmark) owns one
+class Motor final
 {
 public:
-    Motor(std::vector<uint32_t> port);
-    virtual ~Motor();
+    Motor(std::vector<uint32_t> port, SimBackend* sim = nullptr, MotorPwmOption pwm = {}, int32_t glitchUs = 0,
+          MotorBank* bank = nullptr, int32_t index = 0);
+    ~Motor();
+    Motor(const Motor&) = delete;
+    Motor& operator=(const Motor&) = delete;
 
+    // encoder input: edge events of gpio character device, or sysfs value
+    // with POLLPRI on kernels without it. fd 0 without encoder
     int32_t getInputGpioFd();
+    inline bool hasEdgeEvents()     { return m_inputEdge.has_value(); }
+    inline GpioEdge* getInputEdge() { return m_inputEdge ? &*m_inputEdge : nullptr; }
+
+    // read after poll, return edges to count
+    int32_t readInputEdges();
+    void    setGlitchUs(int32_t glitchUs);
 
-    void setRunState(MotorState state);
-    inline MotorState getRunState()    { return m_runState; }
+    inline void setRunState(MotorState state) { m_bank->runState[m_index].store(state, std::memory_order_relaxed); }
+    inline MotorState getRunState()           { return m_bank->runState[m_index].load(std::memory_order_relaxed); }
 
     void setNowState(MotorState state);
-    inline MotorState getNowState()    { return m_nowState; }
+    inline MotorState getNowState()    { return m_bank->nowState[m_index]; }
+
+    // step target, run state follows its sign
+    void runSteps(int32_t steps);
+    inline void setCtrlSteps(int32_t steps) { m_bank->ctrlSteps[m_index].store(steps, std::memory_order_relaxed); }
+    inline int32_t getCtrlSteps()           { return m_bank->ctrlSteps[m_index].load(std::memory_order_relaxed); }
 
-    void setCtrlSteps(int32_t steps);
-    inline int32_t& getCtrlSteps()  { return m_ctrlSteps; }
+    inline void moveActualSteps(int32_t steps)
+    {
+        m_bank->actualSteps[m_index].fetch_add(steps, std::memory_order_relaxed);
+    }
+    inline void setActualSteps(int32_t steps)  { m_bank->actualSteps[m_index].store(steps, std::memory_order_relaxed); }
+    inline int32_t getActualSteps()            { return m_bank->actualSteps[m_index].load(std::memory_order_relaxed); }
 
-    inline void moveActualSteps(int32_t steps) { m_actualSteps += steps; }
-    inline void setActualSteps(int32_t steps)  { m_actualSteps = steps; }
-    inline int32_t getActualSteps()            { return m_actualSteps; }
+    inline void addEncoderCount(int32_t edges)
+    {
+        m_bank->encoderCount[m_index].fetch_add(edges, std::memory_order_relaxed);
+    }
+    inline int32_t getEncoderCount()           { return m_bank->encoderCount[m_index].load(std::memory_order_relaxed); }
+    inline int32_t getActualSpeed()            { return m_bank->actualSpeed[m_index]; }
 
-    inline void setRunPwm(int32_t pwm) { m_ctrlPwm = pwm; }
-    inline int32_t getRunPwm()         { return m_ctrlPwm; }
-    inline int32_t getStopPwm()        { return m_maxPwm - m_ctrlPwm; }
+    inline void setRunPwm(int32_t pwm) { m_bank->ctrlPwm[m_index].store(pwm, std::memory_order_relaxed); }
+    inline int32_t getRunPwm()         { return m_bank->ctrlPwm[m_index].load(std::memory_order_relaxed); }
+    inline int32_t getStopPwm()        { return m_maxPwm - getDrivePwm(); }
     static int32_t getMaxPwm()         { return m_maxPwm; }
 
-    int32_t m_actualSpeed { 0 };
-    int32_t m_swCounter { 0 };
+    // boost added to run pwm by stall and slip response, pins take drive pwm
+    inline void setPwmBoost(int32_t boost) { m_bank->pwmBoost[m_index] = boost; }
+    inline int32_t getPwmBoost()           { return m_bank->pwmBoost[m_index]; }
+    int32_t getDrivePwm();
+    inline bool hasEncoder()               { return m_inputGpio.has_value() || m_inputEdge.has_value(); }
+
+    // hardware pwm: direction pins hold run state, channel runs duty of run pwm
+    inline bool isHwPwm()              { return m_pwmChannel.has_value(); }
+    void applyHwPwm();
 
 private:
-    Gpio*   m_outputGpio[2] {nullptr, nullptr};
-    Gpio*   m_inputGpio {nullptr};
-    int32_t m_portState[2];
-    MotorState m_runState { MotorState::Stop };
-    MotorState m_nowState { MotorState::Stop };
-    int32_t m_ctrlSteps { 0 };
-    int32_t m_actualSteps { 0 };
+    std::unique_ptr<MotorBank> m_ownBank;
+    MotorBank* m_bank;
+    int32_t    m_index;
+
+    Gpio m_outputGpio[2];
+    std::optional<Gpio>       m_inputGpio;
+    std::optional<GpioEdge>   m_inputEdge;
+    std::optional<PwmChannel> m_pwmChannel;
 
     static constexpr int32_t m_maxPwm { 100 };
-    int32_t m_ctrlPwm { 50 };
 };
@@ -0,0 +1,114 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+#include <array>
+#include <memory>
+#include <span>
+#include <utility>
+#include "motor.hpp"
+#include "flight_recorder.hpp"
+#include "pwm_scheduler.hpp"
+#include "stall_detector.hpp"
+#include "speed_config.hpp"
+#include "telemetry_history.hpp"
+
+/**
+ * @brief motors of one car
+ *  motors sit in one array, their per-tick state in one MotorBank. the loops
+ *  of the speed tick are compiled for each motor number, so the 2 motor
+ *  orangepipc and 4 motor nanopim1 loops are unrolled. the variant is chosen
+ *  once at start from motor_num of param.json, then one virtual call per step.
+ */
+class MotorSet
+{
+public:
+    virtual ~MotorSet() = default;
+
+    static std::unique_ptr<MotorSet> create(const SpeedConfig& config, SimBackend* sim);
+
+    int32_t     size()                  { return m_size; }
+    Motor&      operator[](int32_t i)   { return *m_motor[i]; }
+    ChassisKind getChassis()            { return m_chassis; }
+
+    virtual void buildPwm(PwmScheduler& scheduler, int64_t now) = 0;
+    virtual StallDetector::Action checkStall(StallDetector& detector, int64_t now) = 0;
+    virtual void fillRecord(FlightRecord& rec, PwmScheduler& scheduler, int64_t now) = 0;
+    virtual void fillSample(HistorySample& sample) = 0;
+
+    // set run state of all motors to stop, return true when one was running
+    virtual bool stopAll() = 0;
+
+protected:
+    MotorSet(int32_t size, ChassisKind chassis) : m_size{size}, m_chassis{chassis} {}
+
+    MotorBank   m_bank;
+    int32_t     m_size;
+    ChassisKind m_chassis;
+    std::array<Motor*, MOTOR_NUM_MAX> m_motor {};
+};
+
+template <size_t N>
+class MotorSetN final : public MotorSet
+{
+public:
+    MotorSetN(const SpeedConfig& config, SimBackend* sim) :
+        MotorSetN(config, sim, std::make_index_sequence<N>{})
+    {
+    }
+
+    void buildPwm(PwmScheduler& scheduler, int64_t now) override
+    {
+        scheduler.build(std::span<Motor, N>(m_motors), now);
+    }
+
+    StallDetector::Action checkStall(StallDetector& detector, int64_t now) override
+    {
+        return detector.tick(std::span<Motor, N>(m_motors), now);
+    }
+
+    void fillRecord(FlightRecord& rec, PwmScheduler& scheduler, int64_t now) override
+    {
+        rec.motorNum = static_cast<uint8_t>(N);
+        for (size_t i = 0; (i < N) && (i < k_flightRecMotors); i++) {
+            auto& motor = rec.motor[i];
+            motor.runState = static_cast<int8_t>(m_motors[i].getRunState());
+            motor.nowState = static_cast<int8_t>(m_bank.nowState[i]);
+            motor.pwmCount = static_cast<uint8_t>(scheduler.getPhaseCount(i, now));
+            motor.runPwm = static_cast<uint8_t>(m_motors[i].getDrivePwm());
+            motor.encoder = static_cast<uint32_t>(m_motors[i].getEncoderCount());
+            motor.actualSteps = m_motors[i].getActualSteps();
+        }
+    }
+
+    void fillSample(HistorySample& sample) override
+    {
+        for (size_t i = 0; i < N; i++) {
+            sample.value[static_cast<int32_t>(HistoryMetric::Speed) * MOTOR_NUM_MAX + i] = m_motors[i].getEncoderCount();
+            sample.value[static_cast<int32_t>(HistoryMetric::Pwm) * MOTOR_NUM_MAX + i] =
+                static_cast<int32_t>(m_motors[i].getRunState()) * m_motors[i].getDrivePwm();
+            sample.value[static_cast<int32_t>(HistoryMetric::Steps) * MOTOR_NUM_MAX + i] = m_motors[i].getActualSteps();
+        }
+    }
+
+    bool stopAll() override
+    {
+        bool running = false;
+        for (size_t i = 0; i < N; i++) {
+            running |= (m_bank.runState[i].exchange(MotorState::Stop, std::memory_order_relaxed) != MotorState::Stop);
+        }
+        return running;
+    }
+
+private:
+    template <size_t... I>
+    MotorSetN(const SpeedConfig& config, SimBackend* sim, std::index_sequence<I...>) :
+        MotorSet(N, config.chassis),
+        m_motors{Motor(config.motor[I].port, sim, config.motor[I].pwm, config.encoderGlitchUs, &m_bank, I)...}
+    {
+        for (size_t i = 0; i < N; i++) {
+            m_motor[i] = &m_motors[i];
+        }
+    }
+
+    std::array<Motor, N> m_motors;
+};
@@ -0,0 +1,54 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include <rpc_service.hpp>
+
+class CarCtrl;
+class CarSpeed;
+
+/**
+ * @brief pwm table calibration with the car on a stand
+ *  all wheels run forward through a pwm sweep, the steady encoder rate at each
+ *  point gives a pwm->rate curve per wheel. pwm of level 1-9 is solved so that
+ *  all wheels reach the same rate, then written back to param.json.
+ *  runs in CTRL_MODE_SPEED, any other control mode cancels it.
+ */
+class PwmCalibrate
+{
+public:
+    PwmCalibrate(CarCtrl* carCtrl, CarSpeed& carSpeed);
+    virtual ~PwmCalibrate();
+
+    int32_t start();
+    void    cancel();
+    bool    isRunning() { return m_running.load(); }
+    CalibrateState getState();
+
+    // pwm of each level for each wheel, from rate[wheel][point] measured at sweepPwm[point].
+    // empty when a wheel has no encoder edge
+    static std::vector<std::vector<int32_t>> solveLevels(const std::vector<int32_t>& sweepPwm,
+                                                          const std::vector<std::vector<double>>& rate,
+                                                          int32_t levelNum);
+
+    static constexpr int32_t k_sweepStep = 10;      // pwm step of sweep
+    static constexpr int32_t k_settleTime = 1000;   // ms, wheel speed settles after pwm change
+    static constexpr int32_t k_measureTime = 2000;  // ms, encoder count window
+
+private:
+    void run();
+    bool waitFor(int32_t time);
+    void finish(int32_t state, std::string message);
+    int32_t saveParam(const std::vector<std::vector<int32_t>>& pwm);
+
+    CarCtrl*  m_carCtrl;
+    CarSpeed& m_carSpeed;
+    std::thread       m_thread;
+    std::atomic<bool> m_running {false};
+    std::atomic<bool> m_cancel {false};
+    std::mutex        m_mutex;
+    CalibrateState    m_state {};
+};
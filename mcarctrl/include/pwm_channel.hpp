@@ -0,0 +1,45 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+#include <string>
+#include <stdint.h>
+#include "sim_backend.hpp"
+
+// pin number of pwm channel in simulated gpio log: base + chip * 32 + channel
+static constexpr int32_t k_simPwmPinBase = 1000;
+
+// kernel pwm channel, /sys/class/pwm/pwmchipN/pwmM/{period,duty_cycle,enable}
+class PwmChannel
+{
+public:
+    PwmChannel(int32_t chip, int32_t channel, int32_t periodNs, SimBackend* sim = nullptr);
+    virtual ~PwmChannel();
+
+    bool    isValid()      { return m_valid; }
+    int32_t getPeriodNs()  { return m_periodNs; }
+
+    // duty time in ns, only changed values go to sysfs
+    int32_t setDutyNs(int32_t dutyNs);
+    int32_t setEnable(bool enable);
+
+    // root of pwm sysfs, change it to a fake tree for test and benchmark
+    static void setSysfsRoot(const std::string& root) { s_sysfsRoot = root; }
+    static const std::string& getSysfsRoot()          { return s_sysfsRoot; }
+
+private:
+    static inline std::string s_sysfsRoot {"/sys/class/pwm"};
+
+    int32_t exportChannel();
+    int32_t unexportChannel();
+    int32_t writeAttr(const char* attr, int64_t value);
+
+    int32_t m_chip;
+    int32_t m_channel;
+    int32_t m_periodNs;
+    int32_t m_dutyFd {-1};
+    int32_t m_enableFd {-1};
+    int32_t m_duty {-1};
+    int32_t m_enable {-1};
+    bool    m_valid {false};
+    SimBackend* m_sim;
+};
@@ -0,0 +1,53 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+#include <array>
+#include <span>
+#include "motor.hpp"
+
+/**
+ * @brief software pwm of all motors with staggered phases
+ *  motor i switches on at i/motorNum of the period, so motors do not start
+ *  together. the edge table is built once per pwm or state change, then the
+ *  speed loop only applies due edges and sleeps until the next one.
+ *  motors with kernel pwm get no edges, their channel is set at build.
+ *  build is specialised on motor number, the table has fixed size.
+ */
+class PwmScheduler
+{
+public:
+    PwmScheduler(int32_t stepUs);
+    virtual ~PwmScheduler() = default;
+
+    // rebuild edge table from run state and pwm of motors, pins follow at once
+    template <size_t N>
+    void    build(std::span<Motor, N> motor, int64_t now);
+
+    // apply edges due at now. return time of next edge, 0 without edges
+    int64_t run(int64_t now);
+
+    // steps since motor phase start in current period
+    int32_t getPhaseCount(int32_t motor, int64_t now);
+    int32_t getPeriodUs() { return m_periodUs; }
+
+private:
+    struct PwmEdge {
+        int32_t offset;     // us from period start
+        int32_t motor;
+        bool    on;
+    };
+
+    void    resync(int64_t now);
+    int64_t nextTime();
+
+    int32_t m_stepUs;
+    int32_t m_periodUs;
+    int64_t m_periodStart {-1};
+    size_t  m_next {0};
+    Motor*  m_motor {nullptr};
+    int32_t m_motorNum {0};
+    size_t  m_edgeNum {0};
+    std::array<int32_t, MOTOR_NUM_MAX> m_phase {};          // us, on edge of each motor
+    std::array<int32_t, MOTOR_NUM_MAX> m_onTime {};         // us, pwm at build time
+    std::array<PwmEdge, MOTOR_NUM_MAX * 2> m_edge {};
+};
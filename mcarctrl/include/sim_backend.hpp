@@ -0,0 +1,50 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <stdint.h>
+
+struct SimGpioEvent
+{
+    int64_t time;     // virtual time in us
+    int32_t pin;
+    int32_t value;
+};
+
+// simulated hardware for car control: virtual clock and gpio output log.
+// gpio created with a backend never touches sysfs.
+class SimBackend
+{
+public:
+    SimBackend() = default;
+    virtual ~SimBackend() = default;
+
+    void    setTime(int64_t time)     { m_time.store(time); }
+    void    advanceTime(int64_t time) { m_time.fetch_add(time); }
+    int64_t getTime()                 { return m_time.load(); }
+
+    void writePin(int32_t pin, int32_t value)
+    {
+        if (!m_logEnable.load(std::memory_order_relaxed)) {
+            return;
+        }
+        std::lock_guard lock(m_mutex);
+        m_events.push_back({getTime(), pin, value});
+    }
+
+    void setLogEnable(bool enable) { m_logEnable.store(enable); }
+
+    std::vector<SimGpioEvent> takeEvents()
+    {
+        std::lock_guard lock(m_mutex);
+        return std::move(m_events);
+    }
+
+private:
+    std::atomic<int64_t>      m_time {0};
+    std::mutex                m_mutex;
+    std::atomic<bool>         m_logEnable {true};
+    std::vector<SimGpioEvent> m_events;
+};
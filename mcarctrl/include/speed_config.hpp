@@ -0,0 +1,95 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+#include <array>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "motor.hpp"
+
+static constexpr std::string_view k_deviceNamePc = "orangepipc";
+static constexpr std::string_view k_deviceNameM1 = "nanopim1";
+static constexpr std::string_view k_deviceNameOneplus = "orangepioneplus";
+
+// items of pwm table in param.json, index is speed level
+static constexpr std::array<std::string_view, 10> k_pwmLevelNames = {
+    "zero", "one", "two", "three", "four", "five", "six", "seven", "eight", "nine"};
+
+// chassis of the car, "chassis" item of param.json
+enum class ChassisKind : int32_t {
+    Mecanum,        // four mecanum wheels, nanopim1
+    Steer           // drive motors and steering, orangepipc
+};
+static constexpr std::array<std::string_view, 2> k_chassisNames = {"mecanum", "steer"};
+
+// real-time mode of speed thread, "realtime" item of param.json
+struct RealtimeOption
+{
+    std::string policy {"other"};       // other, fifo or deadline
+    int32_t     priority {80};          // fifo priority
+    int32_t     cpu {-1};               // pin speed thread and keep other threads off, -1 no pinning
+    bool        lockMemory {false};     // mlockall and prefault thread stack
+
+    bool operator==(const RealtimeOption&) const = default;
+};
+
+// stall and slip detection of wheels with encoder, "stall" item of param.json
+struct StallOption
+{
+    std::string response {"report"};   // report, boost or stop
+    int32_t     windowMs {300};         // check window, wheel driven for all of it
+    int32_t     minRate {20};           // edges/s, a driven wheel below is stalled
+    double      slipRatio {3.0};        // rate per pwm against median of others, 0 off
+    int32_t     boostPwm {15};          // pwm added on stall, taken off on slip
+    int32_t     holdWindows {3};        // clean windows a boost is kept, and a wheel is clean before a new fault
+
+    bool operator==(const StallOption&) const = default;
+};
+
+struct MotorConfig
+{
+    std::vector<uint32_t> port;         // two output pins, encoder input pin if any
+    MotorPwmOption        pwm;
+
+    bool operator==(const MotorConfig&) const = default;
+};
+
+// device item of param.json. a loaded snapshot is never changed, reload makes a new one
+struct SpeedConfig
+{
+    std::string deviceName;
+    ChassisKind chassis {ChassisKind::Mecanum};
+    int32_t     motorNum {0};
+    std::vector<MotorConfig> motor;
+    std::vector<uint32_t>    steer;
+    std::vector<std::vector<int32_t>> pwmTable;     // [level][motor]
+    int32_t     watchdogTime {1000};                // ms, 0 to disable
+    int32_t     encoderGlitchUs {0};                // encoder edges closer than this are rejected
+    std::string recorderFile;
+    int32_t     recorderTime {0};                   // s
+    std::string recorderArchive;                    // compact copy of whole run
+    int32_t     recorderArchiveMb {0};
+    std::string snapshotFile;
+    int32_t     snapshotMs {0};                     // save period of controller state
+    RealtimeOption realtime;
+    StallOption    stall;
+};
+
+/**
+ * @brief read and check device item of param file
+ *  the device item is bound to typed structs in one pass. a valid config is
+ *  also written to a struct_pack cache beside the param file, the next start
+ *  reads it instead of parsing json while the param file is unchanged.
+ *
+ * @param errors: every problem found, not only the first one
+ * @param useCache: read and write the binary cache
+ * @return false: config is incomplete, errors tell why
+ */
+bool loadSpeedConfig(const std::string& fileName, const std::string& deviceName,
+                     SpeedConfig& config, std::vector<std::string>& errors, bool useCache = true);
+
+// binary cache of parsed config, param.json -> param.json.cache
+std::string getConfigCacheName(const std::string& fileName);
+
+// items that differ and need new gpio or pwm channels, empty when none
+std::vector<std::string> diffHardware(const SpeedConfig& oldConfig, const SpeedConfig& newConfig);
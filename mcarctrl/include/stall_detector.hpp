@@ -0,0 +1,72 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+#include <array>
+#include <atomic>
+#include <span>
+#include "motor.hpp"
+#include "speed_config.hpp"
+
+#define WHEEL_FAULT_NONE    0
+#define WHEEL_FAULT_STALL   1
+#define WHEEL_FAULT_SLIP    2
+
+/**
+ * @brief stall and slip detection from encoder rate, run in speed loop
+ *  a wheel driven for a whole window with encoder rate below minRate is
+ *  stalled. a wheel whose rate per pwm is slipRatio above the median of the
+ *  other driven wheels slips. wheels without encoder are not checked.
+ *  response boost: stall adds boostPwm, slip takes it off. the boost is kept
+ *  for holdWindows clean windows, a fault that comes back before the wheel
+ *  was clean that long without boost is not counted again and keeps the
+ *  boost until the wheel stops. a wheel still stalled with boost stops the
+ *  car. response stop: first stall or slip stops the car. response report:
+ *  count and log only.
+ */
+class StallDetector
+{
+public:
+    enum class Action : int32_t {
+        None,
+        Rebuild,    // pwm boost changed
+        Stop        // stop all motors
+    };
+
+    StallDetector() = default;
+    virtual ~StallDetector() = default;
+
+    void   setOption(const StallOption& option) { m_option = option; }
+
+    // off while pwm calibration sweeps below start pwm of wheels
+    void   setEnable(bool enable) { m_enable.store(enable); }
+
+    // sample run state each tick, check rates at end of window
+    template <size_t N>
+    Action tick(std::span<Motor, N> motor, int64_t now);
+
+    int32_t  getRate(int32_t motor)   { return m_wheel[motor].rate.load(std::memory_order_relaxed); }
+    int32_t  getFault(int32_t motor)  { return m_wheel[motor].fault.load(std::memory_order_relaxed); }
+    uint32_t getStalls(int32_t motor) { return m_wheel[motor].stalls.load(std::memory_order_relaxed); }
+    uint32_t getSlips(int32_t motor)  { return m_wheel[motor].slips.load(std::memory_order_relaxed); }
+
+private:
+    struct Wheel {
+        int32_t lastCount {0};
+        bool    driven {false};         // driven at every tick of window
+        int32_t episode {WHEEL_FAULT_NONE};     // fault until holdWindows clean windows without boost
+        int32_t clean {0};              // clean windows in a row
+        bool    keepBoost {false};      // fault came back without boost, keep it until stop
+        std::atomic<int32_t>  rate {0};
+        std::atomic<int32_t>  fault {WHEEL_FAULT_NONE};
+        std::atomic<uint32_t> stalls {0};
+        std::atomic<uint32_t> slips {0};
+    };
+
+    template <size_t N>
+    Action check(std::span<Motor, N> motor, int32_t windowUs);
+
+    StallOption m_option;
+    std::atomic<bool> m_enable {true};
+    int64_t     m_windowStart {-1};
+    std::array<Wheel, MOTOR_NUM_MAX> m_wheel;
+};
@@ -9,7 +9,7 @@
 class Steer
 {
 public:
-    Steer(asio::io_context& context, std::vector<uint32_t> port);
+    Steer(asio::io_context& context, std::vector<uint32_t> port, SimBackend* sim = nullptr);
     virtual ~Steer();
 
     // time >0 turn left, <0 turn right, =0 stop. 
@@ -0,0 +1,78 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <stdint.h>
+#include "flight_recorder.hpp"
+
+// compact flight records: a file header, then blocks of up to
+// k_telemetryBlockRecords records. in a block each field is one column:
+// counters and steps as zig-zag varint of the delta to the record before,
+// state fields as runs of (value, length). a tick of 4 motors takes about
+// 15 bytes instead of 72. layout is shared with flightrec, bump version on change.
+static constexpr uint32_t k_telemetryFileMagic    = 0x46564741;  // "AGVF"
+static constexpr uint32_t k_telemetryBlockMagic   = 0x42564741;  // "AGVB"
+static constexpr uint16_t k_telemetryVersion      = 1;
+static constexpr int32_t  k_telemetryBlockRecords = 1024;
+
+struct TelemetryFileHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t tickUs;          // control period
+    uint32_t reserved2;
+    uint64_t realtimeUs;      // wall clock at steadyUs
+    uint64_t steadyUs;
+};
+static_assert(sizeof(TelemetryFileHeader) == 32, "telemetry file header layout changed");
+
+struct TelemetryBlockHeader
+{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;           // records
+    uint32_t length;          // payload bytes after header
+    uint32_t checksum;        // fnv-1a of payload
+    uint64_t firstSeq;
+    uint64_t firstTimestamp;  // steady clock us
+};
+static_assert(sizeof(TelemetryBlockHeader) == 32, "telemetry block header layout changed");
+
+// block of a file, found from block headers without decoding payloads
+struct TelemetryBlockIndex
+{
+    uint64_t firstSeq;
+    uint64_t firstTimestamp;
+    uint32_t count;
+    size_t   offset;          // of block header in data
+};
+
+class TelemetryCodec
+{
+public:
+    static void putFileHeader(std::string& out, uint32_t tickUs, uint64_t realtimeUs, uint64_t steadyUs);
+    static bool getFileHeader(std::string_view data, TelemetryFileHeader& header);
+
+    /**
+     * @brief append blocks of records to out
+     *
+     * @param records: in seq order, more than one block are split
+     * @return bytes appended
+     */
+    static size_t encode(std::span<const FlightRecord> records, std::string& out);
+
+    /**
+     * @brief decode one block at start of data, append its records. checksum
+     *  of decoded records is 0, the block checksum covers them
+     *
+     * @return bytes of block, 0 when data holds no valid block
+     */
+    static size_t decode(std::string_view data, std::vector<FlightRecord>& records);
+
+    // blocks of a whole file, stops at first torn block
+    static std::vector<TelemetryBlockIndex> index(std::string_view data);
+};
@@ -0,0 +1,100 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
+#include <stdint.h>
+#include "motor.hpp"
+
+enum class HistoryMetric : int32_t {
+    Speed,      // encoder edges/s
+    Pwm,        // drive pwm, negative backward, 0 stopped
+    Steps,      // actual steps
+    Mode,       // ctrl mode, one series
+    Num
+};
+static constexpr const char* k_historyMetricNames[] = {"speed", "pwm", "steps", "mode"};
+
+// series index: metric * MOTOR_NUM_MAX + motor
+static constexpr int32_t k_historySeries = static_cast<int32_t>(HistoryMetric::Num) * MOTOR_NUM_MAX;
+
+// values of one 1 ms sample, speed series hold the raw encoder counter
+struct HistorySample
+{
+    std::array<int32_t, k_historySeries> value {};
+};
+
+struct HistoryStat
+{
+    int32_t min;
+    int32_t max;
+    int32_t mean;
+};
+
+struct HistoryRow
+{
+    int64_t  timeUs;        // steady clock, start of bucket
+    uint32_t count;         // samples or buckets below
+    std::array<HistoryStat, k_historySeries> stat;
+};
+
+/**
+ * @brief in-memory telemetry of the speed loop at four resolutions
+ *  1 ms samples of the speed loop roll up into 10 ms, 1 s and 1 min
+ *  buckets with min, max and mean, each level a fixed ring. the speed thread
+ *  appends and closes buckets, nothing is allocated after start. a query
+ *  picks the level by range and resolution and copies that ring only.
+ *  readers do not lock: they copy rows, then drop the ones the writer may
+ *  have overwritten meanwhile, as known from the ring sequence.
+ */
+class TelemetryHistory
+{
+public:
+    static constexpr int32_t k_levels = 4;
+    static constexpr int64_t k_levelUs[k_levels]   = {1000, 10000, 1000000, 60000000};
+    static constexpr int32_t k_levelRows[k_levels] = {2000, 6000, 3600, 1440};      // 2 s, 1 min, 1 h, 1 day
+    static constexpr int32_t k_maxPoints = 1000;
+
+    TelemetryHistory();
+    virtual ~TelemetryHistory() = default;
+
+    // speed thread, now in steady us
+    void append(int64_t now, const HistorySample& sample);
+
+    /**
+     * @brief closed buckets of a time range
+     *
+     * @param fromUs, toUs: steady time range
+     * @param resolutionUs: least bucket width, 0 for auto
+     * @param now: steady time us, for length of history
+     * @param rows: buckets in time order
+     * @return bucket width in us of chosen level
+     */
+    int64_t query(int64_t fromUs, int64_t toUs, int64_t resolutionUs, int64_t now, std::vector<HistoryRow>& rows);
+
+private:
+    struct Level
+    {
+        std::unique_ptr<HistoryRow[]> rows;
+        std::atomic<uint64_t> writeSeq {0};             // rows written
+        int64_t  openStart {0};                         // bucket being filled
+        uint32_t count {0};
+        std::array<int32_t, k_historySeries> min {};
+        std::array<int32_t, k_historySeries> max {};
+        std::array<int64_t, k_historySeries> sum {};
+    };
+
+    int32_t selectLevel(int64_t fromUs, int64_t toUs, int64_t resolutionUs, int64_t now);
+    void    openBucket(Level& level, int64_t start);
+    void    closeBucket(int32_t level);
+    void    addRow(int32_t level, const HistoryRow& row);
+
+    std::array<Level, k_levels> m_level;
+
+    // speed series of 1 ms level: counters at end of bucket and of the bucket before
+    std::array<int32_t, k_historySeries> m_lastCount {};
+    std::array<int32_t, k_historySeries> m_baseCount {};
+    int64_t m_baseTime {-1};
+};
@@ -7,8 +7,14 @@
 #include <xapi/param_json.hpp>
 #include "car_ctrl.hpp"
 
-CarCtrl::CarCtrl(asio::io_context& context) :
-    m_carSpeed(context, this),
+namespace {
+
+thread_local CarCtrl* t_boundCar = nullptr;
+
+}  // namespace
+
+CarCtrl::CarCtrl(asio::io_context& context, CarOption option) :
+    m_carSpeed(context, this, std::move(option)),
     m_runTimer(context, runTimeCallback, this, false)
 {
 }
@@ -18,6 +24,19 @@ CarCtrl::~CarCtrl()
     m_runTimer.stop();
 }
 
+CarCtrl& CarCtrl::current()
+{
+    if (t_boundCar) {
+        return *t_boundCar;
+    }
+    return cmn::getSingletonInstance<CarCtrl>();
+}
+
+void CarCtrl::bindThread(CarCtrl* carCtrl)
+{
+    t_boundCar = carCtrl;
+}
+
 
 int32_t CarCtrl::getActualSpeed(int32_t motor)
 {
@@ -114,6 +133,8 @@ int32_t CarCtrl::setRunTime(int32_t time)
     for (int32_t i = 0; i < m_carSpeed.getMotorNum(); i++) {
         m_carSpeed.setActualSteps(i, 0);
     }
+    // run time has own stop timer, watchdog only covers timer failure
+    m_carSpeed.feedWatchdog(std::abs(time) * 1000);
     if (time > 0) {
         setAllMotorState(static_cast<int32_t>(MotorState::Forward));
         m_runTimer.start(time * 1000);
@@ -178,6 +199,7 @@ void CarCtrl::setAllMotorState(int32_t state)
     }
     if (state == 0) {
         m_carSpeed.steerTurn(0, 0);
+        m_calibrate.cancel();
     }
 }
 
@@ -213,6 +235,7 @@ int32_t CarCtrl::setCarSteps(CarDirection dir, int32_t steps)
 
 int32_t CarCtrl::setCarMoving(CarDirection dir)
 {
+    m_carSpeed.feedWatchdog();
     m_ctrlMode = CTRL_MODE_TIME;
     switch (dir) {
     case CarDirection::dirUp:
@@ -275,3 +298,61 @@ int32_t CarCtrl::steerTurn(int32_t dir, uint32_t time)
     m_carSpeed.steerTurn(dir, time);
     return 0;
 }
+
+int32_t CarCtrl::keepAlive()
+{
+    m_carSpeed.feedWatchdog();
+    return 0;
+}
+
+int32_t CarCtrl::getWatchdogTrips()
+{
+    return m_carSpeed.getWatchdogTrips();
+}
+
+int32_t CarCtrl::getWatchdogLatency()
+{
+    return m_carSpeed.getWatchdogLatency();
+}
+
+LoopJitter CarCtrl::getLoopJitter()
+{
+    return m_carSpeed.getLoopJitter();
+}
+
+std::vector<EncoderState> CarCtrl::getEncoderState()
+{
+    return m_carSpeed.getEncoderState();
+}
+
+TelemetrySeries CarCtrl::getTelemetryHistory(const std::string& metric, int64_t from, int64_t to,
+                                             int32_t resolution)
+{
+    return m_carSpeed.getTelemetryHistory(metric, from, to, resolution);
+}
+
+FlightRecordChunk CarCtrl::getFlightRecords(uint64_t fromSeq)
+{
+    return m_carSpeed.getFlightRecords(fromSeq);
+}
+
+int32_t CarCtrl::autoCalibrate(int32_t action)
+{
+    if (!action) {
+        m_calibrate.cancel();
+        return 0;
+    }
+    if (m_calibrate.isRunning()) {
+        ctrllog::warn("calibrate is running");
+        return -1;
+    }
+
+    m_runTimer.stop();
+    m_ctrlMode = CTRL_MODE_SPEED;
+    return m_calibrate.start();
+}
+
+CalibrateState CarCtrl::getCalibrateState()
+{
+    return m_calibrate.getState();
+}
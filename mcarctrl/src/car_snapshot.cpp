@@ -0,0 +1,113 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <fcntl.h>
+#include <unistd.h>
+#include <chrono>
+#include <cstring>
+#include <ylt/struct_pack.hpp>
+#include <xapi/easylog.hpp>
+#include "car_snapshot.hpp"
+#include "checksum.hpp"
+
+SnapshotStore::~SnapshotStore()
+{
+    close();
+}
+
+bool SnapshotStore::open(const std::string& fileName)
+{
+    close();
+    m_fd = ::open(fileName.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (m_fd < 0) {
+        ctrllog::warn("snapshot: fail to open {}: {}", fileName, strerror(errno));
+        return false;
+    }
+    m_fileName = fileName;
+    m_seq = 0;
+    return true;
+}
+
+void SnapshotStore::close()
+{
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+bool SnapshotStore::readSlot(int32_t slot, SnapshotSlotHeader& header, CarSnapshot& snap)
+{
+    char buffer[k_snapshotSlotSize];
+    ssize_t len = pread(m_fd, buffer, sizeof(buffer), (off_t)slot * k_snapshotSlotSize);
+    if (len < static_cast<ssize_t>(sizeof(header))) {
+        return false;
+    }
+
+    memcpy(&header, buffer, sizeof(header));
+    if ((header.magic != k_snapshotMagic) || (header.version != k_snapshotVersion)
+        || (header.length > len - sizeof(header))) {
+        return false;
+    }
+    const char* payload = buffer + sizeof(header);
+    if (fnv1a(payload, header.length) != header.checksum) {
+        ctrllog::warn("snapshot: slot {} of {} has bad checksum", slot, m_fileName);
+        return false;
+    }
+    return !struct_pack::deserialize_to(snap, payload, header.length);
+}
+
+bool SnapshotStore::load(CarSnapshot& snap)
+{
+    if (m_fd < 0) {
+        return false;
+    }
+
+    int32_t newest = -1;
+    SnapshotSlotHeader header[2] {};
+    CarSnapshot slot[2];
+    for (int32_t i = 0; i < 2; i++) {
+        if (readSlot(i, header[i], slot[i]) && ((newest < 0) || (header[i].seq > header[newest].seq))) {
+            newest = i;
+        }
+    }
+    if (newest < 0) {
+        return false;
+    }
+
+    // next save goes to the other slot
+    m_seq = header[newest].seq;
+    snap = std::move(slot[newest]);
+    return true;
+}
+
+bool SnapshotStore::save(const CarSnapshot& snap)
+{
+    if (m_fd < 0) {
+        return false;
+    }
+
+    char buffer[k_snapshotSlotSize] {};
+    auto payload = struct_pack::serialize<std::string>(snap);
+    if (payload.size() > sizeof(buffer) - sizeof(SnapshotSlotHeader)) {
+        ctrllog::error("snapshot: {} bytes do not fit in a slot", payload.size());
+        return false;
+    }
+
+    SnapshotSlotHeader header {};
+    header.magic = k_snapshotMagic;
+    header.version = k_snapshotVersion;
+    header.length = static_cast<uint16_t>(payload.size());
+    header.seq = m_seq + 1;
+    header.realtimeUs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    header.checksum = fnv1a(payload.data(), payload.size());
+    memcpy(buffer, &header, sizeof(header));
+    memcpy(buffer + sizeof(header), payload.data(), payload.size());
+
+    off_t offset = (off_t)(header.seq % 2) * k_snapshotSlotSize;
+    if ((pwrite(m_fd, buffer, sizeof(buffer), offset) != sizeof(buffer)) || (fdatasync(m_fd) < 0)) {
+        ctrllog::warn("snapshot: fail to write {}: {}", m_fileName, strerror(errno));
+        return false;
+    }
+    m_seq = header.seq;
+    return true;
+}
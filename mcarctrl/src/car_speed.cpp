@@ -1,34 +1,80 @@
 // SPDX-License-Identifier: GPL-2.0
 #include <iostream>
 #include <fstream>
+#include <bit>
+#include <time.h>
+#include <sys/eventfd.h>
 
 #include <xapi/cmn_singleton.hpp>
 #include <xapi/easylog.hpp>
+#include <xapi/metrics.hpp>
 #include <xapi/param_json.hpp>
 #include "car_speed.hpp"
 #include "car_ctrl.hpp"
+#include "telemetry_codec.hpp"
 
-CarSpeed::CarSpeed(asio::io_context& context, CarCtrl *carCtrl) :
+namespace {
+
+// records of one getFlightRecords call, 4 s of ticks
+constexpr size_t k_flightChunkRecords = 4 * k_telemetryBlockRecords;
+
+metrics::Histogram g_tickSeconds {"agvctrl_control_tick_seconds", "cpu time of one control tick",
+                                  metrics::k_latencyBoundsUs, 1e6};
+metrics::Histogram g_wakeSeconds {"agvctrl_control_wake_latency_seconds",
+                                  "control loop wake-up behind its deadline", metrics::k_latencyBoundsUs, 1e6};
+metrics::Counter   g_encoderEdges {"agvctrl_encoder_edges_total", "encoder edges counted by the control loop"};
+metrics::Counter   g_watchdogTrips {"agvctrl_watchdog_trips_total", "motors stopped for a missing setpoint"};
+
+}  // namespace
+
+CarSpeed::CarSpeed(asio::io_context& context, CarCtrl *carCtrl, CarOption option) :
     m_context{context},
+    m_option{std::move(option)},
     m_speedThread{"speed thread", cmn::CmnThread::ThreadPriorityNormal, CarSpeed::threadFun, this},
-    m_carCtrl{carCtrl}
+    m_carCtrl{carCtrl},
+    m_paramWatch{context, [this](const asio::error_code &e, void *ctxt) {
+        reloadParam();
+    }},
+    m_recorderTimer{context, [this](const asio::error_code &e, void *ctxt) {
+        m_recorder.archive();
+        m_recorder.sync();
+    }, nullptr, true},
+    m_snapshotTimer{context, [this](const asio::error_code &e, void *ctxt) {
+        saveSnapshot();
+    }, nullptr, true}
 {
     initJsonParam();
 
-    // start thread in cpu1
-    //m_speedThread.setCpuAffinity(1);
-
-    m_speedThread.start();
+    // without motors there is nothing to drive, rpc calls see motor number 0
+    if (m_option.startThread && m_motorSet) {
+        m_paramWatch.start(m_option.paramFile);
+        m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (m_wakeFd < 0) {
+            ctrllog::warn("speed thread: no eventfd, changes wait for next pwm edge");
+        }
+        if (m_rtOption.cpu >= 0) {
+            // threads created by this one later (rpc, timers) inherit the mask
+            cmn::CmnThread::excludeSelfCpu(m_rtOption.cpu);
+        }
+        m_speedThread.start();
+        if (m_rtOption.policy == "fifo") {
+            m_speedThread.setSchedPolicy(SCHED_FIFO, m_rtOption.priority);
+        }
+    }
 }
 
 CarSpeed::~CarSpeed()
 {
     m_speedThread.stop();
-
-    for (auto& item : m_motor) {
-        delete item;
+    m_paramWatch.stop();
+    m_recorderTimer.stop();
+    m_recorder.close();
+    m_snapshotTimer.stop();
+    saveSnapshot();
+    m_snapshot.close();
+    if (m_wakeFd >= 0) {
+        close(m_wakeFd);
     }
-    m_motor.clear();
 
     if (m_steer) {
         delete m_steer;
@@ -38,203 +84,539 @@ CarSpeed::~CarSpeed()
 
 void CarSpeed::initJsonParam()
 {
-    ParamJson param("param.json");
-    std::string jsonItem;
-    std::ifstream ifs("/etc/hostname", std::ifstream::in);
-    ifs >> jsonItem;
-
-    if (jsonItem.find("pi") == std::string::npos) {
-        jsonItem = k_deviceNamePc;
-    }
-
-    auto createMotorObject = [&](std::string jsonMotor, std::string jsonIr) {
-        std::vector<uint32_t> port;
-        uint32_t inputPort;
-        bool outputRet = param.getJsonParam(jsonItem + "." + jsonMotor, port);
-        bool inputRet = param.getJsonParam(jsonItem + "." + jsonIr, inputPort);
-        if (outputRet && inputRet) {
-            port.push_back(inputPort);
-            m_motor.push_back(new Motor(port));
-        } else if (outputRet) {
-            m_motor.push_back(new Motor(port));
-            ctrllog::warn("create motor with port {},{}", port[0], port[1]);
-        } else {
-            ctrllog::warn("json parameter error: {}, {}", outputRet, inputRet);
+    std::string jsonItem = m_option.deviceName;
+    if (jsonItem.empty()) {
+        std::ifstream ifs("/etc/hostname", std::ifstream::in);
+        ifs >> jsonItem;
+
+        if (jsonItem.find("pi") == std::string::npos) {
+            jsonItem = k_deviceNamePc;
         }
-    };
+    }
 
-    auto getPwmParam = [&](std::string item) {
-        std::vector<int32_t> vectVal;
-        bool ret = param.getJsonParam(jsonItem + ".pwm." + item, vectVal);
-        if (ret)
-            m_pwmVect.push_back(vectVal);
-        else
-            ctrllog::warn("initParam: json pwm param error");
-    };
+    auto config = std::make_shared<SpeedConfig>();
+    std::vector<std::string> errors;
+    if (!loadSpeedConfig(m_option.paramFile, jsonItem, *config, errors)) {
+        for (const auto& error : errors) {
+            ctrllog::error("initParam: {}", error);
+        }
+    }
+    m_config = config;
+    m_jsonItem = jsonItem;
+    m_rtOption = config->realtime;
+    m_watchdogTime.store(config->watchdogTime);
+    m_stallDetector.setOption(config->stall);
+
+    if (!m_option.sim && !config->recorderFile.empty() && (config->recorderTime > 0)) {
+        if (m_recorder.open(config->recorderFile, config->recorderTime, k_speedTickUs)) {
+            if (!config->recorderArchive.empty()) {
+                m_recorder.openArchive(config->recorderArchive, (int64_t)config->recorderArchiveMb << 20);
+            }
+            m_recorderTimer.start(1000);
+        }
+    }
 
-    bool ret = param.getJsonParam(jsonItem + ".motor_num", m_motorNum);
-    if (!ret || !m_motorNum) {
-        ctrllog::error("initParam: error motor number {}...", m_motorNum);
+    m_motorSet = MotorSet::create(*config, m_option.sim);
+    m_motorNum = m_motorSet ? m_motorSet->size() : 0;
+    if (!m_motorNum) {
+        ctrllog::error("initParam: error motor number {}...", config->motorNum);
         return;
     }
     ctrllog::info("initParam: motor number {}, jsonItem {}", m_motorNum, jsonItem);
 
-    if (jsonItem == k_deviceNameM1) {
-        // motor defines
-        createMotorObject("motor_front_left", "ir_front_left");
-        createMotorObject("motor_front_right", "ir_front_right");
-        if (m_motorNum == 4) {
-            createMotorObject("motor_back_left", "ir_back_left");
-            createMotorObject("motor_back_right", "ir_back_right");
-        }
-    } else if (jsonItem == k_deviceNamePc) {
-        createMotorObject("motor_front", "none");
-        createMotorObject("motor_back", "none");
-        std::vector<uint32_t> port;
-        bool steerRet = param.getJsonParam(jsonItem + ".steer", port);
-        if (steerRet) {
-            m_steer = new Steer(m_context, port);
-            if (m_steer == nullptr) {
-                ctrllog::error("failed to create steer...");
-            }
-        } else {
-            ctrllog::warn("no steer parameter...");
-        }
+    if (!config->steer.empty()) {
+        m_steer = new Steer(m_context, config->steer, m_option.sim);
     }
 
-    getPwmParam("zero");
-    getPwmParam("one");
-    getPwmParam("two");
-    getPwmParam("three");
-    getPwmParam("four");
-    getPwmParam("five");
-    getPwmParam("six");
-    getPwmParam("seven");
-    getPwmParam("eight");
-    getPwmParam("nine");
+    m_pwmVect = config->pwmTable;
 
     //set default speed
     setMotorSpeedLevel(1);
+
+    if (!m_option.sim && !config->snapshotFile.empty() && (config->snapshotMs > 0)) {
+        if (m_snapshot.open(config->snapshotFile)) {
+            restoreSnapshot();
+            m_snapshotTimer.start(config->snapshotMs);
+        }
+    }
+}
+
+int32_t CarSpeed::reloadParam()
+{
+    // run in io thread. hardware stays as created at start
+    auto config = std::make_shared<SpeedConfig>();
+    std::vector<std::string> errors;
+    if (!m_config || !m_config->motorNum) {
+        ctrllog::error("reload {}: no valid config at start, restart agvctrl", m_option.paramFile);
+        return -1;
+    }
+    if (!loadSpeedConfig(m_option.paramFile, m_jsonItem, *config, errors)) {
+        for (const auto& error : errors) {
+            ctrllog::error("reload {}: {}", m_option.paramFile, error);
+        }
+        ctrllog::error("reload {}: rejected, keep running config", m_option.paramFile);
+        return -1;
+    }
+
+    auto changed = diffHardware(*m_config, *config);
+    if (!changed.empty()) {
+        for (const auto& item : changed) {
+            ctrllog::error("reload {}: {} needs restart of agvctrl", m_option.paramFile, item);
+        }
+        ctrllog::error("reload {}: rejected, keep running config", m_option.paramFile);
+        return -1;
+    }
+
+    if (!(config->realtime == m_config->realtime)
+        || (config->recorderFile != m_config->recorderFile)
+        || (config->recorderTime != m_config->recorderTime)
+        || (config->recorderArchive != m_config->recorderArchive)
+        || (config->recorderArchiveMb != m_config->recorderArchiveMb)) {
+        ctrllog::warn("reload {}: realtime and recorder change after restart", m_option.paramFile);
+    }
+
+    m_newConfig.store(std::move(config));
+    notifyPwmChange();
+    ctrllog::info("reload {}: pwm table, watchdog, stall and glitch time updated", m_option.paramFile);
+    return 0;
+}
+
+void CarSpeed::applyConfig(const SpeedConfig& config)
+{
+    // speed thread, between two ticks
+    m_watchdogTime.store(config.watchdogTime);
+    m_stallDetector.setOption(config.stall);
+    for (int32_t i = 0; i < m_motorNum; i++) {
+        getMotor(i).setGlitchUs(config.encoderGlitchUs);
+    }
+    setPwmTable(config.pwmTable);
 }
 
 int32_t CarSpeed::getActualSpeed(int32_t motor)
 {
-    return m_motor[motor]->m_actualSpeed;
+    return getMotor(motor).getActualSpeed();
 }
 
 void CarSpeed::setRunSteps(int32_t motor, int32_t steps)
 {
     setActualSteps(motor, 0);
 
-    m_motor[motor]->setCtrlSteps(steps);
+    getMotor(motor).runSteps(steps);
+    notifyPwmChange();
 }
 
 MotorState CarSpeed::getRunState(int32_t motor)
 {
-    return m_motor[motor]->getRunState();
+    return getMotor(motor).getRunState();
 }
 
 int32_t CarSpeed::getCtrlSteps(int32_t motor)
 {
-    return m_motor[motor]->getCtrlSteps();
+    return getMotor(motor).getCtrlSteps();
 }
 
 int32_t CarSpeed::getActualSteps(int32_t motor)
 {
-    return m_motor[motor]->getActualSteps();
+    return getMotor(motor).getActualSteps();
 }
 
 void CarSpeed::setActualSteps(int32_t motor, int32_t steps)
 {
-    m_motor[motor]->setActualSteps(steps);
+    getMotor(motor).setActualSteps(steps);
 }
 
-void CarSpeed::motorPwmCtrl()
+void CarSpeed::notifyPwmChange()
 {
-    static int32_t pwmCount[MOTOR_NUM_MAX]{0, 0, 0, 0};
-    static bool runFlag[MOTOR_NUM_MAX] { true, true, true, true };
+    // motor is changed before, edge table is rebuilt in speed thread
+    m_pwmChange.fetch_add(1, std::memory_order_release);
+    if (m_wakeFd >= 0) {
+        uint64_t one = 1;
+        if (write(m_wakeFd, &one, sizeof(one)) < 0) {
+            ctrllog::warn("notifyPwmChange: wake speed thread failed");
+        }
+    }
+}
+
+void CarSpeed::recordTick(int64_t now)
+{
+    // history and flight records on a fixed k_speedTickUs grid. the loop only
+    // wakes for pwm edges, encoder edges and setpoints and the state holds in
+    // between, so grid points passed asleep get the state of the last wake,
+    // taken before this tick changes it. a point at now is left to the next
+    // wake, which sees what this tick set. the ring holds recorder_time
+    // seconds whatever the wake rate
+    int64_t grid = now - now % k_speedTickUs;
+    if (!m_nextSample) {
+        m_nextSample = grid;
+    } else if (m_nextSample < grid - m_pwmScheduler.getPeriodUs()) {
+        // thread held off for longer than an idle wake, keep the burst short
+        m_nextSample = grid - m_pwmScheduler.getPeriodUs();
+    }
+    if (m_nextSample >= now) {
+        return;
+    }
 
+    HistorySample sample;
+    m_motorSet->fillSample(sample);
+    sample.value[static_cast<int32_t>(HistoryMetric::Mode) * MOTOR_NUM_MAX] = m_carCtrl->getCtrlMode();
+    FlightRecord rec {};
+    rec.ctrlMode = static_cast<uint8_t>(m_carCtrl->getCtrlMode());
+    for (; m_nextSample < now; m_nextSample += k_speedTickUs) {
+        m_history.append(m_nextSample, sample);
+        if (m_recorder.isOpen()) {
+            rec.timestamp = m_nextSample;
+            m_motorSet->fillRecord(rec, m_pwmScheduler, m_nextSample);
+            m_recorder.append(rec);
+        }
+    }
+}
+
+void CarSpeed::saveSnapshot()
+{
+    // io thread. a sync per change only, a car standing still writes nothing
+    if (!m_snapshot.isOpen()) {
+        return;
+    }
+
+    CarSnapshot snap;
+    snap.deviceName = m_jsonItem;
+    snap.speedLevel = getMotorSpeedLevel();
     for (int32_t i = 0; i < m_motorNum; i++) {
-        if (m_motor[i]->getRunState() != MotorState::Stop) {
-            pwmCount[i]++;
-            if (pwmCount[i] >= (runFlag[i] ? m_motor[i]->getRunPwm() : m_motor[i]->getStopPwm())) {
-                if (runFlag[i]) {
-                    m_motor[i]->setNowState(MotorState::Stop);
-                } else {
-                    m_motor[i]->setNowState(m_motor[i]->getRunState());
-                }
+        auto& motor = getMotor(i);
+        snap.motor.push_back({motor.getRunPwm(), motor.getCtrlSteps(), motor.getActualSteps(),
+                              motor.getEncoderCount()});
+    }
+    if (snap == m_lastSnapshot) {
+        return;
+    }
+    if (m_snapshot.save(snap)) {
+        m_lastSnapshot = std::move(snap);
+    }
+}
 
-                pwmCount[i] = 0;
-                runFlag[i] = runFlag[i] ? false : true;
-            }
+void CarSpeed::restoreSnapshot()
+{
+    auto start = std::chrono::steady_clock::now();
+    CarSnapshot snap;
+    if (!m_snapshot.load(snap)) {
+        ctrllog::info("snapshot: no saved state, start clean");
+        return;
+    }
+    if ((snap.deviceName != m_jsonItem) || (static_cast<int32_t>(snap.motor.size()) != m_motorNum)) {
+        ctrllog::warn("snapshot: saved for {} with {} motors, not restored", snap.deviceName, snap.motor.size());
+        return;
+    }
 
-            if ((std::abs(m_motor[i]->getActualSteps()) > std::abs(m_motor[i]->getCtrlSteps()))
-                && (m_carCtrl->getCtrlMode() == CTRL_MODE_STEP)) {
-                    m_motor[i]->setRunState(MotorState::Stop);
-            }
-        } else {
-            pwmCount[i] = 0;
-            m_motor[i]->setNowState(MotorState::Stop);
+    // counters and pwm come back, motors stay stopped until the next command
+    setMotorSpeedLevel(snap.speedLevel);
+    for (int32_t i = 0; i < m_motorNum; i++) {
+        auto& motor = getMotor(i);
+        motor.setRunPwm(snap.motor[i].runPwm);
+        motor.setCtrlSteps(snap.motor[i].ctrlSteps);
+        motor.setActualSteps(snap.motor[i].actualSteps);
+        motor.addEncoderCount(snap.motor[i].encoderCount - motor.getEncoderCount());
+    }
+    notifyPwmChange();
+    m_lastSnapshot = std::move(snap);
+
+    auto usedUs = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start);
+    ctrllog::info("snapshot: restored speed level {} and {} motors in {} us", m_lastSnapshot.speedLevel,
+                  m_motorNum, usedUs.count());
+}
+
+int64_t CarSpeed::getSteadyTimeUs()
+{
+    if (m_option.sim) {
+        return m_option.sim->getTime();
+    }
+    return std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void CarSpeed::feedWatchdog(int32_t extraTime)
+{
+    int32_t watchdogTime = m_watchdogTime.load();
+    if (!watchdogTime) {
+        return;
+    }
+    m_watchdogDeadline.store(getSteadyTimeUs() + (int64_t)(watchdogTime + extraTime) * 1000);
+}
+
+void CarSpeed::checkWatchdog()
+{
+    // run in speed thread, not depend on asio timer or rpc thread
+    int64_t deadline = m_watchdogDeadline.load(std::memory_order_relaxed);
+    if (!deadline || (m_carCtrl->getCtrlMode() != CTRL_MODE_TIME)) {
+        return;
+    }
+
+    int64_t now = getSteadyTimeUs();
+    if (now < deadline) {
+        return;
+    }
+    m_watchdogDeadline.store(0);
+
+    if (!m_motorSet->stopAll()) {
+        return;
+    }
+    notifyPwmChange();
+
+    int32_t latency = static_cast<int32_t>(now - deadline);
+    if (latency > m_watchdogLatency.load()) {
+        m_watchdogLatency.store(latency);
+    }
+    m_watchdogTrips++;
+    g_watchdogTrips.inc();
+    ctrllog::warn("watchdog: no setpoint in {} ms, stop all motors. latency {} us",
+                  m_watchdogTime.load(), latency);
+}
+
+void CarSpeed::checkStall(int64_t now)
+{
+    auto action = m_motorSet->checkStall(m_stallDetector, now);
+    if (action == StallDetector::Action::Rebuild) {
+        notifyPwmChange();
+    } else if (action == StallDetector::Action::Stop) {
+        m_motorSet->stopAll();
+        notifyPwmChange();
+        ctrllog::warn("stall: stop all motors");
+    }
+}
+
+int32_t CarSpeed::getWatchdogTrips()
+{
+    return m_watchdogTrips.load();
+}
+
+int32_t CarSpeed::getWatchdogLatency()
+{
+    return m_watchdogLatency.load();
+}
+
+void CarSpeed::initRealtime()
+{
+    // run in speed thread, settings apply to itself. fifo is set by creator after start
+    if (m_rtOption.lockMemory) {
+        cmn::CmnThread::lockMemory();
+        cmn::CmnThread::prefaultStack(64 * 1024);
+    }
+
+    if (m_rtOption.cpu >= 0) {
+        cmn::CmnThread::setSelfAffinity(m_rtOption.cpu);
+    }
+
+    if (m_rtOption.policy == "deadline") {
+        // budget of a quarter period, must finish before the next tick.
+        // kernel refuses deadline with a reduced cpu mask, use cpu -1 with it
+        cmn::CmnThread::setSelfDeadline(k_speedTickUs / 4, k_speedTickUs, k_speedTickUs);
+    } else if ((m_rtOption.policy != "other") && (m_rtOption.policy != "fifo")) {
+        ctrllog::warn("realtime: unknown policy {}", m_rtOption.policy);
+    }
+
+    ctrllog::info("realtime: policy {} priority {} cpu {} lock memory {}", m_rtOption.policy,
+                  m_rtOption.priority, m_rtOption.cpu, m_rtOption.lockMemory);
+}
+
+void CarSpeed::recordJitter(int64_t wakeLatency, int64_t periodError)
+{
+    // always on: a few relaxed atomics per tick
+    auto bucket = [](int64_t value) {
+        uint64_t abs = static_cast<uint64_t>(value < 0 ? -value : value);
+        return std::min<int32_t>(std::bit_width(abs), k_jitterBuckets - 1);
+    };
+    auto updateMax = [](std::atomic<int32_t>& max, int64_t value) {
+        int32_t val = static_cast<int32_t>(std::min<int64_t>(value < 0 ? -value : value, INT32_MAX));
+        if (val > max.load(std::memory_order_relaxed)) {
+            max.store(val, std::memory_order_relaxed);
+        }
+    };
+
+    m_wakeHist[bucket(wakeLatency)].fetch_add(1, std::memory_order_relaxed);
+    m_periodHist[bucket(periodError)].fetch_add(1, std::memory_order_relaxed);
+    updateMax(m_maxWakeLatency, wakeLatency);
+    updateMax(m_maxPeriodError, periodError);
+    m_loopTicks.fetch_add(1, std::memory_order_relaxed);
+}
+
+LoopJitter CarSpeed::getLoopJitter()
+{
+    LoopJitter jitter;
+    jitter.policy = m_rtOption.policy;
+    jitter.periodUs = k_speedTickUs;
+    jitter.ticks = m_loopTicks.load(std::memory_order_relaxed);
+    jitter.maxWakeLatency = m_maxWakeLatency.load(std::memory_order_relaxed);
+    jitter.maxPeriodError = m_maxPeriodError.load(std::memory_order_relaxed);
+    for (int32_t i = 0; i < k_jitterBuckets; i++) {
+        jitter.wakeHist.push_back(m_wakeHist[i].load(std::memory_order_relaxed));
+        jitter.periodHist.push_back(m_periodHist[i].load(std::memory_order_relaxed));
+    }
+    return jitter;
+}
+
+TelemetrySeries CarSpeed::getTelemetryHistory(const std::string& metric, int64_t from, int64_t to,
+                                              int32_t resolution)
+{
+    TelemetrySeries series {};
+    series.metric = metric;
+    auto name = std::find(std::begin(k_historyMetricNames), std::end(k_historyMetricNames), metric);
+    if (name == std::end(k_historyMetricNames)) {
+        ctrllog::warn("getTelemetryHistory: no metric {}", metric);
+        return series;
+    }
+    int32_t first = static_cast<int32_t>(name - std::begin(k_historyMetricNames)) * MOTOR_NUM_MAX;
+    int32_t seriesNum = (*name == std::string_view{"mode"}) ? 1 : m_motorNum;
+
+    // rows are in steady time, the answer in wall clock
+    int64_t steadyNow = getSteadyTimeUs();
+    int64_t realNow = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    int64_t fromUs = (from <= 0) ? steadyNow + from * 1000 : steadyNow + from * 1000 - realNow;
+    int64_t toUs = (to <= 0) ? steadyNow + to * 1000 : steadyNow + to * 1000 - realNow;
+
+    std::vector<HistoryRow> rows;
+    int64_t widthUs = m_history.query(fromUs, toUs, (int64_t)resolution * 1000, steadyNow, rows);
+    series.resolution = static_cast<int32_t>(widthUs / 1000);
+    series.min.resize(seriesNum);
+    series.max.resize(seriesNum);
+    series.mean.resize(seriesNum);
+    for (const auto& row : rows) {
+        series.time.push_back((row.timeUs - steadyNow + realNow) / 1000);
+        for (int32_t i = 0; i < seriesNum; i++) {
+            const auto& stat = row.stat[first + i];
+            series.min[i].push_back(stat.min);
+            series.max[i].push_back(stat.max);
+            series.mean[i].push_back(stat.mean);
         }
     }
+    return series;
+}
+
+FlightRecordChunk CarSpeed::getFlightRecords(uint64_t fromSeq)
+{
+    FlightRecordChunk chunk {};
+    std::vector<FlightRecord> records;
+    if (!m_recorder.isOpen()) {
+        return chunk;
+    }
+
+    chunk.lastSeq = fromSeq;
+    m_recorder.putFileHeader(chunk.header);
+    if (m_recorder.read(fromSeq, k_flightChunkRecords, records)) {
+        TelemetryCodec::encode(records, chunk.blocks);
+        chunk.lastSeq = records.back().seq;
+    }
+    return chunk;
 }
 
 void CarSpeed::threadFun(void *ctxt)
 {
     CarSpeed *obj = static_cast<CarSpeed *>(ctxt);
-    struct pollfd fds[MOTOR_NUM_MAX]{};
-    char buffer[16];
-    bool inputFlag {false};
-
-    for (int32_t ii = 0; ii < obj->m_motorNum; ii++) {
-        if (obj->m_motor[ii]->getInputGpioFd()) {
-            fds[ii].fd = obj->m_motor[ii]->getInputGpioFd();
-            fds[ii].events = POLLPRI;
-            inputFlag = true;
-        }
+    struct pollfd fds[MOTOR_NUM_MAX + 1]{};
+    int32_t motorNum = obj->m_motorNum;
+
+    obj->initRealtime();
+
+    for (int32_t ii = 0; ii < motorNum; ii++) {
+        auto& motor = obj->getMotor(ii);
+        fds[ii].fd = motor.getInputGpioFd() ? motor.getInputGpioFd() : -1;
+        fds[ii].events = motor.hasEdgeEvents() ? POLLIN : POLLPRI;
     }
+    fds[motorNum].fd = obj->m_wakeFd;
+    fds[motorNum].events = POLLIN;
 
+    // sleep until next pwm edge or watchdog deadline, encoder edges and
+    // setpoint changes wake the loop earlier
+    int64_t wakeTime = obj->controlTick();
+    int64_t lastLatency = 0;
     while(1) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(1));
-        obj->motorPwmCtrl();
-
-        if ((!inputFlag) //without input counter
-           || (poll(fds, obj->m_motorNum, 0) <= 0)) { // input no changes
-            continue;
+        int64_t timeout = std::max<int64_t>(wakeTime - obj->getSteadyTimeUs(), 0);
+        struct timespec ts {timeout / 1000000, (timeout % 1000000) * 1000};
+        int ret = ppoll(fds, motorNum + 1, &ts, nullptr);
+        if (ret == 0) {
+            int64_t latency = obj->getSteadyTimeUs() - wakeTime;
+            obj->recordJitter(latency, latency - lastLatency);
+            g_wakeSeconds.observe(std::max<int64_t>(latency, 0));
+            lastLatency = latency;
         }
 
-        for (int32_t i = 0; i < obj->m_motorNum; i++) {
-            if (fds[i].revents & POLLPRI) {
-                if (lseek(fds[i].fd, 0, SEEK_SET) < 0) {
-                    ctrllog::warn("threadFun: seek failed");
-                    continue;
-                }
-                int len = read(fds[i].fd, buffer, sizeof(buffer));
-                if (len < 0) {
-                    ctrllog::warn("threadFun: read failed");
-                    continue;
-                }
-                obj->m_motor[i]->m_swCounter++;
-
-                if ((obj->m_motor[i]->getCtrlSteps() >= 0)
-                    || (obj->m_carCtrl->getCtrlMode() == CTRL_MODE_TIME)) {
-                    obj->m_motor[i]->moveActualSteps(1);
-                } else {
-                    obj->m_motor[i]->moveActualSteps(-1);
+        for (int32_t i = 0; (ret > 0) && (i < motorNum); i++) {
+            if (fds[i].revents & fds[i].events) {
+                int32_t edges = obj->getMotor(i).readInputEdges();
+                if (edges > 0) {
+                    obj->countEncoder(i, edges);
                 }
             }
         }
+        if ((ret > 0) && (fds[motorNum].revents & POLLIN)) {
+            uint64_t count;
+            if (read(fds[motorNum].fd, &count, sizeof(count)) < 0) {
+                ctrllog::warn("threadFun: read wake event failed");
+            }
+        }
+
+        wakeTime = obj->controlTick();
+    }
+}
+
+int64_t CarSpeed::controlTick()
+{
+    metrics::ScopedTimer timer(g_tickSeconds);
+    int64_t now = getSteadyTimeUs();
+    recordTick(now);
+
+    if (auto config = m_newConfig.exchange(nullptr)) {
+        applyConfig(*config);
+    }
+    checkWatchdog();
+    checkStall(now);
+
+    uint32_t change = m_pwmChange.load(std::memory_order_acquire);
+    if (change != m_pwmBuilt) {
+        m_pwmBuilt = change;
+        m_motorSet->buildPwm(m_pwmScheduler, now);
+    }
+    int64_t wakeTime = m_pwmScheduler.run(now);
+
+    // without edges, still wake once a pwm period
+    if (!wakeTime) {
+        wakeTime = now + m_pwmScheduler.getPeriodUs();
+    }
+    int64_t deadline = m_watchdogDeadline.load(std::memory_order_relaxed);
+    if ((m_carCtrl->getCtrlMode() == CTRL_MODE_TIME) && (deadline > now) && (deadline < wakeTime)) {
+        wakeTime = deadline;
+    }
+    return wakeTime;
+}
+
+void CarSpeed::countEncoder(int32_t motor, int32_t edges)
+{
+    getMotor(motor).addEncoderCount(edges);
+    g_encoderEdges.inc(edges);
+
+    if ((getMotor(motor).getCtrlSteps() >= 0)
+        || (m_carCtrl->getCtrlMode() == CTRL_MODE_TIME)) {
+        getMotor(motor).moveActualSteps(edges);
+    } else {
+        getMotor(motor).moveActualSteps(-edges);
+    }
+
+    if ((m_carCtrl->getCtrlMode() == CTRL_MODE_STEP)
+        && (getMotor(motor).getRunState() != MotorState::Stop)
+        && (std::abs(getMotor(motor).getActualSteps()) > std::abs(getMotor(motor).getCtrlSteps()))) {
+        getMotor(motor).setRunState(MotorState::Stop);
+        notifyPwmChange();
     }
 }
 
 void CarSpeed::setMotorState(int32_t motor, MotorState state)
 {
-    m_motor[motor]->setRunState(state);
+    getMotor(motor).setRunState(state);
+    notifyPwmChange();
 }
 
 MotorState CarSpeed::getMotorState(int32_t motor)
 {
-    return m_motor[motor]->getRunState();
+    return getMotor(motor).getRunState();
 }
 
 int32_t CarSpeed::getMotorNum()
@@ -244,20 +626,64 @@ int32_t CarSpeed::getMotorNum()
 
 void CarSpeed::setMotorPwm(int32_t motor, int32_t pwm)
 {
-    m_motor[motor]->setRunPwm(pwm);
+    getMotor(motor).setRunPwm(pwm);
+    notifyPwmChange();
 }
 
 int32_t CarSpeed::getMotorPwm(int32_t motor)
 {
-    return m_motor[motor]->getRunPwm();
+    return getMotor(motor).getRunPwm();
+}
+
+void CarSpeed::setPwmTable(const std::vector<std::vector<int32_t>>& table)
+{
+    {
+        std::lock_guard lock(m_pwmMutex);
+        m_pwmVect = table;
+    }
+    setMotorSpeedLevel(m_speedLevel);
+}
+
+int32_t CarSpeed::getEncoderCount(int32_t motor)
+{
+    return getMotor(motor).getEncoderCount();
+}
+
+std::vector<EncoderState> CarSpeed::getEncoderState()
+{
+    std::vector<EncoderState> state;
+    for (int32_t i = 0; i < m_motorNum; i++) {
+        EncoderState item {};
+        item.edges = static_cast<uint64_t>(getMotor(i).getEncoderCount());
+        item.rate = m_stallDetector.getRate(i);
+        item.fault = m_stallDetector.getFault(i);
+        item.stalls = m_stallDetector.getStalls(i);
+        item.slips = m_stallDetector.getSlips(i);
+        if (auto edge = getMotor(i).getInputEdge()) {
+            item.input = "event";
+            item.dropped = edge->getDropped();
+            item.glitches = edge->getGlitches();
+            item.periodUs = static_cast<int32_t>(edge->getEdgePeriodNs() / 1000);
+        } else {
+            item.input = getMotor(i).getInputGpioFd() ? "sysfs" : "none";
+        }
+        state.push_back(std::move(item));
+    }
+    return state;
 }
 
 void CarSpeed::setMotorSpeedLevel(int32_t level)
 {
+    std::lock_guard lock(m_pwmMutex);
+    if ((level < 0) || (level >= static_cast<int32_t>(m_pwmVect.size()))) {
+        ctrllog::warn("no pwm of speed level {}", level);
+        return;
+    }
     m_speedLevel = level;
     for (int32_t ii = 0; ii < getMotorNum(); ii++) {
-        m_motor[ii]->setRunPwm(m_pwmVect[level][ii]);
+        getMotor(ii).setRunPwm(m_pwmVect[level][ii]);
     }
+    notifyPwmChange();
 }
 
 int32_t CarSpeed::getMotorSpeedLevel()
@@ -0,0 +1,214 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <xapi/easylog.hpp>
+#include "flight_recorder.hpp"
+#include "telemetry_codec.hpp"
+
+namespace {
+
+// keep file of last run or last full archive as name.old
+void keepOldFile(const std::string& fileName)
+{
+    if (access(fileName.c_str(), F_OK) == 0) {
+        std::string oldName = fileName + ".old";
+        if (rename(fileName.c_str(), oldName.c_str()) < 0) {
+            ctrllog::warn("flight recorder: fail to keep {}", oldName);
+        }
+    }
+}
+
+}  // namespace
+
+FlightRecorder::~FlightRecorder()
+{
+    close();
+}
+
+bool FlightRecorder::open(const std::string& fileName, int32_t seconds, int32_t tickUs)
+{
+    if ((seconds <= 0) || (tickUs <= 0)) {
+        return false;
+    }
+
+    // keep record of last run, it may be the one to check after crash
+    keepOldFile(fileName);
+
+    m_capacity = static_cast<uint32_t>((int64_t)seconds * 1000000 / tickUs);
+    m_mapSize = sizeof(FlightRecHeader) + (size_t)m_capacity * sizeof(FlightRecord);
+
+    m_fd = ::open(fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (m_fd < 0) {
+        ctrllog::warn("flight recorder: fail to open {}", fileName);
+        return false;
+    }
+
+    // reserve blocks now, so page fault in control thread never meets full disk
+    if (posix_fallocate(m_fd, 0, m_mapSize) != 0) {
+        ctrllog::warn("flight recorder: fail to allocate {} bytes", m_mapSize);
+        close();
+        return false;
+    }
+
+    void* addr = mmap(nullptr, m_mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, m_fd, 0);
+    if (addr == MAP_FAILED) {
+        ctrllog::warn("flight recorder: fail to map {}", fileName);
+        close();
+        return false;
+    }
+
+    m_header = static_cast<FlightRecHeader*>(addr);
+    m_header->magic = k_flightRecMagic;
+    m_header->version = k_flightRecVersion;
+    m_header->recordSize = sizeof(FlightRecord);
+    m_header->capacity = m_capacity;
+    m_header->tickUs = tickUs;
+    m_header->realtimeUs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count();
+    m_header->steadyUs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    m_header->writeSeq.store(0);
+    m_record = reinterpret_cast<FlightRecord*>(m_header + 1);
+    m_seq = 0;
+
+    // prefault pages out of control thread
+    madvise(addr, m_mapSize, MADV_WILLNEED);
+    sync();
+
+    ctrllog::info("flight recorder: {} with {} records", fileName, m_capacity);
+    return true;
+}
+
+void FlightRecorder::close()
+{
+    if (m_header != nullptr) {
+        archive();
+        closeArchive();
+        sync();
+        munmap(m_header, m_mapSize);
+        m_header = nullptr;
+        m_record = nullptr;
+    }
+
+    if (m_fd >= 0) {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+void FlightRecorder::sync()
+{
+    if (m_header != nullptr) {
+        msync(m_header, m_mapSize, MS_SYNC);
+    }
+}
+
+bool FlightRecorder::openArchive(const std::string& fileName, int64_t maxBytes)
+{
+    if ((m_header == nullptr) || (maxBytes <= 0)) {
+        return false;
+    }
+
+    m_archiveName = fileName;
+    m_archiveMax = maxBytes;
+    m_archiveSeq = m_header->writeSeq.load(std::memory_order_acquire);
+    keepOldFile(fileName);
+    return openArchiveFile();
+}
+
+bool FlightRecorder::openArchiveFile()
+{
+    m_archiveFd = ::open(m_archiveName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0644);
+    if (m_archiveFd < 0) {
+        ctrllog::warn("flight recorder: fail to open archive {}", m_archiveName);
+        return false;
+    }
+
+    m_archiveBuffer.clear();
+    putFileHeader(m_archiveBuffer);
+    if (write(m_archiveFd, m_archiveBuffer.data(), m_archiveBuffer.size())
+        != static_cast<ssize_t>(m_archiveBuffer.size())) {
+        ctrllog::warn("flight recorder: fail to write archive {}", m_archiveName);
+        closeArchive();
+        return false;
+    }
+    m_archiveBytes = static_cast<int64_t>(m_archiveBuffer.size());
+    ctrllog::info("flight recorder: archive {} up to {} bytes", m_archiveName, m_archiveMax);
+    return true;
+}
+
+void FlightRecorder::closeArchive()
+{
+    if (m_archiveFd >= 0) {
+        fdatasync(m_archiveFd);
+        ::close(m_archiveFd);
+        m_archiveFd = -1;
+    }
+}
+
+void FlightRecorder::archive()
+{
+    if ((m_archiveFd < 0) || (m_header == nullptr)) {
+        return;
+    }
+
+    // records since last call, one timer period of them
+    m_archiveRecords.clear();
+    if (!read(m_archiveSeq, m_capacity, m_archiveRecords)) {
+        return;
+    }
+    m_archiveSeq = m_archiveRecords.back().seq;
+    m_archiveBuffer.clear();
+    TelemetryCodec::encode(m_archiveRecords, m_archiveBuffer);
+
+    if (m_archiveBytes + static_cast<int64_t>(m_archiveBuffer.size()) > m_archiveMax) {
+        closeArchive();
+        keepOldFile(m_archiveName);
+        std::string blocks = std::move(m_archiveBuffer);
+        if (!openArchiveFile()) {
+            return;
+        }
+        m_archiveBuffer = std::move(blocks);
+    }
+
+    if (write(m_archiveFd, m_archiveBuffer.data(), m_archiveBuffer.size())
+        != static_cast<ssize_t>(m_archiveBuffer.size())) {
+        ctrllog::warn("flight recorder: fail to write archive {}, stop archive", m_archiveName);
+        closeArchive();
+        return;
+    }
+    m_archiveBytes += static_cast<int64_t>(m_archiveBuffer.size());
+}
+
+size_t FlightRecorder::read(uint64_t fromSeq, size_t maxCount, std::vector<FlightRecord>& records)
+{
+    if (m_header == nullptr) {
+        return 0;
+    }
+
+    // slots older than the ring are gone, a slot written meanwhile fails seq or checksum
+    uint64_t last = m_header->writeSeq.load(std::memory_order_acquire);
+    uint64_t first = std::max<uint64_t>(fromSeq + 1, (last > m_capacity) ? last - m_capacity + 1 : 1);
+    size_t count = 0;
+    for (uint64_t seq = first; (seq <= last) && (count < maxCount); seq++) {
+        FlightRecord rec = m_record[(seq - 1) % m_capacity];
+        if ((rec.seq != seq) || (rec.checksum != flightRecChecksum(rec))) {
+            continue;
+        }
+        records.push_back(rec);
+        count++;
+    }
+    return count;
+}
+
+void FlightRecorder::putFileHeader(std::string& out)
+{
+    if (m_header != nullptr) {
+        TelemetryCodec::putFileHeader(out, m_header->tickUs, m_header->realtimeUs, m_header->steadyUs);
+    }
+}
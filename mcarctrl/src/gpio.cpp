@@ -7,18 +7,27 @@
 #include <xapi/easylog.hpp>
 #include "gpio.hpp"
 
-Gpio::Gpio(int32_t pin, int32_t direction, int32_t edge) :
+Gpio::Gpio(int32_t pin, int32_t direction, int32_t edge, SimBackend* sim) :
     m_pin(pin),
     m_direction(direction),
     m_edge(edge),
-    m_gpioFd(0)
+    m_gpioFd(0),
+    m_sim(sim)
 {
-    char path[32] {0};
+    char path[256] {0};
+
+    if (m_sim) {
+        // simulated pin, no sysfs
+        if (m_direction == GPIO_DIR_OUT) {
+            setValue(0);
+        }
+        return;
+    }
 
     exportPin();
     setDirection(m_direction);
 
-    snprintf(path, sizeof(path), "/sys/class/gpio/gpio%d/value", m_pin);
+    snprintf(path, sizeof(path), "%s/gpio%d/value", s_sysfsRoot.c_str(), m_pin);
     m_gpioFd = open(path, O_RDWR);
     if (m_gpioFd < 0)
         ctrllog::error("fail to open gpio {}", m_pin);
@@ -35,6 +44,9 @@ Gpio::Gpio(int32_t pin, int32_t direction, int32_t edge) :
 Gpio::~Gpio()
 {
     setValue(0);
+    if (m_sim) {
+        return;
+    }
     unexportPin();
 
     if (m_gpioFd > 0)
@@ -44,6 +56,10 @@ Gpio::~Gpio()
 int32_t Gpio::setValue(int32_t value)
 {
     char str[] = "01";
+    if (m_sim && (m_direction == GPIO_DIR_OUT)) {
+        m_sim->writePin(m_pin, value==0?0:1);
+        return 0;
+    }
     if ((m_gpioFd <= 0) || (m_direction == GPIO_DIR_IN))
         return -1;
 
@@ -74,17 +90,17 @@ int32_t Gpio::getValue(int32_t *pValue)
 
 int32_t Gpio::exportPin()
 {
-    char buffer[32] {0};
+    char buffer[256] {0};
     int32_t fd, len;
     int32_t ret = 0;
 
-    snprintf(buffer, sizeof(buffer), "/sys/class/gpio/gpio%d", m_pin);
+    snprintf(buffer, sizeof(buffer), "%s/gpio%d", s_sysfsRoot.c_str(), m_pin);
     if (access(buffer, F_OK) == 0) {
         //directory exist, no need export
         return 0;
     }
 
-    fd = open("/sys/class/gpio/export", O_WRONLY);
+    fd = open((s_sysfsRoot + "/export").c_str(), O_WRONLY);
     if (fd < 0) {
         ctrllog::warn("fail to open export for writing gpio {}", m_pin);
         return -1;
@@ -106,7 +122,7 @@ int32_t Gpio::unexportPin()
     char buffer[32] {0};
     int32_t fd, len;
 
-    fd = open("/sys/class/gpio/unexport", O_WRONLY);
+    fd = open((s_sysfsRoot + "/unexport").c_str(), O_WRONLY);
     if (fd < 0) {
         ctrllog::warn("fail to open unexport for writing for gpio {}", m_pin);
         return -1;
@@ -124,10 +140,10 @@ int32_t Gpio::unexportPin()
 
 int32_t Gpio::setDirection(int32_t direct)
 {
-    char path[64] {0};
+    char path[256] {0};
     int32_t fd, ret = 0;
 
-    snprintf(path, sizeof(path), "/sys/class/gpio/gpio%d/direction", m_pin);
+    snprintf(path, sizeof(path), "%s/gpio%d/direction", s_sysfsRoot.c_str(), m_pin);
     fd = open(path, O_WRONLY);
     if (fd < 0) {
         ctrllog::warn("fail to open gpio {} direction for writing", m_pin);
@@ -152,9 +168,9 @@ int32_t Gpio::setDirection(int32_t direct)
 int32_t Gpio::setEdge()
 {
     char edgeStr[][8] = {"none", "rising", "falling", "both"};
-    char path[64] {0};
+    char path[256] {0};
  
-    snprintf(path, sizeof(path), "/sys/class/gpio/gpio%d/edge", m_pin); 
+    snprintf(path, sizeof(path), "%s/gpio%d/edge", s_sysfsRoot.c_str(), m_pin); 
     int32_t fd = open(path, O_WRONLY);
     if (fd < 0) {
         ctrllog::warn("fail to open edge for write gpio {}", m_pin);
@@ -0,0 +1,155 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/gpio.h>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <xapi/easylog.hpp>
+#include "gpio.hpp"
+#include "gpio_edge.hpp"
+
+GpioEdge::GpioEdge(int32_t pin, int32_t edge, int32_t glitchUs) :
+    m_pin(pin),
+    m_glitchNs((int64_t)glitchUs * 1000)
+{
+    std::string chipDev;
+    uint32_t offset = 0;
+
+    if (findLine(chipDev, offset) < 0) {
+        return;
+    }
+
+    int32_t chipFd = open(chipDev.c_str(), O_RDONLY | O_CLOEXEC);
+    if (chipFd < 0) {
+        ctrllog::warn("fail to open {} for gpio {}", chipDev, m_pin);
+        return;
+    }
+
+    struct gpio_v2_line_request req {};
+    req.offsets[0] = offset;
+    req.num_lines = 1;
+    strncpy(req.consumer, "agvctrl", sizeof(req.consumer) - 1);
+    req.config.flags = GPIO_V2_LINE_FLAG_INPUT;
+    if (edge & GPIO_EDGE_RISING)
+        req.config.flags |= GPIO_V2_LINE_FLAG_EDGE_RISING;
+    if (edge & GPIO_EDGE_FALLING)
+        req.config.flags |= GPIO_V2_LINE_FLAG_EDGE_FALLING;
+    req.event_buffer_size = k_eventBufferSize;
+
+    if (ioctl(chipFd, GPIO_V2_GET_LINE_IOCTL, &req) < 0) {
+        ctrllog::warn("fail to request edge events of gpio {}: {}", m_pin, strerror(errno));
+        close(chipFd);
+        return;
+    }
+    close(chipFd);
+
+    // poll tells when to read, a read never blocks the speed loop
+    fcntl(req.fd, F_SETFL, fcntl(req.fd, F_GETFL) | O_NONBLOCK);
+    m_fd = req.fd;
+    ctrllog::info("gpio {}: edge events from {} line {}", m_pin, chipDev, offset);
+}
+
+GpioEdge::~GpioEdge()
+{
+    if (m_fd >= 0)
+        close(m_fd);
+}
+
+int32_t GpioEdge::readEdges()
+{
+    struct gpio_v2_line_event event[k_readBatch];
+
+    ssize_t len = read(m_fd, event, sizeof(event));
+    if (len < 0) {
+        return (errno == EAGAIN) ? 0 : -1;
+    }
+
+    int32_t count = 0;
+    int64_t lastEdge = m_lastEdgeNs.load(std::memory_order_relaxed);
+    for (size_t i = 0; i < len / sizeof(event[0]); i++) {
+        // the kernel numbers edges before its queue, a gap is an overflow
+        uint32_t gap = event[i].line_seqno - m_lastSeqno - 1;
+        if (m_lastSeqno && gap) {
+            if (!m_dropped.load(std::memory_order_relaxed)) {
+                ctrllog::warn("gpio {}: {} edges dropped by kernel queue", m_pin, gap);
+            }
+            m_dropped.fetch_add(gap, std::memory_order_relaxed);
+            count += gap;
+        }
+        m_lastSeqno = event[i].line_seqno;
+
+        int64_t time = static_cast<int64_t>(event[i].timestamp_ns);
+        if (lastEdge && (time - lastEdge < m_glitchNs)) {
+            m_glitches.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+        if (lastEdge) {
+            m_edgePeriodNs.store(time - lastEdge, std::memory_order_relaxed);
+        }
+        lastEdge = time;
+        count++;
+    }
+
+    m_lastEdgeNs.store(lastEdge, std::memory_order_relaxed);
+    m_edges.fetch_add(count, std::memory_order_relaxed);
+    return count;
+}
+
+int32_t GpioEdge::findLine(std::string& chipDev, uint32_t& offset)
+{
+    namespace fs = std::filesystem;
+    std::error_code ec;
+    std::string label;
+    uint32_t lines = 0;
+
+    auto readAttr = [](const fs::path& path) {
+        std::string value;
+        std::ifstream ifs(path);
+        std::getline(ifs, value);
+        return value;
+    };
+
+    // global pin -> chip label and offset, by base and ngpio in gpio sysfs
+    for (const auto& entry : fs::directory_iterator(Gpio::getSysfsRoot(), ec)) {
+        if (entry.path().filename().string().rfind("gpiochip", 0) != 0) {
+            continue;
+        }
+        int32_t base = atoi(readAttr(entry.path() / "base").c_str());
+        int32_t ngpio = atoi(readAttr(entry.path() / "ngpio").c_str());
+        if ((m_pin >= base) && (m_pin < base + ngpio)) {
+            label = readAttr(entry.path() / "label");
+            lines = ngpio;
+            offset = m_pin - base;
+            break;
+        }
+    }
+    if (label.empty()) {
+        ctrllog::warn("no gpio chip of gpio {}", m_pin);
+        return -1;
+    }
+
+    // chip label -> /dev/gpiochipN
+    for (const auto& entry : fs::directory_iterator(s_devRoot, ec)) {
+        if (entry.path().filename().string().rfind("gpiochip", 0) != 0) {
+            continue;
+        }
+        int32_t fd = open(entry.path().c_str(), O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            continue;
+        }
+        struct gpiochip_info info {};
+        int32_t ret = ioctl(fd, GPIO_GET_CHIPINFO_IOCTL, &info);
+        close(fd);
+        if ((ret == 0) && (label == info.label) && (lines == info.lines)) {
+            chipDev = entry.path().string();
+            return 0;
+        }
+    }
+
+    ctrllog::warn("no gpio chip device of {} for gpio {}", label, m_pin);
+    return -1;
+}
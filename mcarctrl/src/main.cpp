@@ -31,11 +31,7 @@ int32_t main(int argc, char **argv)
     CarCtrl carCtrl{asioContext};
     cmn::setSingletonInstance(&carCtrl);
 
-    coro_server.register_handler<getActualSpeed, setCtrlSteps, getCtrlSteps,
-                                 getActualSteps, setRunTime, setMotorSpeedLevel,
-                                 getMotorSpeedLevel, setAllMotorState, getMotorNum,
-                                 getMotorPwm, setCarSteps, setCarMoving,
-                                 setSteerTurn, quitApp>();
+    rpc_register_handlers(coro_server, RpcHandlers{});
 
     auto timerCallback = [](const asio::error_code &e, void *ctxt)
     {
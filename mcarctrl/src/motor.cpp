@@ -1,37 +1,51 @@
 // SPDX-License-Identifier: GPL-2.0
+#include <algorithm>
 #include <iostream>
+#include <unistd.h>
 #include <xapi/easylog.hpp>
 #include "motor.hpp"
 
-Motor::Motor(std::vector<uint32_t> port)
+Motor::Motor(std::vector<uint32_t> port, SimBackend* sim, MotorPwmOption pwm, int32_t glitchUs,
+             MotorBank* bank, int32_t index) :
+    m_ownBank(bank ? nullptr : std::make_unique<MotorBank>()),
+    m_bank(bank ? bank : m_ownBank.get()),
+    m_index(bank ? index : 0),
+    m_outputGpio{Gpio(port.at(0), GPIO_DIR_OUT, GPIO_EDGE_NONE, sim),
+                 Gpio(port.at(1), GPIO_DIR_OUT, GPIO_EDGE_NONE, sim)}
 {
-    m_outputGpio[0] = new Gpio(port.at(0), GPIO_DIR_OUT, GPIO_EDGE_NONE);
-    m_outputGpio[1] = new Gpio(port.at(1), GPIO_DIR_OUT, GPIO_EDGE_NONE);
-    if (port.size() > 2) {
-        m_inputGpio = new Gpio(port.at(2), GPIO_DIR_IN, GPIO_EDGE_RISING);
-    }
+    setRunState(MotorState::Stop);
+    m_bank->nowState[m_index] = MotorState::Stop;
+    m_bank->portState[m_index] = 0;
+    setRunPwm(50);
 
-    if ((m_outputGpio[0] == nullptr) || (m_outputGpio[1] == nullptr)) {
-        ctrllog::warn("fail to create motor from output gpio {},{}", port.at(0), port.at(1));
+    if ((port.size() > 2) && !sim) {
+        m_inputEdge.emplace(port.at(2), GPIO_EDGE_RISING, glitchUs);
+        if (!m_inputEdge->isValid()) {
+            ctrllog::warn("no edge events for gpio {}, use sysfs", port.at(2));
+            m_inputEdge.reset();
+        }
+    }
+    if ((port.size() > 2) && !m_inputEdge) {
+        m_inputGpio.emplace(port.at(2), GPIO_DIR_IN, GPIO_EDGE_RISING, sim);
     }
 
-    setNowState(MotorState::Stop);
+    if (pwm.chip >= 0) {
+        m_pwmChannel.emplace(pwm.chip, pwm.channel, pwm.periodNs, sim);
+        if (!m_pwmChannel->isValid()) {
+            ctrllog::warn("no pwmchip{} pwm{}, use software pwm", pwm.chip, pwm.channel);
+            m_pwmChannel.reset();
+        }
+    }
 }
 
 Motor::~Motor()
 {
     setNowState(MotorState::Stop);
-
-    delete m_outputGpio[0];
-    delete m_outputGpio[1];
-    if (m_inputGpio) {
-        delete m_inputGpio;
-    }
 }
 
-void Motor::setCtrlSteps(int32_t steps)
+void Motor::runSteps(int32_t steps)
 {
-    m_ctrlSteps = steps;
+    setCtrlSteps(steps);
 
     MotorState state;
     if (steps > 0)
@@ -44,21 +58,17 @@ void Motor::setCtrlSteps(int32_t steps)
     setRunState(state);
 }
 
-void Motor::setRunState(MotorState state)
-{
-    m_runState = state;
-}
-
 void Motor::setNowState(MotorState state)
 {
+    uint8_t& portState = m_bank->portState[m_index];
     auto setPortState = [&](int32_t port, int32_t stat) {
-        if (m_portState[port] != stat) {
-            m_portState[port] = stat;
-            m_outputGpio[port]->setValue(stat);
+        if (((portState >> port) & 1) != stat) {
+            portState ^= (1 << port);
+            m_outputGpio[port].setValue(stat);
         }
     };
 
-    if (m_nowState == state)
+    if (m_bank->nowState[m_index] == state)
         return;
 
     if (state == MotorState::Forward) {
@@ -72,14 +82,69 @@ void Motor::setNowState(MotorState state)
         setPortState(1, 0);
     }
 
-    m_nowState = state;
+    m_bank->nowState[m_index] = state;
 }
 
 int32_t Motor::getInputGpioFd()
 {
-    if (m_inputGpio) {
+    if (m_inputEdge) {
+        return m_inputEdge->getFd();
+    } else if (m_inputGpio) {
         return m_inputGpio->getGpioFd();
     } else {
         return 0;
     }
 }
+
+int32_t Motor::readInputEdges()
+{
+    char buffer[16];
+
+    if (m_inputEdge) {
+        return m_inputEdge->readEdges();
+    }
+    if (!m_inputGpio) {
+        return 0;
+    }
+
+    // sysfs value only tells that edges happened since last read, count one
+    int32_t fd = m_inputGpio->getGpioFd();
+    if (lseek(fd, 0, SEEK_SET) < 0) {
+        ctrllog::warn("readInputEdges: seek failed");
+        return -1;
+    }
+    if (read(fd, buffer, sizeof(buffer)) < 0) {
+        ctrllog::warn("readInputEdges: read failed");
+        return -1;
+    }
+    return 1;
+}
+
+void Motor::setGlitchUs(int32_t glitchUs)
+{
+    if (m_inputEdge) {
+        m_inputEdge->setGlitchUs(glitchUs);
+    }
+}
+
+int32_t Motor::getDrivePwm()
+{
+    int32_t pwm = getRunPwm();
+    if (pwm <= 0) {
+        return 0;
+    }
+    return std::clamp(pwm + getPwmBoost(), 1, m_maxPwm);
+}
+
+void Motor::applyHwPwm()
+{
+    if (!m_pwmChannel) {
+        return;
+    }
+
+    int32_t pwm = getDrivePwm();
+    bool run = (getRunState() != MotorState::Stop) && (pwm > 0);
+    setNowState(run ? getRunState() : MotorState::Stop);
+    m_pwmChannel->setDutyNs(static_cast<int32_t>((int64_t)m_pwmChannel->getPeriodNs() * pwm / m_maxPwm));
+    m_pwmChannel->setEnable(run);
+}
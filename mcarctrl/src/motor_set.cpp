@@ -0,0 +1,23 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <xapi/easylog.hpp>
+#include "motor_set.hpp"
+
+std::unique_ptr<MotorSet> MotorSet::create(const SpeedConfig& config, SimBackend* sim)
+{
+    ctrllog::info("motor set: {} motors, chassis {}", config.motor.size(),
+                  k_chassisNames[static_cast<int32_t>(config.chassis)]);
+
+    switch (config.motor.size()) {
+    case 1:
+        return std::make_unique<MotorSetN<1>>(config, sim);
+    case 2:
+        return std::make_unique<MotorSetN<2>>(config, sim);
+    case 3:
+        return std::make_unique<MotorSetN<3>>(config, sim);
+    case 4:
+        return std::make_unique<MotorSetN<4>>(config, sim);
+    default:
+        ctrllog::error("motor set: {} motors, not 1-{}", config.motor.size(), MOTOR_NUM_MAX);
+        return nullptr;
+    }
+}
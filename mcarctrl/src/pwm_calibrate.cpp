@@ -0,0 +1,216 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <xapi/easylog.hpp>
+#include <xapi/param_json.hpp>
+#include "pwm_calibrate.hpp"
+#include "car_ctrl.hpp"
+
+PwmCalibrate::PwmCalibrate(CarCtrl* carCtrl, CarSpeed& carSpeed) :
+    m_carCtrl{carCtrl},
+    m_carSpeed{carSpeed}
+{
+}
+
+PwmCalibrate::~PwmCalibrate()
+{
+    cancel();
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+}
+
+int32_t PwmCalibrate::start()
+{
+    if (m_running.exchange(true)) {
+        ctrllog::warn("calibrate: already running");
+        return -1;
+    }
+
+    if (m_thread.joinable()) {
+        m_thread.join();
+    }
+    {
+        std::lock_guard lock(m_mutex);
+        m_state = {};
+        m_state.state = CALIBRATE_RUNNING;
+        m_state.message = "sweep";
+    }
+    m_cancel.store(false);
+    m_thread = std::thread([this]() { run(); });
+    return 0;
+}
+
+void PwmCalibrate::cancel()
+{
+    m_cancel.store(true);
+}
+
+CalibrateState PwmCalibrate::getState()
+{
+    std::lock_guard lock(m_mutex);
+    return m_state;
+}
+
+bool PwmCalibrate::waitFor(int32_t time)
+{
+    // sleep in slices, so cancel, a new motion command or a stop ends it at once
+    constexpr int32_t slice = 50;
+    for (int32_t i = 0; i < time; i += slice) {
+        if (m_cancel.load() || (m_carCtrl->getCtrlMode() != CTRL_MODE_SPEED)) {
+            return false;
+        }
+        for (int32_t motor = 0; motor < m_carSpeed.getMotorNum(); motor++) {
+            if (m_carSpeed.getRunState(motor) != MotorState::Forward) {
+                return false;
+            }
+        }
+        std::this_thread::sleep_for(std::chrono::milliseconds(slice));
+    }
+    return true;
+}
+
+void PwmCalibrate::finish(int32_t state, std::string message)
+{
+    // a new motion command took over the motors, only restore pwm of level
+    if (m_carCtrl->getCtrlMode() == CTRL_MODE_SPEED) {
+        for (int32_t i = 0; i < m_carSpeed.getMotorNum(); i++) {
+            m_carSpeed.setMotorState(i, MotorState::Stop);
+        }
+    }
+    m_carSpeed.setMotorSpeedLevel(m_carSpeed.getMotorSpeedLevel());
+    m_carSpeed.setStallCheck(true);
+
+    if (state == CALIBRATE_FAILED) {
+        ctrllog::warn("calibrate: {}", message);
+    } else {
+        ctrllog::info("calibrate: {}", message);
+    }
+
+    std::lock_guard lock(m_mutex);
+    m_state.state = state;
+    m_state.message = std::move(message);
+    m_running.store(false);
+}
+
+void PwmCalibrate::run()
+{
+    const int32_t motorNum = m_carSpeed.getMotorNum();
+    std::vector<int32_t> sweepPwm;
+    for (int32_t pwm = k_sweepStep; pwm <= Motor::getMaxPwm(); pwm += k_sweepStep) {
+        sweepPwm.push_back(pwm);
+    }
+    std::vector<std::vector<double>> rate(motorNum, std::vector<double>(sweepPwm.size(), 0));
+
+    // low sweep points are below start pwm of wheels, not a stall
+    m_carSpeed.setStallCheck(false);
+    for (int32_t i = 0; i < motorNum; i++) {
+        m_carSpeed.setMotorState(i, MotorState::Forward);
+    }
+
+    for (size_t point = 0; point < sweepPwm.size(); point++) {
+        for (int32_t i = 0; i < motorNum; i++) {
+            m_carSpeed.setMotorPwm(i, sweepPwm[point]);
+        }
+        if (!waitFor(k_settleTime)) {
+            finish(CALIBRATE_FAILED, "cancelled");
+            return;
+        }
+
+        std::vector<int32_t> count(motorNum);
+        for (int32_t i = 0; i < motorNum; i++) {
+            count[i] = m_carSpeed.getEncoderCount(i);
+        }
+        if (!waitFor(k_measureTime)) {
+            finish(CALIBRATE_FAILED, "cancelled");
+            return;
+        }
+        for (int32_t i = 0; i < motorNum; i++) {
+            rate[i][point] = (m_carSpeed.getEncoderCount(i) - count[i]) * 1000.0 / k_measureTime;
+        }
+
+        std::lock_guard lock(m_mutex);
+        m_state.progress = static_cast<int32_t>((point + 1) * 100 / sweepPwm.size());
+        m_state.rate.clear();
+        for (const auto& item : rate) {
+            m_state.rate.emplace_back(item.begin(), item.end());
+        }
+    }
+
+    auto pwm = solveLevels(sweepPwm, rate, static_cast<int32_t>(k_pwmLevelNames.size()));
+    if (pwm.empty()) {
+        finish(CALIBRATE_FAILED, "no encoder edges, check wheels are free and encoders wired");
+        return;
+    }
+
+    {
+        std::lock_guard lock(m_mutex);
+        m_state.pwm = pwm;
+    }
+    m_carSpeed.setPwmTable(pwm);
+    if (saveParam(pwm) < 0) {
+        finish(CALIBRATE_FAILED, "pwm table applied, but not saved to " + m_carSpeed.getOption().paramFile);
+        return;
+    }
+    finish(CALIBRATE_DONE, "pwm table saved to " + m_carSpeed.getOption().paramFile);
+}
+
+std::vector<std::vector<int32_t>> PwmCalibrate::solveLevels(const std::vector<int32_t>& sweepPwm,
+                                                            const std::vector<std::vector<double>>& rate,
+                                                            int32_t levelNum)
+{
+    if (sweepPwm.empty() || rate.empty() || (levelNum < 2)) {
+        return {};
+    }
+
+    // curve per wheel, monotone against encoder noise
+    std::vector<std::vector<double>> curve = rate;
+    double commonMax = -1;
+    for (auto& wheel : curve) {
+        for (size_t i = 1; i < wheel.size(); i++) {
+            wheel[i] = std::max(wheel[i], wheel[i - 1]);
+        }
+        commonMax = (commonMax < 0) ? wheel.back() : std::min(commonMax, wheel.back());
+    }
+    if (commonMax <= 0) {
+        return {};
+    }
+
+    // inverse of piecewise linear curve, (0, 0) before first sweep point
+    auto solvePwm = [&](const std::vector<double>& wheel, double target) {
+        double lastPwm = 0, lastRate = 0;
+        for (size_t i = 0; i < wheel.size(); i++) {
+            if (wheel[i] >= target) {
+                double ratio = (wheel[i] > lastRate) ? (target - lastRate) / (wheel[i] - lastRate) : 1.0;
+                return static_cast<int32_t>(std::lround(lastPwm + ratio * (sweepPwm[i] - lastPwm)));
+            }
+            lastPwm = sweepPwm[i];
+            lastRate = wheel[i];
+        }
+        return sweepPwm.back();
+    };
+
+    // level 0 stops, the top level is the rate all wheels can reach
+    std::vector<std::vector<int32_t>> pwm(levelNum, std::vector<int32_t>(curve.size(), 0));
+    for (int32_t level = 1; level < levelNum; level++) {
+        double target = commonMax * level / (levelNum - 1);
+        for (size_t wheel = 0; wheel < curve.size(); wheel++) {
+            pwm[level][wheel] = solvePwm(curve[wheel], target);
+        }
+    }
+    return pwm;
+}
+
+int32_t PwmCalibrate::saveParam(const std::vector<std::vector<int32_t>>& pwm)
+{
+    ParamJson param(m_carSpeed.getOption().paramFile);
+    const std::string& jsonItem = m_carSpeed.getJsonItem();
+
+    for (size_t level = 0; (level < pwm.size()) && (level < k_pwmLevelNames.size()); level++) {
+        if (!param.setJsonParam(jsonItem + ".pwm." + std::string(k_pwmLevelNames[level]), pwm[level])) {
+            return -1;
+        }
+    }
+    return param.saveFile() ? 0 : -1;
+}
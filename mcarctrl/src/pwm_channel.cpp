@@ -0,0 +1,187 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstring>
+#include <xapi/easylog.hpp>
+#include "pwm_channel.hpp"
+
+PwmChannel::PwmChannel(int32_t chip, int32_t channel, int32_t periodNs, SimBackend* sim) :
+    m_chip(chip),
+    m_channel(channel),
+    m_periodNs(periodNs),
+    m_sim(sim)
+{
+    char path[256] {0};
+
+    if (m_sim) {
+        // simulated channel, duty goes to gpio log
+        m_valid = true;
+        setDutyNs(0);
+        return;
+    }
+
+    if (exportChannel() < 0) {
+        return;
+    }
+
+    // duty must not exceed period, clear it before period
+    writeAttr("enable", 0);
+    writeAttr("duty_cycle", 0);
+    if (writeAttr("period", m_periodNs) < 0) {
+        return;
+    }
+
+    snprintf(path, sizeof(path), "%s/pwmchip%d/pwm%d/duty_cycle", s_sysfsRoot.c_str(), m_chip, m_channel);
+    m_dutyFd = open(path, O_WRONLY);
+    snprintf(path, sizeof(path), "%s/pwmchip%d/pwm%d/enable", s_sysfsRoot.c_str(), m_chip, m_channel);
+    m_enableFd = open(path, O_WRONLY);
+    if ((m_dutyFd < 0) || (m_enableFd < 0)) {
+        ctrllog::error("fail to open pwmchip{} pwm{}", m_chip, m_channel);
+        return;
+    }
+
+    m_valid = true;
+    setDutyNs(0);
+}
+
+PwmChannel::~PwmChannel()
+{
+    if (m_valid) {
+        setEnable(false);
+    }
+    if (m_sim) {
+        return;
+    }
+
+    if (m_dutyFd >= 0)
+        close(m_dutyFd);
+    if (m_enableFd >= 0)
+        close(m_enableFd);
+    if (m_valid)
+        unexportChannel();
+}
+
+int32_t PwmChannel::setDutyNs(int32_t dutyNs)
+{
+    char buffer[16] {0};
+
+    if (dutyNs == m_duty) {
+        return 0;
+    }
+    m_duty = dutyNs;
+
+    if (m_sim) {
+        m_sim->writePin(k_simPwmPinBase + m_chip * 32 + m_channel, dutyNs);
+        return 0;
+    }
+    if (m_dutyFd < 0)
+        return -1;
+
+    int32_t len = snprintf(buffer, sizeof(buffer), "%d", dutyNs);
+    if (pwrite(m_dutyFd, buffer, len, 0) < 0) {
+        ctrllog::warn("fail to write duty pwmchip{} pwm{}", m_chip, m_channel);
+        return -1;
+    }
+
+    return 0;
+}
+
+int32_t PwmChannel::setEnable(bool enable)
+{
+    if ((enable ? 1 : 0) == m_enable) {
+        return 0;
+    }
+    m_enable = enable ? 1 : 0;
+
+    if (m_sim) {
+        if (!enable) {
+            m_sim->writePin(k_simPwmPinBase + m_chip * 32 + m_channel, 0);
+            m_duty = 0;
+        }
+        return 0;
+    }
+    if (m_enableFd < 0)
+        return -1;
+
+    if (pwrite(m_enableFd, enable ? "1" : "0", 1, 0) < 0) {
+        ctrllog::warn("fail to enable pwmchip{} pwm{}", m_chip, m_channel);
+        return -1;
+    }
+
+    return 0;
+}
+
+int32_t PwmChannel::exportChannel()
+{
+    char buffer[256] {0};
+    int32_t fd, len;
+    int32_t ret = 0;
+
+    snprintf(buffer, sizeof(buffer), "%s/pwmchip%d/pwm%d", s_sysfsRoot.c_str(), m_chip, m_channel);
+    if (access(buffer, F_OK) == 0) {
+        //directory exist, no need export
+        return 0;
+    }
+
+    snprintf(buffer, sizeof(buffer), "%s/pwmchip%d/export", s_sysfsRoot.c_str(), m_chip);
+    fd = open(buffer, O_WRONLY);
+    if (fd < 0) {
+        ctrllog::warn("no pwmchip{} for pwm{}", m_chip, m_channel);
+        return -1;
+    }
+
+    len = snprintf(buffer, sizeof(buffer), "%d", m_channel);
+    if (write(fd, buffer, len) < 0) {
+        ctrllog::warn("fail to export pwmchip{} pwm{}", m_chip, m_channel);
+        ret = -1;
+    }
+
+    close(fd);
+    return ret;
+}
+
+int32_t PwmChannel::unexportChannel()
+{
+    char buffer[256] {0};
+    int32_t fd, len;
+
+    snprintf(buffer, sizeof(buffer), "%s/pwmchip%d/unexport", s_sysfsRoot.c_str(), m_chip);
+    fd = open(buffer, O_WRONLY);
+    if (fd < 0) {
+        ctrllog::warn("fail to open unexport of pwmchip{}", m_chip);
+        return -1;
+    }
+
+    len = snprintf(buffer, sizeof(buffer), "%d", m_channel);
+    if (write(fd, buffer, len) < 0) {
+        ctrllog::warn("fail to unexport pwmchip{} pwm{}", m_chip, m_channel);
+        close(fd);
+        return -1;
+    }
+
+    close(fd);
+    return 0;
+}
+
+int32_t PwmChannel::writeAttr(const char* attr, int64_t value)
+{
+    char buffer[256] {0};
+
+    snprintf(buffer, sizeof(buffer), "%s/pwmchip%d/pwm%d/%s", s_sysfsRoot.c_str(), m_chip, m_channel, attr);
+    int32_t fd = open(buffer, O_WRONLY);
+    if (fd < 0) {
+        ctrllog::warn("fail to open {} of pwmchip{} pwm{}", attr, m_chip, m_channel);
+        return -1;
+    }
+
+    int32_t len = snprintf(buffer, sizeof(buffer), "%lld", (long long)value);
+    if (write(fd, buffer, len) < 0) {
+        ctrllog::warn("fail to write {} of pwmchip{} pwm{}", attr, m_chip, m_channel);
+        close(fd);
+        return -1;
+    }
+
+    close(fd);
+    return 0;
+}
@@ -0,0 +1,135 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <algorithm>
+#include "pwm_scheduler.hpp"
+
+PwmScheduler::PwmScheduler(int32_t stepUs) :
+    m_stepUs{stepUs},
+    m_periodUs{stepUs * Motor::getMaxPwm()}
+{
+}
+
+template <size_t N>
+void PwmScheduler::build(std::span<Motor, N> motor, int64_t now)
+{
+    static_assert(N <= MOTOR_NUM_MAX);
+    m_motor = motor.data();
+    m_motorNum = N;
+    m_edgeNum = 0;
+    if (m_periodStart < 0) {
+        m_periodStart = now;
+    }
+
+    for (size_t i = 0; i < N; i++) {
+        m_phase[i] = (i * Motor::getMaxPwm() / N) * m_stepUs;
+        m_onTime[i] = 0;
+
+        if (motor[i].isHwPwm()) {
+            motor[i].applyHwPwm();
+            continue;
+        }
+
+        int32_t pwm = motor[i].getDrivePwm();
+        if ((motor[i].getRunState() == MotorState::Stop) || (pwm == 0)) {
+            motor[i].setNowState(MotorState::Stop);
+            continue;
+        }
+        if (pwm == Motor::getMaxPwm()) {
+            motor[i].setNowState(motor[i].getRunState());
+            continue;
+        }
+
+        m_onTime[i] = pwm * m_stepUs;
+        m_edge[m_edgeNum++] = {m_phase[i], static_cast<int32_t>(i), true};
+        m_edge[m_edgeNum++] = {(m_phase[i] + m_onTime[i]) % m_periodUs, static_cast<int32_t>(i), false};
+    }
+
+    // insertion sort: stable and without allocation, at most two edges per motor
+    for (size_t i = 1; i < m_edgeNum; i++) {
+        PwmEdge edge = m_edge[i];
+        size_t j = i;
+        for (; (j > 0) && (m_edge[j - 1].offset > edge.offset); j--) {
+            m_edge[j] = m_edge[j - 1];
+        }
+        m_edge[j] = edge;
+    }
+    resync(now);
+}
+
+template void PwmScheduler::build<0>(std::span<Motor, 0> motor, int64_t now);
+template void PwmScheduler::build<1>(std::span<Motor, 1> motor, int64_t now);
+template void PwmScheduler::build<2>(std::span<Motor, 2> motor, int64_t now);
+template void PwmScheduler::build<3>(std::span<Motor, 3> motor, int64_t now);
+template void PwmScheduler::build<4>(std::span<Motor, 4> motor, int64_t now);
+
+void PwmScheduler::resync(int64_t now)
+{
+    // keep period start, so phases stay in place over rebuilds
+    while (m_periodStart > now) {
+        m_periodStart -= m_periodUs;
+    }
+    m_periodStart += (now - m_periodStart) / m_periodUs * m_periodUs;
+    int32_t pos = static_cast<int32_t>(now - m_periodStart);
+
+    // state of each motor at pos: on between its on and off edge, cyclic
+    for (size_t i = 0; i < m_edgeNum; i++) {
+        if (!m_edge[i].on) {
+            continue;
+        }
+        auto& motor = m_motor[m_edge[i].motor];
+        int32_t on = m_edge[i].offset;
+        int32_t off = (on + m_onTime[m_edge[i].motor]) % m_periodUs;
+        bool run = (on < off) ? ((pos >= on) && (pos < off)) : ((pos >= on) || (pos < off));
+        motor.setNowState(run ? motor.getRunState() : MotorState::Stop);
+    }
+
+    m_next = 0;
+    while ((m_next < m_edgeNum) && (m_edge[m_next].offset <= pos)) {
+        m_next++;
+    }
+    if (m_next == m_edgeNum) {
+        m_next = 0;
+        m_periodStart += m_periodUs;
+    }
+}
+
+int64_t PwmScheduler::nextTime()
+{
+    return m_periodStart + m_edge[m_next].offset;
+}
+
+int64_t PwmScheduler::run(int64_t now)
+{
+    if (!m_edgeNum) {
+        return 0;
+    }
+
+    if (now - nextTime() >= m_periodUs) {
+        // late by a whole period, no use to replay missed edges
+        resync(now);
+        return nextTime();
+    }
+
+    while (nextTime() <= now) {
+        const auto& edge = m_edge[m_next];
+        auto& motor = m_motor[edge.motor];
+        motor.setNowState(edge.on ? motor.getRunState() : MotorState::Stop);
+
+        if (++m_next == m_edgeNum) {
+            m_next = 0;
+            m_periodStart += m_periodUs;
+        }
+    }
+    return nextTime();
+}
+
+int32_t PwmScheduler::getPhaseCount(int32_t motor, int64_t now)
+{
+    if ((motor >= m_motorNum) || (m_periodStart < 0)) {
+        return 0;
+    }
+    int64_t pos = (now - m_periodStart - m_phase[motor]) % m_periodUs;
+    if (pos < 0) {
+        pos += m_periodUs;
+    }
+    return static_cast<int32_t>(pos / m_stepUs);
+}
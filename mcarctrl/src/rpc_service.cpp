@@ -1,99 +1,199 @@
 
-#include <xapi/cmn_singleton.hpp>
 #include <xapi/easylog.hpp>
+#include <xapi/metrics.hpp>
 #include <rpc_service.hpp>
 #include "car_ctrl.hpp"
 
+namespace {
+
+// calls and time of one handler, the series is added on its first call
+template<auto func>
+metrics::Histogram& rpcSeconds()
+{
+    static metrics::Histogram histogram {"agvctrl_rpc_duration_seconds", "time spent in rpc handler",
+                                         metrics::k_latencyBoundsUs, 1e6,
+                                         "handler=\"" + std::string(coro_rpc::get_func_name<func>()) + "\""};
+    return histogram;
+}
+
+}  // namespace
+
 int32_t setCtrlSteps(int32_t motor, int32_t steps)
 {
-    auto& ctrl = cmn::getSingletonInstance<CarCtrl>();
+    metrics::ScopedTimer timer(rpcSeconds<setCtrlSteps>());
+    auto& ctrl = CarCtrl::current();
     return ctrl.setCtrlSteps(motor, steps);
 }
 
 int32_t getCtrlSteps(int32_t motor)
 {
-    auto& ctrl = cmn::getSingletonInstance<CarCtrl>();
+    metrics::ScopedTimer timer(rpcSeconds<getCtrlSteps>());
+    auto& ctrl = CarCtrl::current();
     return ctrl.getCtrlSteps(motor);
 }
 
 int32_t getActualSteps(int32_t motor)
 {
-    auto& ctrl = cmn::getSingletonInstance<CarCtrl>();
+    metrics::ScopedTimer timer(rpcSeconds<getActualSteps>());
+    auto& ctrl = CarCtrl::current();
     return ctrl.getActualSteps(motor);
 }
 
 int32_t setRunTime(int32_t time)
 {
-    auto& ctrl = cmn::getSingletonInstance<CarCtrl>();
+    metrics::ScopedTimer timer(rpcSeconds<setRunTime>());
+    auto& ctrl = CarCtrl::current();
     return ctrl.setRunTime(time);
 }
 
 int32_t getActualSpeed(int32_t motor)
 {
-    auto& ctrl = cmn::getSingletonInstance<CarCtrl>();
+    metrics::ScopedTimer timer(rpcSeconds<getActualSpeed>());
+    auto& ctrl = CarCtrl::current();
     return ctrl.getActualSpeed(motor);
 }
 
 int32_t setMotorSpeedLevel(int32_t level)
 {
-    auto& ctrl = cmn::getSingletonInstance<CarCtrl>();
+    metrics::ScopedTimer timer(rpcSeconds<setMotorSpeedLevel>());
+    auto& ctrl = CarCtrl::current();
     return ctrl.setMotorSpeedLevel(level);
 }
 
 int32_t getMotorSpeedLevel()
 {
-    auto& ctrl = cmn::getSingletonInstance<CarCtrl>();
+    metrics::ScopedTimer timer(rpcSeconds<getMotorSpeedLevel>());
+    auto& ctrl = CarCtrl::current();
     return ctrl.getMotorSpeedLevel();
 }
 
 void setMotorPwm(int32_t motor, int32_t pwm)
 {
-    auto& ctrl = cmn::getSingletonInstance<CarCtrl>();
+    metrics::ScopedTimer timer(rpcSeconds<setMotorPwm>());
+    auto& ctrl = CarCtrl::current();
     ctrl.setMotorPwm(motor, pwm);
 }
 
 int32_t getMotorPwm(int32_t motor)
 {
-    auto& ctrl = cmn::getSingletonInstance<CarCtrl>();
+    metrics::ScopedTimer timer(rpcSeconds<getMotorPwm>());
+    auto& ctrl = CarCtrl::current();
     return ctrl.getMotorPwm(motor);
 }
 
 void setAllMotorState(int32_t state)
 {
-    auto& ctrl = cmn::getSingletonInstance<CarCtrl>();
+    metrics::ScopedTimer timer(rpcSeconds<setAllMotorState>());
+    auto& ctrl = CarCtrl::current();
     return ctrl.setAllMotorState(state);
 }
 
 int32_t getCtrlMode()
 {
-    auto& ctrl = cmn::getSingletonInstance<CarCtrl>();
+    metrics::ScopedTimer timer(rpcSeconds<getCtrlMode>());
+    auto& ctrl = CarCtrl::current();
     return ctrl.getCtrlMode();
 }
 
 int32_t getMotorNum()
 {
-    auto& ctrl = cmn::getSingletonInstance<CarCtrl>();
+    metrics::ScopedTimer timer(rpcSeconds<getMotorNum>());
+    auto& ctrl = CarCtrl::current();
     return ctrl.getMotorNum();
 }
 
 int32_t setCarSteps(CarDirection dir, int32_t steps)
 {
-    auto& ctrl = cmn::getSingletonInstance<CarCtrl>();
+    metrics::ScopedTimer timer(rpcSeconds<setCarSteps>());
+    auto& ctrl = CarCtrl::current();
     return ctrl.setCarSteps(dir, steps);
 }
 
 int32_t setCarMoving(CarDirection dir)
 {
-    auto& ctrl = cmn::getSingletonInstance<CarCtrl>();
+    metrics::ScopedTimer timer(rpcSeconds<setCarMoving>());
+    auto& ctrl = CarCtrl::current();
     return ctrl.setCarMoving(dir);
 }
 
 int32_t setSteerTurn(int32_t dir, uint32_t time)
 {
-    auto& ctrl = cmn::getSingletonInstance<CarCtrl>();
+    metrics::ScopedTimer timer(rpcSeconds<setSteerTurn>());
+    auto& ctrl = CarCtrl::current();
     return ctrl.steerTurn(dir, time);
 }
 
+int32_t keepAlive()
+{
+    metrics::ScopedTimer timer(rpcSeconds<keepAlive>());
+    auto& ctrl = CarCtrl::current();
+    return ctrl.keepAlive();
+}
+
+int32_t getWatchdogTrips()
+{
+    metrics::ScopedTimer timer(rpcSeconds<getWatchdogTrips>());
+    auto& ctrl = CarCtrl::current();
+    return ctrl.getWatchdogTrips();
+}
+
+int32_t getWatchdogLatency()
+{
+    metrics::ScopedTimer timer(rpcSeconds<getWatchdogLatency>());
+    auto& ctrl = CarCtrl::current();
+    return ctrl.getWatchdogLatency();
+}
+
+LoopJitter getLoopJitter()
+{
+    metrics::ScopedTimer timer(rpcSeconds<getLoopJitter>());
+    auto& ctrl = CarCtrl::current();
+    return ctrl.getLoopJitter();
+}
+
+std::vector<EncoderState> getEncoderState()
+{
+    metrics::ScopedTimer timer(rpcSeconds<getEncoderState>());
+    auto& ctrl = CarCtrl::current();
+    return ctrl.getEncoderState();
+}
+
+int32_t autoCalibrate(int32_t action)
+{
+    metrics::ScopedTimer timer(rpcSeconds<autoCalibrate>());
+    auto& ctrl = CarCtrl::current();
+    return ctrl.autoCalibrate(action);
+}
+
+CalibrateState getCalibrateState()
+{
+    metrics::ScopedTimer timer(rpcSeconds<getCalibrateState>());
+    auto& ctrl = CarCtrl::current();
+    return ctrl.getCalibrateState();
+}
+
+TelemetrySeries getTelemetryHistory(std::string metric, int64_t from, int64_t to, int32_t resolution)
+{
+    metrics::ScopedTimer timer(rpcSeconds<getTelemetryHistory>());
+    auto& ctrl = CarCtrl::current();
+    return ctrl.getTelemetryHistory(metric, from, to, resolution);
+}
+
+FlightRecordChunk getFlightRecords(uint64_t fromSeq)
+{
+    metrics::ScopedTimer timer(rpcSeconds<getFlightRecords>());
+    auto& ctrl = CarCtrl::current();
+    return ctrl.getFlightRecords(fromSeq);
+}
+
+std::string getMetrics()
+{
+    metrics::ScopedTimer timer(rpcSeconds<getMetrics>());
+    std::string text;
+    metrics::render(text);
+    return text;
+}
+
 void quitApp(int32_t param)
 {
     exit(param);
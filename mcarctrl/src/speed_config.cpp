@@ -0,0 +1,381 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fmt/format.h>
+#include <fmt/ranges.h>
+#include <ylt/struct_pack.hpp>
+#include <xapi/easylog.hpp>
+#include <xapi/json_bind.hpp>
+#include <xapi/param_json.hpp>
+#include "speed_config.hpp"
+
+namespace {
+
+// schema of device item in param.json, member names are json keys
+struct RealtimeParam
+{
+    std::optional<std::string> policy;
+    std::optional<int32_t>     priority;
+    std::optional<int32_t>     cpu;
+    std::optional<bool>        lock_memory;
+};
+YLT_REFL(RealtimeParam, policy, priority, cpu, lock_memory)
+
+struct StallParam
+{
+    std::optional<std::string> response;
+    std::optional<int32_t>     window_ms;
+    std::optional<int32_t>     min_rate;
+    std::optional<double>      slip_ratio;
+    std::optional<int32_t>     boost_pwm;
+    std::optional<int32_t>     hold_windows;
+};
+YLT_REFL(StallParam, response, window_ms, min_rate, slip_ratio, boost_pwm, hold_windows)
+
+struct PwmParam
+{
+    std::vector<int32_t> zero, one, two, three, four, five, six, seven, eight, nine;
+};
+YLT_REFL(PwmParam, zero, one, two, three, four, five, six, seven, eight, nine)
+
+struct DeviceParam
+{
+    std::optional<std::string>   chassis;
+    int32_t motor_num;
+    std::optional<int32_t>       watchdog_time;
+    std::optional<std::string>   recorder_file;
+    std::optional<int32_t>       recorder_time;
+    std::optional<std::string>   recorder_archive;
+    std::optional<int32_t>       recorder_archive_mb;
+    std::optional<std::string>   snapshot_file;
+    std::optional<int32_t>       snapshot_ms;
+    std::optional<RealtimeParam> realtime;
+    std::optional<int32_t>       pwm_period_ns;
+    std::optional<int32_t>       encoder_glitch_us;
+    std::optional<StallParam>    stall;
+    PwmParam pwm;
+};
+YLT_REFL(DeviceParam, chassis, motor_num, watchdog_time, recorder_file, recorder_time, recorder_archive,
+         recorder_archive_mb, snapshot_file, snapshot_ms, realtime, pwm_period_ns, encoder_glitch_us, stall, pwm)
+
+// pins of one motor: output pins, encoder input, kernel pwm [chip, channel]
+using PortParam = std::optional<std::vector<uint32_t>>;
+using IrParam = std::optional<uint32_t>;
+using ChannelParam = std::optional<std::vector<int32_t>>;
+
+struct M1MotorParam
+{
+    PortParam motor_front_left, motor_front_right, motor_back_left, motor_back_right;
+    IrParam   ir_front_left, ir_front_right, ir_back_left, ir_back_right;
+    ChannelParam motor_front_left_pwm, motor_front_right_pwm, motor_back_left_pwm, motor_back_right_pwm;
+};
+YLT_REFL(M1MotorParam, motor_front_left, motor_front_right, motor_back_left, motor_back_right,
+         ir_front_left, ir_front_right, ir_back_left, ir_back_right,
+         motor_front_left_pwm, motor_front_right_pwm, motor_back_left_pwm, motor_back_right_pwm)
+
+struct PcMotorParam
+{
+    PortParam    motor_front, motor_back;
+    ChannelParam motor_front_pwm, motor_back_pwm;
+    PortParam    steer;
+};
+YLT_REFL(PcMotorParam, motor_front, motor_back, motor_front_pwm, motor_back_pwm, steer)
+
+static_assert(ylt::reflection::members_count_v<PwmParam> == k_pwmLevelNames.size());
+
+// parsed config of one device, valid while the param file keeps inode, size and mtime
+struct SpeedConfigCache
+{
+    uint64_t    fileIno {0};
+    uint64_t    fileSize {0};
+    int64_t     fileMtime {0};      // ns
+    std::string deviceName;
+    SpeedConfig config;
+};
+
+bool statParamFile(const std::string& fileName, SpeedConfigCache& key)
+{
+    struct stat st;
+    if (stat(fileName.c_str(), &st) < 0) {
+        return false;
+    }
+    key.fileIno = st.st_ino;
+    key.fileSize = st.st_size;
+    key.fileMtime = st.st_mtim.tv_sec * 1000000000LL + st.st_mtim.tv_nsec;
+    return true;
+}
+
+bool isSameFile(const SpeedConfigCache& key, const SpeedConfigCache& other)
+{
+    return (key.fileIno == other.fileIno) && (key.fileSize == other.fileSize) && (key.fileMtime == other.fileMtime);
+}
+
+bool readConfigCache(const std::string& fileName, const SpeedConfigCache& key, const std::string& deviceName,
+                     SpeedConfig& config)
+{
+    SpeedConfigCache cache;
+    int32_t fd = open(getConfigCacheName(fileName).c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return false;
+    }
+    std::string buffer;
+    char block[4096];
+    ssize_t len;
+    while ((len = read(fd, block, sizeof(block))) > 0) {
+        buffer.append(block, len);
+    }
+    close(fd);
+
+    // struct_pack checks type hash, a cache of an older layout fails here
+    if (struct_pack::deserialize_to(cache, buffer.data(), buffer.size())) {
+        return false;
+    }
+    if (!isSameFile(key, cache) || (cache.deviceName != deviceName)) {
+        return false;
+    }
+    config = std::move(cache.config);
+    return true;
+}
+
+// key is the stat taken before parsing, a file rewritten since then is not cached
+void writeConfigCache(const std::string& fileName, const SpeedConfigCache& key, const SpeedConfig& config)
+{
+    SpeedConfigCache cache;
+    if (!statParamFile(fileName, cache) || !isSameFile(key, cache)) {
+        ctrllog::info("{} changed while parsed, no config cache", fileName);
+        return;
+    }
+    cache.deviceName = config.deviceName;
+    cache.config = config;
+    auto buffer = struct_pack::serialize<std::string>(cache);
+
+    // temp file and rename, a reader never sees half a cache
+    std::string cacheName = getConfigCacheName(fileName);
+    std::string tmpName = cacheName + ".tmp";
+    int32_t fd = open(tmpName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        ctrllog::info("no config cache {}: {}", cacheName, strerror(errno));
+        return;
+    }
+    bool ret = (write(fd, buffer.data(), buffer.size()) == (ssize_t)buffer.size());
+    close(fd);
+    if (!ret || (rename(tmpName.c_str(), cacheName.c_str()) < 0)) {
+        ctrllog::warn("write config cache {} failed: {}", cacheName, strerror(errno));
+        unlink(tmpName.c_str());
+    }
+}
+
+}  // namespace
+
+std::string getConfigCacheName(const std::string& fileName)
+{
+    return fileName + ".cache";
+}
+
+bool loadSpeedConfig(const std::string& fileName, const std::string& deviceName,
+                     SpeedConfig& config, std::vector<std::string>& errors, bool useCache)
+{
+    size_t errorNum = errors.size();
+
+    // stat before parsing, the cache must not carry an older file under a newer key
+    SpeedConfigCache key;
+    useCache = useCache && statParamFile(fileName, key);
+    if (useCache && readConfigCache(fileName, key, deviceName, config)) {
+        ctrllog::info("initParam: {} of {} from cache", deviceName, fileName);
+        return true;
+    }
+
+    config = {};
+    config.deviceName = deviceName;
+
+    ParamJson param(fileName);
+    if (!param.isLoaded()) {
+        errors.push_back(fmt::format("{} is missing or not valid json", fileName));
+        return false;
+    }
+    const Json* item = param.findJsonItem(deviceName);
+    if (item == nullptr) {
+        errors.push_back(fmt::format("{} has no item {}", fileName, deviceName));
+        return false;
+    }
+
+    // one pass over the device item, every missing or mistyped key is reported
+    DeviceParam device {};
+    jsonbind::bindJson(*item, device, errors, deviceName);
+
+    // chassis follows device unless param.json names it
+    config.chassis = (deviceName == k_deviceNamePc) ? ChassisKind::Steer : ChassisKind::Mecanum;
+    if (device.chassis) {
+        auto it = std::find(k_chassisNames.begin(), k_chassisNames.end(), *device.chassis);
+        if (it == k_chassisNames.end()) {
+            errors.push_back(fmt::format("{}.chassis {} is not {}", deviceName, *device.chassis,
+                                         fmt::join(k_chassisNames, " or ")));
+        } else {
+            config.chassis = static_cast<ChassisKind>(it - k_chassisNames.begin());
+        }
+    }
+
+    config.motorNum = device.motor_num;
+    if ((config.motorNum <= 0) || (config.motorNum > MOTOR_NUM_MAX)) {
+        errors.push_back(fmt::format("{}.motor_num {} is not 1-{}", deviceName, config.motorNum, MOTOR_NUM_MAX));
+    }
+
+    if (device.realtime) {
+        auto& option = config.realtime;
+        option.policy = device.realtime->policy.value_or(option.policy);
+        option.priority = device.realtime->priority.value_or(option.priority);
+        option.cpu = device.realtime->cpu.value_or(option.cpu);
+        option.lockMemory = device.realtime->lock_memory.value_or(option.lockMemory);
+    }
+
+    if (!device.watchdog_time) {
+        ctrllog::warn("initParam: no watchdog time, use default {} ms", config.watchdogTime);
+    } else if (*device.watchdog_time < 0) {
+        errors.push_back(fmt::format("watchdog_time {} is negative", *device.watchdog_time));
+    } else {
+        config.watchdogTime = *device.watchdog_time;
+    }
+
+    if (device.stall) {
+        auto& option = config.stall;
+        option.response = device.stall->response.value_or(option.response);
+        option.windowMs = device.stall->window_ms.value_or(option.windowMs);
+        option.minRate = device.stall->min_rate.value_or(option.minRate);
+        option.slipRatio = device.stall->slip_ratio.value_or(option.slipRatio);
+        option.boostPwm = device.stall->boost_pwm.value_or(option.boostPwm);
+        option.holdWindows = device.stall->hold_windows.value_or(option.holdWindows);
+        if ((option.response != "report") && (option.response != "boost") && (option.response != "stop")) {
+            errors.push_back(fmt::format("stall.response {} is not report, boost or stop", option.response));
+        }
+        if (option.windowMs <= 0) {
+            errors.push_back(fmt::format("stall.window_ms {} is not positive", option.windowMs));
+        }
+        if (option.holdWindows <= 0) {
+            errors.push_back(fmt::format("stall.hold_windows {} is not positive", option.holdWindows));
+        }
+    }
+
+    config.encoderGlitchUs = device.encoder_glitch_us.value_or(config.encoderGlitchUs);
+    if (config.encoderGlitchUs < 0) {
+        errors.push_back(fmt::format("encoder_glitch_us {} is negative", config.encoderGlitchUs));
+    }
+
+    if (device.recorder_file && device.recorder_time) {
+        config.recorderFile = *device.recorder_file;
+        config.recorderTime = *device.recorder_time;
+    }
+    if (device.recorder_archive && device.recorder_archive_mb) {
+        config.recorderArchive = *device.recorder_archive;
+        config.recorderArchiveMb = *device.recorder_archive_mb;
+    }
+    if (device.snapshot_file && device.snapshot_ms) {
+        config.snapshotFile = *device.snapshot_file;
+        config.snapshotMs = *device.snapshot_ms;
+    }
+
+    int32_t pwmPeriod = device.pwm_period_ns.value_or(MotorPwmOption{}.periodNs);
+    if (!device.pwm_period_ns) {
+        ctrllog::info("initParam: no pwm period, use default {} ns", pwmPeriod);
+    }
+
+    auto addMotor = [&](std::string_view name, const PortParam& port, const IrParam& ir, const ChannelParam& channel) {
+        MotorConfig motor;
+        if (!port || (port->size() != 2)) {
+            errors.push_back(fmt::format("{}.{} needs two output pins", deviceName, name));
+            return;
+        }
+        motor.port = *port;
+        if (ir) {
+            motor.port.push_back(*ir);
+        } else {
+            ctrllog::warn("create motor with port {},{}", motor.port[0], motor.port[1]);
+        }
+
+        // optional kernel pwm channel [chip, channel] on the bridge enable input
+        if (channel && (channel->size() == 2)) {
+            motor.pwm.chip = (*channel)[0];
+            motor.pwm.channel = (*channel)[1];
+            motor.pwm.periodNs = pwmPeriod;
+        }
+        config.motor.push_back(std::move(motor));
+    };
+
+    if (deviceName == k_deviceNameM1) {
+        M1MotorParam motor {};
+        jsonbind::bindJson(*item, motor, errors, deviceName);
+        addMotor("motor_front_left", motor.motor_front_left, motor.ir_front_left, motor.motor_front_left_pwm);
+        addMotor("motor_front_right", motor.motor_front_right, motor.ir_front_right, motor.motor_front_right_pwm);
+        if (config.motorNum == 4) {
+            addMotor("motor_back_left", motor.motor_back_left, motor.ir_back_left, motor.motor_back_left_pwm);
+            addMotor("motor_back_right", motor.motor_back_right, motor.ir_back_right, motor.motor_back_right_pwm);
+        }
+    } else if (deviceName == k_deviceNamePc) {
+        PcMotorParam motor {};
+        jsonbind::bindJson(*item, motor, errors, deviceName);
+        addMotor("motor_front", motor.motor_front, std::nullopt, motor.motor_front_pwm);
+        addMotor("motor_back", motor.motor_back, std::nullopt, motor.motor_back_pwm);
+        if (motor.steer) {
+            config.steer = *motor.steer;
+        } else {
+            ctrllog::warn("no steer parameter...");
+        }
+    }
+
+    // pwm table in order of levels, members of PwmParam are the level names
+    size_t level = 0;
+    auto pwmItem = item->find("pwm");
+    std::apply([&](auto&... pwm) { (config.pwmTable.push_back(std::move(pwm)), ...); },
+               ylt::reflection::object_to_tuple(device.pwm));
+    for (const auto& pwm : config.pwmTable) {
+        auto name = std::string(k_pwmLevelNames[level++]);
+        if ((pwmItem == item->end()) || !pwmItem->is_object() || !pwmItem->contains(name)) {
+            // missing level is reported by bind already
+            continue;
+        } else if (static_cast<int32_t>(pwm.size()) < config.motorNum) {
+            errors.push_back(fmt::format("pwm.{} has {} values for {} motors", name, pwm.size(), config.motorNum));
+        } else if (std::any_of(pwm.begin(), pwm.end(), [](int32_t val) { return (val < 0) || (val > Motor::getMaxPwm()); })) {
+            errors.push_back(fmt::format("pwm.{} {} is out of 0-{}", name, pwm, Motor::getMaxPwm()));
+        }
+    }
+
+    if (errors.size() != errorNum) {
+        return false;
+    }
+    if (useCache) {
+        writeConfigCache(fileName, key, config);
+    }
+    return true;
+}
+
+std::vector<std::string> diffHardware(const SpeedConfig& oldConfig, const SpeedConfig& newConfig)
+{
+    std::vector<std::string> changed;
+
+    if (oldConfig.chassis != newConfig.chassis) {
+        changed.push_back(fmt::format("chassis {} -> {}", k_chassisNames[static_cast<int32_t>(oldConfig.chassis)],
+                                      k_chassisNames[static_cast<int32_t>(newConfig.chassis)]));
+    }
+    if (oldConfig.motorNum != newConfig.motorNum) {
+        changed.push_back(fmt::format("motor_num {} -> {}", oldConfig.motorNum, newConfig.motorNum));
+    }
+    for (size_t i = 0; (i < oldConfig.motor.size()) && (i < newConfig.motor.size()); i++) {
+        const auto& oldMotor = oldConfig.motor[i];
+        const auto& newMotor = newConfig.motor[i];
+        if (oldMotor.port != newMotor.port) {
+            changed.push_back(fmt::format("motor {} pins {} -> {}", i + 1, oldMotor.port, newMotor.port));
+        }
+        if (!(oldMotor.pwm == newMotor.pwm)) {
+            changed.push_back(fmt::format("motor {} pwm channel {}/{} {} ns -> {}/{} {} ns", i + 1,
+                                          oldMotor.pwm.chip, oldMotor.pwm.channel, oldMotor.pwm.periodNs,
+                                          newMotor.pwm.chip, newMotor.pwm.channel, newMotor.pwm.periodNs));
+        }
+    }
+    if (oldConfig.steer != newConfig.steer) {
+        changed.push_back(fmt::format("steer pins {} -> {}", oldConfig.steer, newConfig.steer));
+    }
+    return changed;
+}
@@ -0,0 +1,152 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <algorithm>
+#include <xapi/easylog.hpp>
+#include "stall_detector.hpp"
+
+namespace {
+
+bool isDriven(Motor& motor)
+{
+    return motor.hasEncoder() && (motor.getRunState() != MotorState::Stop) && (motor.getRunPwm() > 0);
+}
+
+}  // namespace
+
+template <size_t N>
+StallDetector::Action StallDetector::tick(std::span<Motor, N> motor, int64_t now)
+{
+    static_assert(N <= MOTOR_NUM_MAX);
+    constexpr int32_t motorNum = N;
+    Action action = Action::None;
+
+    auto startWindow = [&]() {
+        m_windowStart = now;
+        for (int32_t i = 0; i < motorNum; i++) {
+            m_wheel[i].lastCount = motor[i].getEncoderCount();
+            m_wheel[i].driven = isDriven(motor[i]);
+        }
+    };
+    if (m_windowStart < 0) {
+        startWindow();
+        return action;
+    }
+
+    // a stopped wheel loses its boost, it starts again from run pwm
+    bool enable = m_enable.load(std::memory_order_relaxed);
+    for (int32_t i = 0; i < motorNum; i++) {
+        if (enable && isDriven(motor[i])) {
+            continue;
+        }
+        m_wheel[i].driven = false;
+        m_wheel[i].fault.store(WHEEL_FAULT_NONE, std::memory_order_relaxed);
+        m_wheel[i].episode = WHEEL_FAULT_NONE;
+        m_wheel[i].clean = 0;
+        m_wheel[i].keepBoost = false;
+        if (motor[i].getPwmBoost()) {
+            motor[i].setPwmBoost(0);
+            action = Action::Rebuild;
+        }
+    }
+
+    int32_t windowUs = m_option.windowMs * 1000;
+    if (enable && (now - m_windowStart >= windowUs)) {
+        action = std::max(action, check(motor, static_cast<int32_t>(now - m_windowStart)));
+        startWindow();
+    }
+    return action;
+}
+
+template <size_t N>
+StallDetector::Action StallDetector::check(std::span<Motor, N> motor, int32_t windowUs)
+{
+    constexpr int32_t motorNum = N;
+    Action action = Action::None;
+    int32_t fault[MOTOR_NUM_MAX] {};
+    double rate[MOTOR_NUM_MAX] {};
+
+    for (int32_t i = 0; i < motorNum; i++) {
+        rate[i] = (motor[i].getEncoderCount() - m_wheel[i].lastCount) * 1000000.0 / windowUs;
+        m_wheel[i].rate.store(static_cast<int32_t>(rate[i]), std::memory_order_relaxed);
+        if (m_wheel[i].driven && (rate[i] < m_option.minRate)) {
+            fault[i] = WHEEL_FAULT_STALL;
+        }
+    }
+
+    // rate per pwm, so wheels at different pwm (turns, mecanum) compare
+    for (int32_t i = 0; (m_option.slipRatio > 0) && (i < motorNum); i++) {
+        if (!m_wheel[i].driven || fault[i]) {
+            continue;
+        }
+        double others[MOTOR_NUM_MAX];
+        int32_t otherNum = 0;
+        for (int32_t j = 0; j < motorNum; j++) {
+            if ((j != i) && m_wheel[j].driven && !fault[j]) {
+                others[otherNum++] = rate[j] / motor[j].getDrivePwm();
+            }
+        }
+        if (!otherNum) {
+            continue;
+        }
+        std::nth_element(others, others + otherNum / 2, others + otherNum);
+        double median = others[otherNum / 2];
+        if ((median > 0) && (rate[i] / motor[i].getDrivePwm() > m_option.slipRatio * median)) {
+            fault[i] = WHEEL_FAULT_SLIP;
+        }
+    }
+
+    for (int32_t i = 0; i < motorNum; i++) {
+        auto& wheel = m_wheel[i];
+        wheel.fault.store(fault[i], std::memory_order_relaxed);
+        if (!fault[i]) {
+            // keep the boost for holdWindows clean windows, a wheel that only turns with it would
+            // stall again at once. the episode ends after holdWindows clean windows without boost
+            wheel.clean++;
+            if (motor[i].getPwmBoost() != 0) {
+                if (!wheel.keepBoost && (wheel.clean >= m_option.holdWindows)) {
+                    ctrllog::info("motor {}: recovered, boost {} removed", i + 1, motor[i].getPwmBoost());
+                    motor[i].setPwmBoost(0);
+                    wheel.clean = 0;
+                    action = std::max(action, Action::Rebuild);
+                }
+            } else if (wheel.clean >= m_option.holdWindows) {
+                wheel.episode = WHEEL_FAULT_NONE;
+            }
+            continue;
+        }
+
+        // a fault inside the episode is the same stall or slip, it is counted once
+        bool stall = (fault[i] == WHEEL_FAULT_STALL);
+        bool again = (wheel.episode == fault[i]);
+        wheel.clean = 0;
+        if (!again) {
+            wheel.episode = fault[i];
+            (stall ? wheel.stalls : wheel.slips).fetch_add(1, std::memory_order_relaxed);
+            ctrllog::warn("motor {}: {} at {} edges/s, pwm {}", i + 1, stall ? "stall" : "slip",
+                          wheel.rate.load(std::memory_order_relaxed), motor[i].getDrivePwm());
+        }
+
+        if (m_option.response == "stop") {
+            action = Action::Stop;
+        } else if (m_option.response == "boost") {
+            if (stall && (motor[i].getPwmBoost() > 0)) {
+                ctrllog::warn("motor {}: still stalled with boost {}", i + 1, motor[i].getPwmBoost());
+                action = Action::Stop;
+            } else if (stall || (motor[i].getPwmBoost() == 0)) {
+                // fault came back after the boost was removed, the wheel needs it until it stops
+                if (again && !wheel.keepBoost) {
+                    ctrllog::info("motor {}: {} again without boost, boost kept", i + 1, stall ? "stall" : "slip");
+                    wheel.keepBoost = true;
+                }
+                motor[i].setPwmBoost(stall ? m_option.boostPwm : -m_option.boostPwm);
+                action = std::max(action, Action::Rebuild);
+            }
+        }
+    }
+    return action;
+}
+
+template StallDetector::Action StallDetector::tick<0>(std::span<Motor, 0> motor, int64_t now);
+template StallDetector::Action StallDetector::tick<1>(std::span<Motor, 1> motor, int64_t now);
+template StallDetector::Action StallDetector::tick<2>(std::span<Motor, 2> motor, int64_t now);
+template StallDetector::Action StallDetector::tick<3>(std::span<Motor, 3> motor, int64_t now);
+template StallDetector::Action StallDetector::tick<4>(std::span<Motor, 4> motor, int64_t now);
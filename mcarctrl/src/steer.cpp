@@ -3,14 +3,14 @@
 #include <xapi/easylog.hpp>
 #include "steer.hpp"
 
-Steer::Steer(asio::io_context& context, std::vector<uint32_t> port) :
+Steer::Steer(asio::io_context& context, std::vector<uint32_t> port, SimBackend* sim) :
     m_steerTimer(context, [&](const asio::error_code &e, void *ctxt) {
         m_outputGpio[0]->setValue(0);
         m_outputGpio[1]->setValue(0);
     }, nullptr, false)
 {
-    m_outputGpio[0] = new Gpio(port.at(0), GPIO_DIR_OUT, GPIO_EDGE_NONE);
-    m_outputGpio[1] = new Gpio(port.at(1), GPIO_DIR_OUT, GPIO_EDGE_NONE);
+    m_outputGpio[0] = new Gpio(port.at(0), GPIO_DIR_OUT, GPIO_EDGE_NONE, sim);
+    m_outputGpio[1] = new Gpio(port.at(1), GPIO_DIR_OUT, GPIO_EDGE_NONE, sim);
     if ((m_outputGpio[0] == nullptr) || (m_outputGpio[1] == nullptr)) {
         ctrllog::error("fail to create motor from output gpio {},{}", port.at(0), port.at(1));
     }
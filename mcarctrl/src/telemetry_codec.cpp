@@ -0,0 +1,222 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <algorithm>
+#include <cstring>
+#include <ylt/struct_pack.hpp>
+#include "checksum.hpp"
+#include "telemetry_codec.hpp"
+
+namespace {
+
+// writer of the struct_pack varint coder, appends to a string
+struct StringWriter
+{
+    std::string& out;
+
+    void write(const char* data, size_t size) { out.append(data, size); }
+};
+
+void putVarint(std::string& out, uint64_t value)
+{
+    StringWriter writer {out};
+    struct_pack::detail::serialize_varint(writer, value);
+}
+
+void putSigned(std::string& out, int64_t value)
+{
+    putVarint(out, struct_pack::detail::encode_zigzag(value));
+}
+
+// payload reader, a short or bad payload clears ok and reads zeros
+struct Reader
+{
+    struct_pack::detail::memory_reader mem;
+    bool ok {true};
+
+    uint64_t varint()
+    {
+        uint64_t value = 0;
+        if (struct_pack::detail::deserialize_varint_impl(mem, value)) {
+            ok = false;
+            return 0;
+        }
+        return value;
+    }
+
+    int64_t sign() { return struct_pack::detail::decode_zigzag<int64_t>(varint()); }
+};
+
+// column of a field: each value as delta to the one before, base before first
+template<typename Get>
+void putDelta(std::string& out, size_t count, int64_t base, Get get)
+{
+    for (size_t i = 0; i < count; i++) {
+        int64_t value = get(i);
+        putSigned(out, value - base);
+        base = value;
+    }
+}
+
+template<typename Set>
+void getDelta(Reader& in, size_t count, int64_t base, Set set)
+{
+    for (size_t i = 0; (i < count) && in.ok; i++) {
+        base += in.sign();
+        set(i, base);
+    }
+}
+
+// column of a field that rarely changes: runs of (value, length)
+template<typename Get>
+void putRuns(std::string& out, size_t count, Get get)
+{
+    for (size_t i = 0; i < count;) {
+        int64_t value = get(i);
+        size_t end = i + 1;
+        while ((end < count) && (get(end) == value)) {
+            end++;
+        }
+        putSigned(out, value);
+        putVarint(out, end - i);
+        i = end;
+    }
+}
+
+template<typename Set>
+void getRuns(Reader& in, size_t count, Set set)
+{
+    for (size_t i = 0; (i < count) && in.ok;) {
+        int64_t value = in.sign();
+        uint64_t run = in.varint();
+        if (!run || (run > count - i)) {
+            in.ok = false;
+            return;
+        }
+        for (uint64_t k = 0; k < run; k++) {
+            set(i++, value);
+        }
+    }
+}
+
+void encodeBlock(std::span<const FlightRecord> rec, std::string& out)
+{
+    const size_t count = rec.size();
+    const size_t start = out.size();
+    out.resize(start + sizeof(TelemetryBlockHeader));
+
+    // seq steps by one unless a torn record was dropped
+    putRuns(out, count, [&](size_t i) { return i ? (int64_t)(rec[i].seq - rec[i - 1].seq) : 0; });
+    putDelta(out, count, rec[0].timestamp, [&](size_t i) { return (int64_t)rec[i].timestamp; });
+    putRuns(out, count, [&](size_t i) { return (int64_t)rec[i].ctrlMode; });
+    putRuns(out, count, [&](size_t i) { return (int64_t)rec[i].motorNum; });
+    for (int32_t m = 0; m < k_flightRecMotors; m++) {
+        putRuns(out, count, [&](size_t i) { return (int64_t)rec[i].motor[m].runState; });
+        putRuns(out, count, [&](size_t i) { return (int64_t)rec[i].motor[m].nowState; });
+        putDelta(out, count, 0, [&](size_t i) { return (int64_t)rec[i].motor[m].pwmCount; });
+        putRuns(out, count, [&](size_t i) { return (int64_t)rec[i].motor[m].runPwm; });
+        putDelta(out, count, 0, [&](size_t i) { return (int64_t)rec[i].motor[m].encoder; });
+        putDelta(out, count, 0, [&](size_t i) { return (int64_t)rec[i].motor[m].actualSteps; });
+    }
+
+    TelemetryBlockHeader header {};
+    header.magic = k_telemetryBlockMagic;
+    header.version = k_telemetryVersion;
+    header.count = static_cast<uint16_t>(count);
+    header.length = static_cast<uint32_t>(out.size() - start - sizeof(header));
+    header.checksum = fnv1a(out.data() + start + sizeof(header), header.length);
+    header.firstSeq = rec[0].seq;
+    header.firstTimestamp = rec[0].timestamp;
+    std::memcpy(out.data() + start, &header, sizeof(header));
+}
+
+bool getBlockHeader(std::string_view data, TelemetryBlockHeader& header)
+{
+    if (data.size() < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    return (header.magic == k_telemetryBlockMagic) && (header.version == k_telemetryVersion)
+        && header.count && (header.count <= k_telemetryBlockRecords)
+        && (header.length <= data.size() - sizeof(header));
+}
+
+}  // namespace
+
+void TelemetryCodec::putFileHeader(std::string& out, uint32_t tickUs, uint64_t realtimeUs, uint64_t steadyUs)
+{
+    TelemetryFileHeader header {};
+    header.magic = k_telemetryFileMagic;
+    header.version = k_telemetryVersion;
+    header.tickUs = tickUs;
+    header.realtimeUs = realtimeUs;
+    header.steadyUs = steadyUs;
+    out.append(reinterpret_cast<const char*>(&header), sizeof(header));
+}
+
+bool TelemetryCodec::getFileHeader(std::string_view data, TelemetryFileHeader& header)
+{
+    if (data.size() < sizeof(header)) {
+        return false;
+    }
+    std::memcpy(&header, data.data(), sizeof(header));
+    return (header.magic == k_telemetryFileMagic) && (header.version == k_telemetryVersion);
+}
+
+size_t TelemetryCodec::encode(std::span<const FlightRecord> records, std::string& out)
+{
+    const size_t start = out.size();
+    for (size_t i = 0; i < records.size(); i += k_telemetryBlockRecords) {
+        encodeBlock(records.subspan(i, std::min<size_t>(k_telemetryBlockRecords, records.size() - i)), out);
+    }
+    return out.size() - start;
+}
+
+size_t TelemetryCodec::decode(std::string_view data, std::vector<FlightRecord>& records)
+{
+    TelemetryBlockHeader header;
+    if (!getBlockHeader(data, header)
+        || (fnv1a(data.data() + sizeof(header), header.length) != header.checksum)) {
+        return 0;
+    }
+
+    const size_t count = header.count;
+    const size_t first = records.size();
+    records.resize(first + count, FlightRecord{});
+    FlightRecord* rec = records.data() + first;
+    const char* payload = data.data() + sizeof(header);
+    Reader in {{payload, payload + header.length}};
+
+    getRuns(in, count, [&](size_t i, int64_t v) { rec[i].seq = v; });
+    rec[0].seq = header.firstSeq;
+    for (size_t i = 1; i < count; i++) {
+        rec[i].seq += rec[i - 1].seq;
+    }
+    getDelta(in, count, header.firstTimestamp, [&](size_t i, int64_t v) { rec[i].timestamp = v; });
+    getRuns(in, count, [&](size_t i, int64_t v) { rec[i].ctrlMode = static_cast<uint8_t>(v); });
+    getRuns(in, count, [&](size_t i, int64_t v) { rec[i].motorNum = static_cast<uint8_t>(v); });
+    for (int32_t m = 0; m < k_flightRecMotors; m++) {
+        getRuns(in, count, [&](size_t i, int64_t v) { rec[i].motor[m].runState = static_cast<int8_t>(v); });
+        getRuns(in, count, [&](size_t i, int64_t v) { rec[i].motor[m].nowState = static_cast<int8_t>(v); });
+        getDelta(in, count, 0, [&](size_t i, int64_t v) { rec[i].motor[m].pwmCount = static_cast<uint8_t>(v); });
+        getRuns(in, count, [&](size_t i, int64_t v) { rec[i].motor[m].runPwm = static_cast<uint8_t>(v); });
+        getDelta(in, count, 0, [&](size_t i, int64_t v) { rec[i].motor[m].encoder = static_cast<uint32_t>(v); });
+        getDelta(in, count, 0, [&](size_t i, int64_t v) { rec[i].motor[m].actualSteps = static_cast<int32_t>(v); });
+    }
+
+    if (!in.ok || (in.mem.now != in.mem.end)) {
+        records.resize(first);
+        return 0;
+    }
+    return sizeof(header) + header.length;
+}
+
+std::vector<TelemetryBlockIndex> TelemetryCodec::index(std::string_view data)
+{
+    std::vector<TelemetryBlockIndex> blocks;
+    size_t offset = sizeof(TelemetryFileHeader);
+    TelemetryBlockHeader header;
+    while ((offset < data.size()) && getBlockHeader(data.substr(offset), header)) {
+        blocks.push_back({header.firstSeq, header.firstTimestamp, header.count, offset});
+        offset += sizeof(header) + header.length;
+    }
+    return blocks;
+}
@@ -0,0 +1,163 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <algorithm>
+#include <limits>
+#include "telemetry_history.hpp"
+
+namespace {
+
+constexpr int32_t k_speedFirst = static_cast<int32_t>(HistoryMetric::Speed) * MOTOR_NUM_MAX;
+constexpr int32_t k_speedLast  = k_speedFirst + MOTOR_NUM_MAX;
+
+}  // namespace
+
+TelemetryHistory::TelemetryHistory()
+{
+    for (int32_t i = 0; i < k_levels; i++) {
+        m_level[i].rows = std::make_unique<HistoryRow[]>(k_levelRows[i]);
+    }
+}
+
+void TelemetryHistory::openBucket(Level& level, int64_t start)
+{
+    level.openStart = start;
+    level.count = 0;
+    level.min.fill(std::numeric_limits<int32_t>::max());
+    level.max.fill(std::numeric_limits<int32_t>::min());
+    level.sum.fill(0);
+}
+
+void TelemetryHistory::append(int64_t now, const HistorySample& sample)
+{
+    Level& level = m_level[0];
+    int64_t start = now - now % k_levelUs[0];
+    if (level.count && (start != level.openStart)) {
+        closeBucket(0);
+    }
+    if (!level.count) {
+        openBucket(level, start);
+    }
+
+    for (int32_t s = 0; s < k_historySeries; s++) {
+        int32_t value = sample.value[s];
+        if ((s >= k_speedFirst) && (s < k_speedLast)) {
+            m_lastCount[s] = value;
+            continue;
+        }
+        level.min[s] = std::min(level.min[s], value);
+        level.max[s] = std::max(level.max[s], value);
+        level.sum[s] += value;
+    }
+    level.count++;
+}
+
+void TelemetryHistory::closeBucket(int32_t index)
+{
+    Level& level = m_level[index];
+    HistoryRow row;
+    row.timeUs = level.openStart;
+    row.count = level.count;
+    for (int32_t s = 0; s < k_historySeries; s++) {
+        row.stat[s] = {level.min[s], level.max[s], static_cast<int32_t>(level.sum[s] / level.count)};
+    }
+
+    if (index == 0) {
+        // edges since end of the bucket before, over the time since then, so a
+        // gap of missed ticks does not count as a speed peak
+        int64_t end = level.openStart + k_levelUs[0];
+        for (int32_t s = k_speedFirst; s < k_speedLast; s++) {
+            int32_t rate = 0;
+            if (m_baseTime >= 0) {
+                uint32_t edges = static_cast<uint32_t>(m_lastCount[s]) - static_cast<uint32_t>(m_baseCount[s]);
+                rate = static_cast<int32_t>((int64_t)edges * 1000000 / (end - m_baseTime));
+            }
+            row.stat[s] = {rate, rate, rate};
+            m_baseCount[s] = m_lastCount[s];
+        }
+        m_baseTime = end;
+    }
+
+    level.count = 0;
+    addRow(index, row);
+}
+
+void TelemetryHistory::addRow(int32_t index, const HistoryRow& row)
+{
+    Level& level = m_level[index];
+    uint64_t seq = level.writeSeq.load(std::memory_order_relaxed);
+    level.rows[seq % k_levelRows[index]] = row;
+    level.writeSeq.store(seq + 1, std::memory_order_release);
+
+    if (index + 1 == k_levels) {
+        return;
+    }
+
+    // fold into the bucket above, mean of means of equal width buckets
+    Level& upper = m_level[index + 1];
+    int64_t start = row.timeUs - row.timeUs % k_levelUs[index + 1];
+    if (upper.count && (start != upper.openStart)) {
+        closeBucket(index + 1);
+    }
+    if (!upper.count) {
+        openBucket(upper, start);
+    }
+    for (int32_t s = 0; s < k_historySeries; s++) {
+        upper.min[s] = std::min(upper.min[s], row.stat[s].min);
+        upper.max[s] = std::max(upper.max[s], row.stat[s].max);
+        upper.sum[s] += row.stat[s].mean;
+    }
+    upper.count++;
+}
+
+int32_t TelemetryHistory::selectLevel(int64_t fromUs, int64_t toUs, int64_t resolutionUs, int64_t now)
+{
+    // finest level wide enough, with few enough points and long enough history
+    for (int32_t i = 0; i < k_levels - 1; i++) {
+        if ((k_levelUs[i] >= resolutionUs)
+            && ((toUs - fromUs) / k_levelUs[i] <= k_maxPoints)
+            && (fromUs >= now - k_levelUs[i] * k_levelRows[i])) {
+            return i;
+        }
+    }
+    return k_levels - 1;
+}
+
+int64_t TelemetryHistory::query(int64_t fromUs, int64_t toUs, int64_t resolutionUs, int64_t now,
+                                std::vector<HistoryRow>& rows)
+{
+    int32_t index = selectLevel(fromUs, toUs, resolutionUs, now);
+    Level& level = m_level[index];
+    uint64_t capacity = k_levelRows[index];
+    rows.clear();
+
+    uint64_t last = level.writeSeq.load(std::memory_order_acquire);
+    uint64_t first = (last > capacity) ? last - capacity : 0;
+
+    // rows are in time order, binary search first bucket ending after fromUs
+    uint64_t lo = first, hi = last;
+    while (lo < hi) {
+        uint64_t mid = lo + (hi - lo) / 2;
+        if (level.rows[mid % capacity].timeUs + k_levelUs[index] <= fromUs) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    uint64_t seq = lo;
+    for (; (seq < last) && (rows.size() < static_cast<size_t>(k_maxPoints)); seq++) {
+        const HistoryRow& row = level.rows[seq % capacity];
+        if (row.timeUs > toUs) {
+            break;
+        }
+        rows.push_back(row);
+    }
+
+    // the writer may have reused slots while copying, drop those rows
+    std::atomic_thread_fence(std::memory_order_acquire);
+    uint64_t written = level.writeSeq.load(std::memory_order_relaxed);
+    if (written + 1 > capacity + lo) {
+        size_t stale = std::min<size_t>(rows.size(), written + 1 - capacity - lo);
+        rows.erase(rows.begin(), rows.begin() + stale);
+    }
+    return k_levelUs[index];
+}
@@ -0,0 +1,259 @@
+// SPDX-License-Identifier: GPL-2.0
+// rpc load generator for cars of carsim or real agvctrl. each connection
+// sends a mix of status polls, keep-alive and drive commands as a remote
+// control client does, then throughput and latency per kind are reported.
+//
+// with a rate, a connection sends at fixed times and latency counts from the
+// planned send time, so a slow server is not hidden by a waiting client.
+//
+//   carload -n cars [-s host] [-b base_port] [-c conns_per_car] [-d seconds]
+//           [-r calls_per_s_per_conn] [-w poll,keepalive,command]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+#include <xapi/easylog.hpp>
+#include <ylt/coro_rpc/coro_rpc_client.hpp>
+#include <rpc_service.hpp>
+
+namespace {
+
+enum CallKind : int32_t {
+    KindPoll,
+    KindKeepAlive,
+    KindCommand,
+    KindNum
+};
+const char* k_kindNames[KindNum] = {"poll", "keepalive", "command"};
+
+struct LoadOption
+{
+    std::string host {"127.0.0.1"};
+    int32_t basePort {rpc_port + 1000};
+    int32_t carNum {0};
+    int32_t connNum {1};
+    int32_t seconds {10};
+    int32_t rate {0};                               // per connection, 0: next call at once
+    int32_t weight[KindNum] {70, 15, 15};
+};
+
+struct ConnResult
+{
+    std::vector<int32_t> latency[KindNum];         // us
+    uint64_t errors[KindNum] {};
+    bool connected {false};
+};
+
+void print_usage(const char* name)
+{
+    std::fprintf(stderr, "usage: %s -n cars [-s host] [-b base_port] [-c conns_per_car] [-d seconds]\n"
+                         "       [-r calls_per_s_per_conn] [-w poll,keepalive,command]\n", name);
+}
+
+template<auto func, typename... Args>
+bool call(coro_rpc::coro_rpc_client& client, Args... args)
+{
+    auto ret = syncAwait(client.call<func>(args...));
+    return ret.has_value();
+}
+
+// one call of kind, false on rpc error
+bool run_call(coro_rpc::coro_rpc_client& client, CallKind kind, std::mt19937& rng)
+{
+    int32_t pick = static_cast<int32_t>(rng() % 100);
+    switch (kind) {
+    case KindPoll:
+        // a status page polls steps often, encoder and mode now and then
+        if (pick < 60) {
+            return call<getActualSteps>(client, static_cast<int32_t>(rng() % 4) + 1);
+        } else if (pick < 80) {
+            return call<getMotorSpeedLevel>(client);
+        } else if (pick < 90) {
+            return call<getCtrlMode>(client);
+        }
+        return call<getEncoderState>(client);
+    case KindKeepAlive:
+        return call<keepAlive>(client);
+    default:
+        if (pick < 50) {
+            return call<setCarMoving>(client, static_cast<CarDirection>(rng() % 5 + 1));
+        } else if (pick < 70) {
+            return call<setMotorSpeedLevel>(client, static_cast<int32_t>(rng() % 9) + 1);
+        } else if (pick < 90) {
+            return call<setCarSteps>(client, static_cast<CarDirection>(rng() % 5 + 1), 200);
+        }
+        return call<setAllMotorState>(client, 0);
+    }
+}
+
+void run_conn(const LoadOption& option, int32_t car, int32_t seed, ConnResult& result)
+{
+    coro_rpc::coro_rpc_client client;
+    auto ec = syncAwait(client.connect(option.host, std::to_string(option.basePort + car)));
+    if (ec) {
+        std::fprintf(stderr, "[carload] car %d: fail to connect %s:%d\n", car, option.host.c_str(),
+                     option.basePort + car);
+        return;
+    }
+    result.connected = true;
+
+    std::mt19937 rng(seed);
+    int32_t total = option.weight[KindPoll] + option.weight[KindKeepAlive] + option.weight[KindCommand];
+    auto start = std::chrono::steady_clock::now();
+    auto end = start + std::chrono::seconds(option.seconds);
+    auto interval = std::chrono::nanoseconds(option.rate ? 1000000000 / option.rate : 0);
+    auto planned = start;
+
+    while (true) {
+        auto now = std::chrono::steady_clock::now();
+        if (now >= end) {
+            break;
+        }
+        if (option.rate) {
+            std::this_thread::sleep_until(planned);
+        } else {
+            planned = now;
+        }
+
+        int32_t pick = static_cast<int32_t>(rng() % total);
+        CallKind kind = KindCommand;
+        if (pick < option.weight[KindPoll]) {
+            kind = KindPoll;
+        } else if (pick < option.weight[KindPoll] + option.weight[KindKeepAlive]) {
+            kind = KindKeepAlive;
+        }
+
+        bool ok = run_call(client, kind, rng);
+        auto done = std::chrono::steady_clock::now();
+        if (!ok) {
+            result.errors[kind]++;
+        }
+        result.latency[kind].push_back(static_cast<int32_t>(
+            std::chrono::duration_cast<std::chrono::microseconds>(done - planned).count()));
+        planned += interval;
+    }
+
+    // leave the car standing
+    call<setAllMotorState>(client, 0);
+}
+
+int32_t percentile(const std::vector<int32_t>& sorted, double p)
+{
+    if (sorted.empty()) {
+        return 0;
+    }
+    size_t index = static_cast<size_t>(p * (sorted.size() - 1));
+    return sorted[index];
+}
+
+void print_row(const char* name, std::vector<int32_t>& latency, uint64_t errors, int32_t seconds)
+{
+    std::sort(latency.begin(), latency.end());
+    std::printf("%-10s %10zu %8llu %10.0f %8d %8d %8d %8d %8d\n", name, latency.size(), (unsigned long long)errors,
+                (double)latency.size() / seconds, percentile(latency, 0.5), percentile(latency, 0.9),
+                percentile(latency, 0.99), percentile(latency, 0.999), latency.empty() ? 0 : latency.back());
+}
+
+bool parse_weight(const char* text, int32_t weight[KindNum])
+{
+    return (std::sscanf(text, "%d,%d,%d", &weight[KindPoll], &weight[KindKeepAlive], &weight[KindCommand]) == 3)
+        && (weight[KindPoll] >= 0) && (weight[KindKeepAlive] >= 0) && (weight[KindCommand] >= 0)
+        && (weight[KindPoll] + weight[KindKeepAlive] + weight[KindCommand] > 0);
+}
+
+int run_main(int argc, char** argv)
+{
+    LoadOption option;
+
+    int c;
+    while ((c = getopt(argc, argv, "n:s:b:c:d:r:w:h")) != -1) {
+        switch (c) {
+        case 'n':
+            option.carNum = std::atoi(optarg);
+            break;
+        case 's':
+            option.host = optarg;
+            break;
+        case 'b':
+            option.basePort = std::atoi(optarg);
+            break;
+        case 'c':
+            option.connNum = std::max(1, std::atoi(optarg));
+            break;
+        case 'd':
+            option.seconds = std::max(1, std::atoi(optarg));
+            break;
+        case 'r':
+            option.rate = std::max(0, std::atoi(optarg));
+            break;
+        case 'w':
+            if (!parse_weight(optarg, option.weight)) {
+                print_usage(argv[0]);
+                return 1;
+            }
+            break;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (option.carNum <= 0) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    easylog_options logOption;
+    logOption.log_dir = "/tmp/";
+    logOption.log_level = spdlog::level::warn;
+    init_log(logOption);
+
+    int32_t connTotal = option.carNum * option.connNum;
+    std::vector<ConnResult> results(connTotal);
+    std::vector<std::thread> threads;
+    for (int32_t i = 0; i < connTotal; i++) {
+        threads.emplace_back(run_conn, std::cref(option), i / option.connNum, i + 1, std::ref(results[i]));
+    }
+    for (auto& thread : threads) {
+        thread.join();
+    }
+
+    int32_t connected = 0;
+    std::vector<int32_t> all;
+    uint64_t allErrors = 0;
+    std::vector<int32_t> latency[KindNum];
+    uint64_t errors[KindNum] {};
+    for (auto& result : results) {
+        connected += result.connected;
+        for (int32_t k = 0; k < KindNum; k++) {
+            latency[k].insert(latency[k].end(), result.latency[k].begin(), result.latency[k].end());
+            errors[k] += result.errors[k];
+        }
+    }
+
+    std::printf("carload: %d cars x %d conns, %d connected, %d s, rate %s\n", option.carNum, option.connNum,
+                connected, option.seconds, option.rate ? std::to_string(option.rate).c_str() : "closed loop");
+    std::printf("%-10s %10s %8s %10s %8s %8s %8s %8s %8s\n", "kind", "calls", "errors", "calls/s",
+                "p50 us", "p90 us", "p99 us", "p999 us", "max us");
+    for (int32_t k = 0; k < KindNum; k++) {
+        all.insert(all.end(), latency[k].begin(), latency[k].end());
+        allErrors += errors[k];
+        print_row(k_kindNames[k], latency[k], errors[k], option.seconds);
+    }
+    print_row("all", all, allErrors, option.seconds);
+    return (connected == connTotal) ? 0 : 2;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    return run_main(argc, argv);
+}
@@ -0,0 +1,309 @@
+// SPDX-License-Identifier: GPL-2.0
+// replay a command and encoder edge trace through CarCtrl on simulated gpio with
+// virtual clock, then compare gpio waveform and step counts with the trace.
+//
+// trace is text, one event per line, time in us from start:
+//   <time> cmd <name> [args...]    command to CarCtrl, same name as rpc
+//   <time> edge <motor>            encoder edge, motor 1~4
+//   <time> pin <pin> <value>       expected gpio output
+//   <time> steps <motor> <steps>   expected actual steps
+//   # comment
+//
+// the io context of CarCtrl never runs here, the stop timer of setRunTime runs on
+// the virtual clock instead.
+//
+// agvctrl records no commands, so traces are written by hand or by -o. flightrec
+// exports the encoder edges of a real run as a trace, its comments show run state
+// and pwm of each motor, from which the cmd lines are added.
+//
+//   carreplay -t run.trace -d nanopim1 [-p param.json] [-o golden.trace] [-j tolerance_us]
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+#include <xapi/easylog.hpp>
+#include "car_ctrl.hpp"
+
+namespace {
+
+struct TraceEvent
+{
+    int64_t time;
+    std::string kind;
+    std::string name;
+    std::vector<int32_t> args;
+};
+
+using CommandFun = std::function<void(CarCtrl&, const std::vector<int32_t>&)>;
+
+const std::map<std::string, std::pair<size_t, CommandFun>> k_commands = {
+    {"setCtrlSteps",       {2, [](CarCtrl& c, auto& a) { c.setCtrlSteps(a[0], a[1]); }}},
+    {"setCarSteps",        {2, [](CarCtrl& c, auto& a) { c.setCarSteps(static_cast<CarDirection>(a[0]), a[1]); }}},
+    {"setCarMoving",       {1, [](CarCtrl& c, auto& a) { c.setCarMoving(static_cast<CarDirection>(a[0])); }}},
+    {"setRunTime",         {1, [](CarCtrl& c, auto& a) { c.setRunTime(a[0]); }}},
+    {"setMotorSpeedLevel", {1, [](CarCtrl& c, auto& a) { c.setMotorSpeedLevel(a[0]); }}},
+    {"setMotorPwm",        {2, [](CarCtrl& c, auto& a) { c.setMotorPwm(a[0], a[1]); }}},
+    {"setAllMotorState",   {1, [](CarCtrl& c, auto& a) { c.setAllMotorState(a[0]); }}},
+    {"keepAlive",          {0, [](CarCtrl& c, auto& a) { c.keepAlive(); }}},
+};
+
+void print_usage(const char* name)
+{
+    std::fprintf(stderr, "usage: %s -t trace -d device [-p param.json] [-o out.trace] [-j tolerance_us]\n", name);
+}
+
+bool load_trace(const std::string& fileName, std::vector<TraceEvent>& events)
+{
+    std::ifstream file(fileName);
+    if (!file.is_open()) {
+        std::fprintf(stderr, "[carreplay] fail to open %s\n", fileName.c_str());
+        return false;
+    }
+
+    std::string line;
+    int32_t lineNum = 0;
+    while (std::getline(file, line)) {
+        lineNum++;
+        if (line.empty() || line[0] == '#') {
+            continue;
+        }
+
+        std::istringstream stream(line);
+        TraceEvent event;
+        if (!(stream >> event.time >> event.kind)) {
+            std::fprintf(stderr, "[carreplay] line %d: bad event\n", lineNum);
+            return false;
+        }
+        if (event.kind == "cmd") {
+            stream >> event.name;
+            auto it = k_commands.find(event.name);
+            if (it == k_commands.end()) {
+                std::fprintf(stderr, "[carreplay] line %d: unknown command %s\n", lineNum, event.name.c_str());
+                return false;
+            }
+        }
+        int32_t value;
+        while (stream >> value) {
+            event.args.push_back(value);
+        }
+
+        size_t argNum = 0;
+        if (event.kind == "cmd") {
+            argNum = k_commands.at(event.name).first;
+        } else if (event.kind == "edge") {
+            argNum = 1;
+        } else if (event.kind == "pin" || event.kind == "steps") {
+            argNum = 2;
+        } else {
+            std::fprintf(stderr, "[carreplay] line %d: unknown event %s\n", lineNum, event.kind.c_str());
+            return false;
+        }
+        if (event.args.size() != argNum) {
+            std::fprintf(stderr, "[carreplay] line %d: need %zu arguments\n", lineNum, argNum);
+            return false;
+        }
+        events.push_back(std::move(event));
+    }
+
+    std::stable_sort(events.begin(), events.end(),
+                     [](const TraceEvent& a, const TraceEvent& b) { return a.time < b.time; });
+    return true;
+}
+
+// compare waveform pin by pin. edges must match in order and value, time within tolerance
+int32_t compare_pins(const std::vector<TraceEvent>& expected, const std::vector<SimGpioEvent>& actual,
+                     int64_t tolerance)
+{
+    std::map<int32_t, std::vector<std::pair<int64_t, int32_t>>> expectPins, actualPins;
+    for (const auto& event : expected) {
+        if (event.kind == "pin") {
+            expectPins[event.args[0]].push_back({event.time, event.args[1]});
+        }
+    }
+    if (expectPins.empty()) {
+        return 0;
+    }
+    for (const auto& event : actual) {
+        actualPins[event.pin].push_back({event.time, event.value});
+    }
+
+    int32_t mismatch = 0;
+    for (const auto& [pin, expect] : expectPins) {
+        const auto& act = actualPins[pin];
+        size_t count = std::max(expect.size(), act.size());
+        for (size_t i = 0; i < count; i++) {
+            if ((i >= expect.size()) || (i >= act.size())) {
+                std::printf("pin %d: edge count %zu, expected %zu\n", pin, act.size(), expect.size());
+                mismatch++;
+                break;
+            }
+            if ((expect[i].second != act[i].second) || (std::abs(expect[i].first - act[i].first) > tolerance)) {
+                std::printf("pin %d edge %zu: %lld us value %d, expected %lld us value %d\n", pin, i,
+                            (long long)act[i].first, act[i].second,
+                            (long long)expect[i].first, expect[i].second);
+                mismatch++;
+                break;
+            }
+        }
+    }
+    return mismatch;
+}
+
+int run_main(int argc, char** argv)
+{
+    std::string traceFile, outFile;
+    CarOption option;
+    int64_t tolerance = 0;
+
+    int c;
+    while ((c = getopt(argc, argv, "t:d:p:o:j:h")) != -1) {
+        switch (c) {
+        case 't':
+            traceFile = optarg;
+            break;
+        case 'd':
+            option.deviceName = optarg;
+            break;
+        case 'p':
+            option.paramFile = optarg;
+            break;
+        case 'o':
+            outFile = optarg;
+            break;
+        case 'j':
+            tolerance = std::atoll(optarg);
+            break;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if (traceFile.empty() || option.deviceName.empty()) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    std::vector<TraceEvent> events;
+    if (!load_trace(traceFile, events)) {
+        return 1;
+    }
+
+    easylog_options logOption;
+    logOption.log_dir = "/tmp/";
+    logOption.log_level = spdlog::level::warn;
+    init_log(logOption);
+
+    SimBackend sim;
+    asio::io_context context;
+    option.sim = &sim;
+    option.startThread = false;
+    CarCtrl carCtrl{context, option};
+    CarSpeed& carSpeed = carCtrl.getCarSpeed();
+    const int32_t motorNum = carCtrl.getMotorNum();
+
+    // setup writes are part of the waveform, so golden and replay see them the same way
+    const int64_t endTime = events.empty() ? 0 : events.back().time + k_speedTickUs;
+    std::vector<TraceEvent> record;
+    int32_t stepMismatch = 0;
+    int64_t ticks = 0;
+    size_t next = 0;
+    int64_t runTimeEnd = -1;    // virtual time the run time timer stops all motors
+
+    auto start = std::chrono::steady_clock::now();
+    for (int64_t now = 0; now <= endTime; now += k_speedTickUs, ticks++) {
+        sim.setTime(now);
+        if ((runTimeEnd >= 0) && (now >= runTimeEnd)) {
+            runTimeEnd = -1;
+            carCtrl.setAllMotorState(static_cast<int32_t>(MotorState::Stop));
+        }
+
+        // inputs up to now, then one control period as the speed thread
+        std::vector<const TraceEvent*> checks;
+        bool cmdApplied = false;
+        for (; (next < events.size()) && (events[next].time <= now); next++) {
+            const auto& event = events[next];
+            if (event.kind == "cmd") {
+                k_commands.at(event.name).second(carCtrl, event.args);
+                if (event.name == "setRunTime") {
+                    // seconds, as CarCtrl arms its timer. a new one replaces it
+                    runTimeEnd = event.time + std::abs(static_cast<int64_t>(event.args[0])) * 1000000;
+                }
+                record.push_back(event);
+                cmdApplied = true;
+            } else if (event.kind == "edge") {
+                if ((event.args[0] >= 1) && (event.args[0] <= motorNum)) {
+                    carSpeed.countEncoder(event.args[0] - 1);
+                }
+                record.push_back(event);
+            } else if (event.kind == "steps") {
+                checks.push_back(&event);
+            }
+        }
+        carSpeed.controlTick();
+
+        for (auto check : checks) {
+            int32_t steps = carCtrl.getActualSteps(check->args[0]);
+            if (steps != check->args[1]) {
+                std::printf("motor %d at %lld us: steps %d, expected %d\n", check->args[0],
+                            (long long)check->time, steps, check->args[1]);
+                stepMismatch++;
+            }
+        }
+        if (!outFile.empty() && cmdApplied) {
+            for (int32_t m = 1; m <= motorNum; m++) {
+                record.push_back({now, "steps", "", {m, carCtrl.getActualSteps(m)}});
+            }
+        }
+    }
+    auto wallUs = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now() - start).count();
+
+    const auto pinEvents = sim.takeEvents();
+    const int32_t pinMismatch = compare_pins(events, pinEvents, tolerance);
+
+    if (!outFile.empty()) {
+        for (int32_t m = 1; m <= motorNum; m++) {
+            record.push_back({endTime, "steps", "", {m, carCtrl.getActualSteps(m)}});
+        }
+        for (const auto& pin : pinEvents) {
+            record.push_back({pin.time, "pin", "", {pin.pin, pin.value}});
+        }
+        std::stable_sort(record.begin(), record.end(),
+                         [](const TraceEvent& a, const TraceEvent& b) { return a.time < b.time; });
+
+        std::ofstream out(outFile);
+        out << "# carreplay golden trace, device " << option.deviceName << "\n";
+        for (const auto& event : record) {
+            out << event.time << " " << event.kind;
+            if (!event.name.empty()) {
+                out << " " << event.name;
+            }
+            for (auto arg : event.args) {
+                out << " " << arg;
+            }
+            out << "\n";
+        }
+    }
+
+    std::printf("replay %lld ticks, %lld us virtual in %lld us wall (x%.1f), %zu pin edges\n",
+                (long long)ticks, (long long)endTime, (long long)wallUs,
+                wallUs ? (double)endTime / wallUs : 0.0, pinEvents.size());
+    std::printf("mismatch: pins %d, steps %d\n", pinMismatch, stepMismatch);
+    return (pinMismatch || stepMismatch) ? 2 : 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    return run_main(argc, argv);
+}
@@ -0,0 +1,172 @@
+// SPDX-License-Identifier: GPL-2.0
+// host many simulated cars in one process, each with its own rpc server, for
+// load tests of agvintf and other clients. car i listens on base port + i.
+//
+// every car runs CarCtrl on simulated gpio. one tick thread drives the control
+// loop of all cars in real time and feeds encoder edges to running motors, as
+// many edges/s as k_simEdgesPerPwm times the motor pwm.
+//
+//   carsim -n cars -d device [-p param.json] [-b base_port] [-t threads_per_car]
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+#include <xapi/easylog.hpp>
+#include <ylt/coro_rpc/coro_rpc_server.hpp>
+#include <rpc_service.hpp>
+#include "car_ctrl.hpp"
+
+namespace {
+
+constexpr int32_t k_simEdgesPerPwm = 4;
+
+std::atomic<bool> g_stop {false};
+
+struct SimCar
+{
+    SimBackend sim;
+    std::unique_ptr<coro_rpc::coro_rpc_server> server;
+    std::unique_ptr<CarCtrl> carCtrl;
+    std::array<int64_t, MOTOR_NUM_MAX> edgeRest {};     // edges * 1000000 not counted yet
+};
+
+void print_usage(const char* name)
+{
+    std::fprintf(stderr, "usage: %s -n cars -d device [-p param.json] [-b base_port] [-t threads_per_car]\n", name);
+}
+
+// encoder edges of running motors in one tick
+void sim_encoder(SimCar& car, int64_t tickUs)
+{
+    CarSpeed& carSpeed = car.carCtrl->getCarSpeed();
+    for (int32_t m = 0; m < carSpeed.getMotorNum(); m++) {
+        if (carSpeed.getMotorState(m) == MotorState::Stop) {
+            continue;
+        }
+        car.edgeRest[m] += (int64_t)carSpeed.getMotorPwm(m) * k_simEdgesPerPwm * tickUs;
+        int32_t edges = static_cast<int32_t>(car.edgeRest[m] / 1000000);
+        car.edgeRest[m] -= (int64_t)edges * 1000000;
+        if (edges > 0) {
+            carSpeed.countEncoder(m, edges);
+        }
+    }
+}
+
+int run_main(int argc, char** argv)
+{
+    CarOption option;
+    int32_t carNum = 0;
+    int32_t threadNum = 1;
+    int32_t basePort = rpc_port + 1000;
+
+    int c;
+    while ((c = getopt(argc, argv, "n:d:p:b:t:h")) != -1) {
+        switch (c) {
+        case 'n':
+            carNum = std::atoi(optarg);
+            break;
+        case 'd':
+            option.deviceName = optarg;
+            break;
+        case 'p':
+            option.paramFile = optarg;
+            break;
+        case 'b':
+            basePort = std::atoi(optarg);
+            break;
+        case 't':
+            threadNum = std::max(1, std::atoi(optarg));
+            break;
+        default:
+            print_usage(argv[0]);
+            return 1;
+        }
+    }
+    if ((carNum <= 0) || option.deviceName.empty()) {
+        print_usage(argv[0]);
+        return 1;
+    }
+
+    easylog_options logOption;
+    logOption.log_dir = "/tmp/";
+    logOption.log_level = spdlog::level::warn;
+    init_log(logOption);
+
+    std::signal(SIGINT, [](int) { g_stop.store(true); });
+    std::signal(SIGTERM, [](int) { g_stop.store(true); });
+
+    option.startThread = false;
+    std::vector<std::unique_ptr<SimCar>> cars;
+    for (int32_t i = 0; i < carNum; i++) {
+        auto car = std::make_unique<SimCar>();
+        car->sim.setLogEnable(false);
+        car->server = std::make_unique<coro_rpc::coro_rpc_server>(threadNum, basePort + i);
+        auto& pool = car->server->get_io_context_pool();
+
+        CarOption carOption = option;
+        carOption.sim = &car->sim;
+        car->carCtrl = std::make_unique<CarCtrl>(pool.get_executor()->context(), carOption);
+        rpc_register_handlers(*car->server, RpcHandlers{});
+
+        // handlers find their car through the thread, one post per io thread of the pool
+        for (size_t t = 0; t < pool.pool_size(); t++) {
+            asio::post(pool.get_executor()->get_asio_executor(),
+                       [carCtrl = car->carCtrl.get()]() { CarCtrl::bindThread(carCtrl); });
+        }
+
+        auto started = car->server->async_start();
+        if (started.hasResult()) {
+            std::fprintf(stderr, "[carsim] fail to start rpc server on port %d\n", basePort + i);
+            return 1;
+        }
+        cars.push_back(std::move(car));
+    }
+    std::printf("carsim: %d %s cars on ports %d~%d, %d io threads each\n", carNum, option.deviceName.c_str(),
+                basePort, basePort + carNum - 1, threadNum);
+
+    // control loop of all cars, virtual clock follows the steady clock
+    auto start = std::chrono::steady_clock::now();
+    int64_t next = 0;
+    int64_t ticks = 0, lateTicks = 0;
+    while (!g_stop.load()) {
+        int64_t now = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start).count();
+        for (auto& car : cars) {
+            car->sim.setTime(now);
+            sim_encoder(*car, k_speedTickUs);
+            car->carCtrl->getCarSpeed().controlTick();
+        }
+        ticks++;
+
+        next += k_speedTickUs;
+        if (now > next) {
+            // one tick for all cars takes longer than the pwm step
+            lateTicks++;
+            next = now;
+        }
+        std::this_thread::sleep_until(start + std::chrono::microseconds(next));
+    }
+
+    std::printf("carsim: %lld ticks, %lld late\n", (long long)ticks, (long long)lateTicks);
+    for (auto& car : cars) {
+        car->server->stop();
+    }
+    return 0;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    return run_main(argc, argv);
+}
@@ -0,0 +1,213 @@
+// SPDX-License-Identifier: GPL-2.0
+// decode agvctrl flight recorder ring file, or its compact archive, to csv.
+//   flightrec /var/log/agvctrl.rec > run.csv
+//   flightrec /var/log/agvctrl.agvz - 60 > last.csv   (last 60 s only)
+// an output file ending in .trace gets the encoder edges of the run as a carreplay trace
+//   flightrec /var/log/agvctrl.agvz run.trace 60
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+#include <string_view>
+#include <vector>
+
+#include "flight_recorder.hpp"
+#include "telemetry_codec.hpp"
+
+namespace {
+
+void usage()
+{
+    std::fprintf(stderr, "usage: flightrec <record or archive file> [csv file, trace file or -] [last seconds]\n");
+}
+
+bool load_file(const char* name, std::vector<char>& data)
+{
+    std::ifstream file(name, std::ios::binary);
+    if (!file.is_open()) {
+        return false;
+    }
+    data.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+    return true;
+}
+
+// records of ring file. slot holds a record only if checksum and slot position
+// match. after crash or power cut a slot may be torn, then it is dropped.
+bool load_ring(const char* name, const std::vector<char>& data, std::vector<FlightRecord>& records,
+               uint64_t& realtimeUs, uint64_t& steadyUs)
+{
+    FlightRecHeader header;
+    std::memcpy(static_cast<void*>(&header), data.data(), sizeof(header));
+    if ((header.magic != k_flightRecMagic) || (header.version != k_flightRecVersion)
+        || (header.recordSize != sizeof(FlightRecord))) {
+        std::fprintf(stderr, "[flightrec] %s is not a flight record v%u\n", name, k_flightRecVersion);
+        return false;
+    }
+
+    const size_t available = (data.size() - sizeof(header)) / sizeof(FlightRecord);
+    const size_t capacity = std::min<size_t>(header.capacity, available);
+
+    size_t torn = 0;
+    records.reserve(capacity);
+    for (size_t i = 0; i < capacity; i++) {
+        FlightRecord rec;
+        std::memcpy(&rec, data.data() + sizeof(header) + i * sizeof(FlightRecord), sizeof(rec));
+        if (rec.seq == 0) {
+            continue;
+        }
+        if ((rec.checksum != flightRecChecksum(rec)) || ((rec.seq - 1) % header.capacity != i)) {
+            torn++;
+            continue;
+        }
+        records.push_back(rec);
+    }
+    std::sort(records.begin(), records.end(),
+              [](const FlightRecord& a, const FlightRecord& b) { return a.seq < b.seq; });
+
+    realtimeUs = header.realtimeUs;
+    steadyUs = header.steadyUs;
+    std::fprintf(stderr, "[flightrec] %zu records, %zu torn, last seq %llu\n", records.size(), torn,
+                 (unsigned long long)header.writeSeq.load());
+    return true;
+}
+
+// records of archive file. the block index skips blocks before the last seconds
+// without decoding them, the archive of a crashed run ends at its last whole block
+bool load_archive(const char* name, const std::vector<char>& data, int32_t lastSeconds,
+                  std::vector<FlightRecord>& records, uint64_t& realtimeUs, uint64_t& steadyUs)
+{
+    std::string_view view(data.data(), data.size());
+    TelemetryFileHeader header;
+    if (!TelemetryCodec::getFileHeader(view, header)) {
+        std::fprintf(stderr, "[flightrec] %s is not a telemetry archive v%u\n", name, k_telemetryVersion);
+        return false;
+    }
+
+    auto blocks = TelemetryCodec::index(view);
+    size_t first = 0;
+    if ((lastSeconds > 0) && !blocks.empty()) {
+        uint64_t lastTime = blocks.back().firstTimestamp;
+        uint64_t from = (lastTime > (uint64_t)lastSeconds * 1000000) ? lastTime - (uint64_t)lastSeconds * 1000000 : 0;
+        auto it = std::upper_bound(blocks.begin(), blocks.end(), from,
+                                   [](uint64_t time, const TelemetryBlockIndex& block) {
+                                       return time < block.firstTimestamp;
+                                   });
+        first = (it == blocks.begin()) ? 0 : static_cast<size_t>(it - blocks.begin()) - 1;
+    }
+
+    size_t broken = 0;
+    for (size_t i = first; i < blocks.size(); i++) {
+        if (!TelemetryCodec::decode(view.substr(blocks[i].offset), records)) {
+            broken++;
+        }
+    }
+
+    realtimeUs = header.realtimeUs;
+    steadyUs = header.steadyUs;
+    std::fprintf(stderr, "[flightrec] %zu records, %zu of %zu blocks, %zu broken, %zu bytes\n", records.size(),
+                 blocks.size() - first, blocks.size(), broken, data.size());
+    return true;
+}
+
+// carreplay trace of the run, time from first record. records hold no rpc
+// commands, ctrl steps or speed level, so only the encoder edges are events.
+// run state and pwm of each motor are comments at every change, commands to
+// replay are written from them by hand
+void write_trace(FILE* out, const char* name, const std::vector<FlightRecord>& records)
+{
+    std::fprintf(out, "# carreplay trace of %s, edges from flightrec, add cmd lines before replay\n", name);
+    if (records.empty()) {
+        return;
+    }
+
+    const uint64_t start = records.front().timestamp;
+    FlightRecord last = records.front();
+    for (int32_t m = 0; m < std::min<int32_t>(last.motorNum, k_flightRecMotors); m++) {
+        std::fprintf(out, "# 0 motor %d run %d pwm %u\n", m + 1, last.motor[m].runState, last.motor[m].runPwm);
+    }
+    for (const auto& rec : records) {
+        const auto time = (unsigned long long)(rec.timestamp - start);
+        for (int32_t m = 0; m < std::min<int32_t>(rec.motorNum, k_flightRecMotors); m++) {
+            const auto& motor = rec.motor[m];
+            if ((motor.runState != last.motor[m].runState) || (motor.runPwm != last.motor[m].runPwm)) {
+                std::fprintf(out, "# %llu motor %d run %d pwm %u\n", time, m + 1, motor.runState, motor.runPwm);
+            }
+            // a counter going back (restored snapshot) adds no edges
+            for (auto edges = static_cast<int32_t>(motor.encoder - last.motor[m].encoder); edges > 0; edges--) {
+                std::fprintf(out, "%llu edge %d\n", time, m + 1);
+            }
+        }
+        last = rec;
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        usage();
+        return 1;
+    }
+
+    std::vector<char> data;
+    if (!load_file(argv[1], data) || data.size() < sizeof(FlightRecHeader)) {
+        std::fprintf(stderr, "[flightrec] fail to read %s\n", argv[1]);
+        return 1;
+    }
+
+    std::vector<FlightRecord> records;
+    uint64_t realtimeUs = 0;
+    uint64_t steadyUs = 0;
+    uint32_t magic;
+    std::memcpy(&magic, data.data(), sizeof(magic));
+    bool loaded = (magic == k_telemetryFileMagic)
+        ? load_archive(argv[1], data, (argc > 3) ? std::atoi(argv[3]) : 0, records, realtimeUs, steadyUs)
+        : load_ring(argv[1], data, records, realtimeUs, steadyUs);
+    if (!loaded) {
+        return 1;
+    }
+
+    FILE* out = stdout;
+    if ((argc > 2) && std::strcmp(argv[2], "-")) {
+        out = std::fopen(argv[2], "w");
+        if (out == nullptr) {
+            std::fprintf(stderr, "[flightrec] fail to open %s\n", argv[2]);
+            return 1;
+        }
+    }
+
+    const std::string_view outName = (argc > 2) ? argv[2] : "";
+    if (outName.ends_with(".trace")) {
+        write_trace(out, argv[1], records);
+        std::fclose(out);
+        return 0;
+    }
+
+    std::fprintf(out, "seq,time_us,wall_time_us,ctrl_mode,motor_num");
+    for (int32_t m = 1; m <= k_flightRecMotors; m++) {
+        std::fprintf(out, ",m%d_run,m%d_now,m%d_pwm_count,m%d_pwm,m%d_encoder,m%d_steps",
+                     m, m, m, m, m, m);
+    }
+    std::fprintf(out, "\n");
+
+    for (const auto& rec : records) {
+        const uint64_t wall = realtimeUs + (rec.timestamp - steadyUs);
+        std::fprintf(out, "%llu,%llu,%llu,%u,%u", (unsigned long long)rec.seq,
+                     (unsigned long long)rec.timestamp, (unsigned long long)wall,
+                     rec.ctrlMode, rec.motorNum);
+        for (const auto& motor : rec.motor) {
+            std::fprintf(out, ",%d,%d,%u,%u,%u,%d", motor.runState, motor.nowState,
+                         motor.pwmCount, motor.runPwm, motor.encoder, motor.actualSteps);
+        }
+        std::fprintf(out, "\n");
+    }
+
+    if (out != stdout) {
+        std::fclose(out);
+    }
+    return 0;
+}
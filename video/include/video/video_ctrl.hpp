@@ -1,12 +1,17 @@
 // SPDX-License-Identifier: GPL-2.0
 
 #pragma once
+#include <array>
+#include <atomic>
+#include <functional>
+#include <memory>
 #include <mutex>
 #include <vector>
 #include <opencv2/opencv.hpp>
 #include <xapi/iotimer.hpp>
 #include <xapi/cmn_thread.hpp>
 #include <video/video_device.hpp>
+#include <video/video_frame.hpp>
 #include <video/stereo_vision.hpp>
 #include <video/stereo_object_match.hpp>
 
@@ -16,7 +21,10 @@ public:
     VideoCtrl(asio::io_context& ioContext);
     virtual ~VideoCtrl();
 
-    bool getWebFrame(int32_t camera, std::vector<uint8_t>& out);
+    // newest encoded frame of camera, nullptr before the first
+    std::shared_ptr<const VideoFrame> getWebFrame(int32_t camera);
+    // called in video thread after each new web frame, keep it short. empty to remove
+    void setWebFrameListener(std::function<void(int32_t camera)> listener);
     int32_t getWebCameraCount();
     bool isCameraExist(int32_t camera);
 
@@ -35,7 +43,9 @@ private:
     int32_t        m_videoDevNum {0};
     StereoVision   m_stereoVision;
     StereoObjectMatch m_stereoObjectMatch;
-    std::mutex     m_webFrameMutex;
-    std::vector<std::vector<uint8_t>> m_webJpeg;
-    std::vector<bool> m_hasWebFrame;
+    std::shared_ptr<VideoFramePool> m_framePool;
+    std::array<std::atomic<std::shared_ptr<const VideoFrame>>, video_dev_num> m_webFrame;
+    std::array<uint64_t, video_dev_num> m_webFrameSeq {};
+    std::mutex     m_listenerMutex;
+    std::function<void(int32_t camera)> m_webFrameListener;
 };
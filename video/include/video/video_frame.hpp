@@ -0,0 +1,39 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+#include <memory>
+#include <mutex>
+#include <vector>
+#include <stdint.h>
+
+// encoded frame, immutable once published. consumers keep a handle as long
+// as they send it, no copy of data is made
+struct VideoFrame
+{
+    std::vector<uint8_t> data;          // jpeg
+    uint64_t             timestamp {0}; // steady clock us of capture
+    uint64_t             seq {0};       // per camera, from 1
+};
+
+/**
+ * @brief recycles encode buffers of frames
+ *  a frame handle returns its frame to the pool when the last consumer lets
+ *  go of it, the next encode reuses the capacity of its data. up to
+ *  k_maxFree frames are kept, more are freed.
+ */
+class VideoFramePool : public std::enable_shared_from_this<VideoFramePool>
+{
+public:
+    static constexpr size_t k_maxFree = 6;
+
+    ~VideoFramePool();
+
+    // frame to fill, from the pool or new
+    std::shared_ptr<VideoFrame> acquire();
+
+private:
+    void release(VideoFrame* frame);
+
+    std::mutex               m_mutex;
+    std::vector<VideoFrame*> m_free;
+};
@@ -1,18 +1,35 @@
 // SPDX-License-Identifier: GPL-2.0
 #include <xapi/easylog.hpp>
 #include <xapi/cmn_libfork.hpp>
+#include <xapi/metrics.hpp>
 #include <opencv2/opencv.hpp>
 #include <video/video_ctrl.hpp>
+#include <chrono>
 #include <functional>
 #include <vector>
 
+namespace {
+
+// time of each stage of the video thread
+metrics::Histogram g_captureSeconds {"agvintf_video_stage_seconds", "time of one video pipeline stage",
+                                     metrics::k_latencyBoundsUs, 1e6, "stage=\"capture\""};
+metrics::Histogram g_encodeSeconds {"agvintf_video_stage_seconds", "time of one video pipeline stage",
+                                    metrics::k_latencyBoundsUs, 1e6, "stage=\"encode\""};
+metrics::Histogram g_stereoSeconds {"agvintf_video_stage_seconds", "time of one video pipeline stage",
+                                    metrics::k_latencyBoundsUs, 1e6, "stage=\"stereo\""};
+metrics::Histogram g_edgeSeconds {"agvintf_video_stage_seconds", "time of one video pipeline stage",
+                                  metrics::k_latencyBoundsUs, 1e6, "stage=\"edge\""};
+metrics::Counter   g_webFrames[] = {
+    {"agvintf_video_web_frames_total", "jpeg frames published for the web", "camera=\"0\""},
+    {"agvintf_video_web_frames_total", "jpeg frames published for the web", "camera=\"1\""}};
+
+}  // namespace
+
 VideoCtrl::VideoCtrl(asio::io_context& ioContext):
     m_videoThread("video thread", cmn::CmnThread::ThreadPriorityNormal, videoThreadFun, this),
-    m_videoDev{nullptr, nullptr}
+    m_videoDev{nullptr, nullptr},
+    m_framePool{std::make_shared<VideoFramePool>()}
 {
-    m_webJpeg.resize(video_dev_num);
-    m_hasWebFrame.resize(video_dev_num, false);
-
     //check there is GUI backend or not
     cv::Mat img = cv::imread("lena.png");
     if (!img.empty()) {
@@ -89,7 +106,10 @@ void VideoCtrl::videoThreadFun(void *ctxt)
 
         if (hasCam0) {
             auto& videoL = obj->m_videoDev[0]->getVideoCapture();
-            videoL >> frameL;
+            {
+                metrics::ScopedTimer timer(g_captureSeconds);
+                videoL >> frameL;
+            }
             hasFrameL = !frameL.empty();
             if (hasFrameL) {
                 obj->updateWebFrame(0, frameL);
@@ -98,7 +118,10 @@ void VideoCtrl::videoThreadFun(void *ctxt)
 
         if (hasCam1) {
             auto& videoR = obj->m_videoDev[1]->getVideoCapture();
-            videoR >> frameR;
+            {
+                metrics::ScopedTimer timer(g_captureSeconds);
+                videoR >> frameR;
+            }
             hasFrameR = !frameR.empty();
             if (hasFrameR) {
                 obj->updateWebFrame(1, frameR);
@@ -113,10 +136,12 @@ void VideoCtrl::videoThreadFun(void *ctxt)
             obj->showImage("right", frameR);
 
             cv::Mat rectL, rectR;
-            obj->m_stereoVision.rectifyPair(frameL, frameR, rectL, rectR);
-
             cv::Mat disparity, depth;
-            obj->m_stereoVision.computeDisparityFromRectified(rectL, rectR, disparity, depth);
+            {
+                metrics::ScopedTimer timer(g_stereoSeconds);
+                obj->m_stereoVision.rectifyPair(frameL, frameR, rectL, rectR);
+                obj->m_stereoVision.computeDisparityFromRectified(rectL, rectR, disparity, depth);
+            }
 
             obj->m_stereoObjectMatch.tryDetectAndLog(rectL, rectR);
 
@@ -148,6 +173,7 @@ void VideoCtrl::videoThreadFun(void *ctxt)
 
         obj->showImage("capture", frame);
 
+        const auto edgeStart = std::chrono::steady_clock::now();
         cv::cvtColor(frame, gray, COLOR_BGR2GRAY); //to gray
         cv::GaussianBlur(gray, gray, Size(5, 5), 0);  //gauss filter
         obj->showImage("gray", gray);
@@ -166,6 +192,8 @@ void VideoCtrl::videoThreadFun(void *ctxt)
         for (size_t i = 0; i < lineP1.size(); i++) { //draw line
             cv::line(edge, Point(lineP1[i][0], lineP1[i][1]), Point(lineP1[i][2], lineP1[i][3]), Scalar(255), 3);
         }
+        g_edgeSeconds.observe(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - edgeStart).count());
         obj->showImage("edge", edge);
         const int32_t fpsCam = hasFrameL ? 0 : 1;
         const auto fps = obj->m_videoDev[fpsCam]->getVideoCapture().get(CAP_PROP_FPS);
@@ -182,34 +210,43 @@ void VideoCtrl::showImage(std::string title, Mat& mat)
 
 void VideoCtrl::updateWebFrame(int32_t camera, const cv::Mat& mat)
 {
-    if (mat.empty() || camera < 0 || camera >= static_cast<int32_t>(m_webJpeg.size())) {
+    if (mat.empty() || camera < 0 || camera >= video_dev_num) {
         return;
     }
 
-    std::vector<uint8_t> encoded;
-    const std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, 80};
-    if (!cv::imencode(".jpg", mat, encoded, params)) {
-        return;
+    // encode into a recycled buffer, consumers still sending older frames keep theirs
+    auto frame = m_framePool->acquire();
+    static const std::vector<int> params = {cv::IMWRITE_JPEG_QUALITY, 80};
+    {
+        metrics::ScopedTimer timer(g_encodeSeconds);
+        if (!cv::imencode(".jpg", mat, frame->data, params)) {
+            return;
+        }
+    }
+    frame->timestamp = std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+    frame->seq = ++m_webFrameSeq[camera];
+    m_webFrame[camera].store(std::move(frame));
+    g_webFrames[camera].inc();
+
+    std::lock_guard lock(m_listenerMutex);
+    if (m_webFrameListener) {
+        m_webFrameListener(camera);
     }
-
-    std::lock_guard lock(m_webFrameMutex);
-    m_webJpeg[camera] = std::move(encoded);
-    m_hasWebFrame[camera] = true;
 }
 
-bool VideoCtrl::getWebFrame(int32_t camera, std::vector<uint8_t>& out)
+void VideoCtrl::setWebFrameListener(std::function<void(int32_t camera)> listener)
 {
-    if (camera < 0 || camera >= static_cast<int32_t>(m_webJpeg.size())) {
-        return false;
-    }
+    std::lock_guard lock(m_listenerMutex);
+    m_webFrameListener = std::move(listener);
+}
 
-    std::lock_guard lock(m_webFrameMutex);
-    if (!m_hasWebFrame[camera]) {
-        return false;
+std::shared_ptr<const VideoFrame> VideoCtrl::getWebFrame(int32_t camera)
+{
+    if (camera < 0 || camera >= video_dev_num) {
+        return nullptr;
     }
-
-    out = m_webJpeg[camera];
-    return true;
+    return m_webFrame[camera].load();
 }
 
 int32_t VideoCtrl::getWebCameraCount()
@@ -0,0 +1,46 @@
+// SPDX-License-Identifier: GPL-2.0
+#include <video/video_frame.hpp>
+
+VideoFramePool::~VideoFramePool()
+{
+    for (auto frame : m_free) {
+        delete frame;
+    }
+}
+
+std::shared_ptr<VideoFrame> VideoFramePool::acquire()
+{
+    VideoFrame* frame = nullptr;
+    {
+        std::lock_guard lock(m_mutex);
+        if (!m_free.empty()) {
+            frame = m_free.back();
+            m_free.pop_back();
+        }
+    }
+    if (!frame) {
+        frame = new VideoFrame;
+    }
+
+    // a frame outliving the pool is freed
+    std::weak_ptr<VideoFramePool> pool = weak_from_this();
+    return std::shared_ptr<VideoFrame>(frame, [pool](VideoFrame* frame) {
+        if (auto owner = pool.lock()) {
+            owner->release(frame);
+        } else {
+            delete frame;
+        }
+    });
+}
+
+void VideoFramePool::release(VideoFrame* frame)
+{
+    {
+        std::lock_guard lock(m_mutex);
+        if (m_free.size() < k_maxFree) {
+            m_free.push_back(frame);
+            return;
+        }
+    }
+    delete frame;
+}
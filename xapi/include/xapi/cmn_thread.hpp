@@ -27,6 +27,16 @@ public:
     int32_t setCpuAffinity(size_t cpu_id);
     int32_t getCpuAffinity(cpu_set_t *cpuset);
 
+    // setThreadPriority keeps current policy. switch policy here: SCHED_OTHER/SCHED_FIFO/SCHED_RR
+    int32_t setSchedPolicy(int32_t policy, int32_t priority);
+
+    // real-time helpers for the calling thread, used inside thread function
+    static int32_t setSelfDeadline(uint64_t runtimeUs, uint64_t deadlineUs, uint64_t periodUs);
+    static int32_t setSelfAffinity(int32_t cpu);
+    static int32_t excludeSelfCpu(int32_t cpu);
+    static int32_t lockMemory();
+    static void    prefaultStack(size_t size);
+
     constexpr static int32_t ThreadPriorityLowest      = 1;
     constexpr static int32_t ThreadPriorityBelowNormal = 16;
     constexpr static int32_t ThreadPriorityNormal      = 32;
@@ -0,0 +1,40 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+#include <functional>
+#include <string>
+#include <asio.hpp>
+
+/**
+ * @brief watch one file with inotify on io context
+ *  the parent directory is watched, so files replaced by rename (editors,
+ *  ParamJson::saveFile) are seen as well. several writes in a short time
+ *  call the handler once.
+ */
+class IoFileWatch final
+{
+public:
+    IoFileWatch(asio::io_context& context,
+                std::function<void(const asio::error_code &e, void *ctxt)> changeHandler,
+                void *ctxt = nullptr);
+    virtual ~IoFileWatch();
+
+    bool start(const std::string& fileName);
+    void stop();
+
+    static constexpr uint64_t k_settleTime = 200;   // ms after last change
+
+private:
+    void doRead();
+
+    asio::io_context&              m_context;
+    asio::posix::stream_descriptor m_stream;
+    asio::steady_timer             m_settleTimer;
+    std::string m_dirName;
+    std::string m_baseName;
+    int32_t     m_watchFd {-1};
+    alignas(8) char m_buffer[4096];
+
+    std::function<void(const asio::error_code &e, void *ctxt)> m_changeHandler;
+    void *m_usrContext;
+};
@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <fmt/format.h>
+#include <ylt/reflection/member_ptr.hpp>
+#include <xapi/param_json.hpp>
+
+/**
+ * @brief bind json objects to structs described with YLT_REFL
+ *  member names are json keys. every member is looked up once in the object,
+ *  std::optional members may be missing, all other missing members and type
+ *  errors are collected, so one call reports every problem of a file.
+ *  YLT_REFL(Type, member...) goes at namespace scope, after the struct.
+ */
+namespace jsonbind {
+
+template <typename T>
+struct IsOptional : std::false_type {};
+
+template <typename T>
+struct IsOptional<std::optional<T>> : std::true_type {};
+
+template <typename T>
+concept Reflected = ylt::reflection::is_out_ylt_refl_v<T>;
+
+inline std::string itemPath(const std::string& path, std::string_view name)
+{
+    return path.empty() ? std::string(name) : path + "." + std::string(name);
+}
+
+/**
+ * @brief bind json item to value
+ *
+ * @param path: name of item in error messages, parent.child
+ * @param errors: every missing member and type error is appended
+ * @return false: errors added by this call
+ */
+template <typename T>
+bool bindJson(const Json& obj, T& value, std::vector<std::string>& errors, const std::string& path = "")
+{
+    size_t errorNum = errors.size();
+
+    if constexpr (Reflected<T>) {
+        if (!obj.is_object()) {
+            errors.push_back(fmt::format("{} is not an object", path));
+            return false;
+        }
+
+        constexpr auto names = refl_member_names(ylt::reflection::identity<T>{});
+        auto members = ylt::reflection::object_to_tuple(value);
+        auto bindMember = [&](std::string_view name, auto& member) {
+            using Member = std::remove_cvref_t<decltype(member)>;
+            auto it = obj.find(std::string(name));
+            if (it == obj.end()) {
+                if constexpr (!IsOptional<Member>::value) {
+                    errors.push_back(fmt::format("{} is missing", itemPath(path, name)));
+                }
+                return;
+            }
+            if constexpr (IsOptional<Member>::value) {
+                member.emplace();
+                if (!bindJson(*it, *member, errors, itemPath(path, name))) {
+                    member.reset();
+                }
+            } else {
+                bindJson(*it, member, errors, itemPath(path, name));
+            }
+        };
+        [&]<size_t... I>(std::index_sequence<I...>) {
+            (bindMember(names[I], std::get<I>(members)), ...);
+        }(std::make_index_sequence<names.size()>{});
+    } else {
+        try {
+            obj.get_to(value);
+        }
+        catch (std::exception &) {
+            errors.push_back(fmt::format("{} has wrong type {}", path, obj.type_name()));
+        }
+    }
+
+    return errors.size() == errorNum;
+}
+
+}  // namespace jsonbind
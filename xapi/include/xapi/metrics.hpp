@@ -0,0 +1,170 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#pragma once
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <span>
+#include <string>
+#include <string_view>
+
+namespace metrics
+{
+
+// a thread updates only its shard, shards are summed when scraped
+constexpr int32_t k_shardNum = 8;
+constexpr int32_t k_maxBuckets = 16;
+
+// latency buckets in us, exported in seconds
+constexpr std::array<int64_t, 14> k_latencyBoundsUs = {10, 25, 50, 100, 250, 500, 1000, 2500, 5000,
+                                                       10000, 25000, 100000, 500000, 2000000};
+
+// shard of calling thread, threads are assigned round robin on first use
+int32_t shardIndex();
+
+/**
+ * @brief one time series of the prometheus exposition
+ *  a metric adds itself to the process registry at the end of the constructor
+ *  of its final class and leaves it at the start of its destructor, so a
+ *  scrape never sees a half built series. the registry lock is only taken then and when scraped,
+ *  updates are relaxed atomics on the shard of the calling thread and never
+ *  allocate. series of one name with different labels form one family.
+ */
+class Metric
+{
+public:
+    enum class Type {
+        counter,
+        gauge,
+        histogram
+    };
+
+    // labels are the text between the braces, name="value",...
+    Metric(std::string name, std::string help, std::string labels, Type type);
+    virtual ~Metric();
+
+    Metric(const Metric&) = delete;
+    Metric& operator=(const Metric&) = delete;
+
+    const std::string& getName() const { return m_name; }
+    const std::string& getHelp() const { return m_help; }
+    const std::string& getLabels() const { return m_labels; }
+    Type getType() const { return m_type; }
+
+    // sample lines of this series
+    virtual void render(std::string& out) const = 0;
+
+protected:
+    // called by the final class once it is fully built and before it is torn down
+    void enroll();
+    void leave();
+
+private:
+    std::string m_name;
+    std::string m_help;
+    std::string m_labels;
+    Type        m_type;
+};
+
+class Counter final : public Metric
+{
+public:
+    Counter(std::string name, std::string help, std::string labels = {});
+    ~Counter() override { leave(); }
+
+    void inc(uint64_t value = 1)
+    {
+        m_shards[shardIndex()].value.fetch_add(value, std::memory_order_relaxed);
+    }
+    uint64_t getValue() const;
+    void render(std::string& out) const override;
+
+private:
+    struct alignas(64) Shard
+    {
+        std::atomic<uint64_t> value {0};
+    };
+    std::array<Shard, k_shardNum> m_shards;
+};
+
+// a level of one owner, not sharded
+class Gauge final : public Metric
+{
+public:
+    Gauge(std::string name, std::string help, std::string labels = {});
+    ~Gauge() override { leave(); }
+
+    void set(int64_t value) { m_value.store(value, std::memory_order_relaxed); }
+    void add(int64_t value) { m_value.fetch_add(value, std::memory_order_relaxed); }
+    int64_t getValue() const { return m_value.load(std::memory_order_relaxed); }
+    void render(std::string& out) const override;
+
+private:
+    std::atomic<int64_t> m_value {0};
+};
+
+/**
+ * @brief distribution over fixed bucket bounds
+ *  observations are integers, e.g. us, bounds and sum are divided by perUnit
+ *  when exported, 1e6 for us as seconds. a value above the last bound only
+ *  counts in +Inf.
+ */
+class Histogram final : public Metric
+{
+public:
+    Histogram(std::string name, std::string help, std::span<const int64_t> bounds, double perUnit = 1.0,
+              std::string labels = {});
+    ~Histogram() override { leave(); }
+
+    void observe(int64_t value);
+    void render(std::string& out) const override;
+
+private:
+    struct alignas(64) Shard
+    {
+        std::array<std::atomic<uint64_t>, k_maxBuckets + 1> buckets {};
+        std::atomic<int64_t>                                sum {0};
+    };
+
+    std::array<int64_t, k_maxBuckets> m_bounds {};
+    int32_t                           m_boundNum;
+    double                            m_perUnit;
+    std::array<Shard, k_shardNum>     m_shards;
+};
+
+// us from construction to destruction into a histogram
+class ScopedTimer
+{
+public:
+    explicit ScopedTimer(Histogram& histogram) :
+        m_histogram{histogram},
+        m_start{std::chrono::steady_clock::now()}
+    {
+    }
+    ~ScopedTimer()
+    {
+        m_histogram.observe(std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - m_start).count());
+    }
+
+private:
+    Histogram&                            m_histogram;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+// text exposition 0.0.4 of all metrics of this process appended to out
+void render(std::string& out);
+
+// exposition of one process, label is added to each of its samples
+struct Exposition
+{
+    std::string_view text;
+    std::string_view label;
+};
+
+// expositions of several processes as one: a family keeps one HELP and TYPE
+// and all its samples together, as scrapers require
+void merge(std::span<const Exposition> parts, std::string& out);
+
+}  // namespace metrics
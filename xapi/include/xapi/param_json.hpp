@@ -7,7 +7,8 @@
 #include <nlohmann/json.hpp>
 #include <xapi/easylog.hpp>
 
-using Json = nlohmann::json;
+// keep key order of file, saveFile writes items back in place
+using Json = nlohmann::ordered_json;
 
 class ParamJson
 {
@@ -25,25 +26,14 @@ public:
      */
     [[nodiscard]] bool getJsonParam(std::string item, auto& param)
     {
-        std::vector<std::string> name;
-        int32_t count = splitStr(item, '.', name);
-        if ((count <= 0) || (m_jsonState == false))
-            return false;
-
-        Json obj;
-        try {
-            obj = m_jsonObj.at(name[0]);
-            for (int32_t i = 1; i < count; i++) {
-                obj = obj.at(name[i]);
-            }
-        }
-        catch (std::exception &) {
+        const Json* obj = findJsonItem(item);
+        if (obj == nullptr) {
             apilog::warn("no json item for {}", item);
             return false;
         }
 
         try {
-            obj.get_to(param);
+            obj->get_to(param);
         }
         catch (std::exception &) {
             apilog::warn("json param or output type error for {}", item);
@@ -53,9 +43,61 @@ public:
         return true;
     }
 
+    /**
+     * @brief check file is opened and parsed
+     *
+     * @return true: json loaded, false: file missing or not valid json
+     */
+    bool isLoaded() const { return m_jsonState; }
+
+    /**
+     * @brief find json item in place, without copy of sub objects
+     *
+     * @param item: json item name with comma seperated, chip.gpu_param.device_id
+     * @return item in loaded json, nullptr when not exist
+     */
+    const Json* findJsonItem(const std::string& item);
+
+    /**
+     * @brief set parameters of json item, missing objects on the path are created
+     *
+     * @param item: json item name with comma seperated, chip.gpu_param.device_id
+     * @param param: input value, vector or basic type.
+     * @return true: success to set parameters
+     *         false: no json loaded or a non-object item on the path.
+     */
+    [[nodiscard]] bool setJsonParam(std::string item, const auto& param)
+    {
+        std::vector<std::string> name;
+        int32_t count = splitStr(item, '.', name);
+        if ((count <= 0) || (m_jsonState == false))
+            return false;
+
+        Json* obj = &m_jsonObj;
+        for (int32_t i = 0; i < count; i++) {
+            if (!obj->is_object()) {
+                apilog::warn("json item {} is not object for {}", name[i], item);
+                return false;
+            }
+            obj = &(*obj)[name[i]];
+        }
+        *obj = param;
+        return true;
+    }
+
+    /**
+     * @brief write json to file atomically: temp file, fsync, rename.
+     *  arrays of numbers stay in one line as in hand written files.
+     *
+     * @param fileName: output file, empty to write the loaded file.
+     * @return true: success to write file
+     */
+    bool saveFile(std::string fileName = "");
+
 private:
     int32_t splitStr(std::string strSrc, char splitChar, std::vector<std::string>& output);
 
+    std::string m_fileName;
     Json m_jsonObj;
     bool m_jsonState {false};
 };
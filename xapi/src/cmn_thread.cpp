@@ -1,6 +1,10 @@
 // SPDX-License-Identifier: GPL-2.0
 #include <iostream>
+#include <cstring>
 #include <pthread.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
 #include <xapi/easylog.hpp>
 #include <xapi/cmn_thread.hpp>
 
@@ -117,3 +121,106 @@ int32_t cmn::CmnThread::getCpuAffinity(cpu_set_t *cpuset)
 
     return ret;
 }
+
+int32_t cmn::CmnThread::setSchedPolicy(int32_t policy, int32_t priority)
+{
+    struct sched_param param {};
+    int32_t maxPrio = sched_get_priority_max(policy);
+    int32_t minPrio = sched_get_priority_min(policy);
+    if (priority > maxPrio) {
+        priority = maxPrio;
+    } else if (priority < minPrio) {
+        priority = minPrio;
+    }
+
+    param.sched_priority = priority;
+    int32_t ret = pthread_setschedparam(m_threadId, policy, &param);
+    if (ret) {
+        apilog::warn("fail to set policy {} priority {}: {}", policy, priority, ret);
+        return -1;
+    }
+
+    m_priority = priority;
+    return 0;
+}
+
+int32_t cmn::CmnThread::setSelfDeadline(uint64_t runtimeUs, uint64_t deadlineUs, uint64_t periodUs)
+{
+    // glibc has no wrapper for sched_setattr
+    struct {
+        uint32_t size;
+        uint32_t sched_policy;
+        uint64_t sched_flags;
+        int32_t  sched_nice;
+        uint32_t sched_priority;
+        uint64_t sched_runtime;
+        uint64_t sched_deadline;
+        uint64_t sched_period;
+    } attr {};
+    constexpr uint32_t schedDeadline = 6;
+
+    attr.size = sizeof(attr);
+    attr.sched_policy = schedDeadline;
+    attr.sched_runtime = runtimeUs * 1000;
+    attr.sched_deadline = deadlineUs * 1000;
+    attr.sched_period = periodUs * 1000;
+    if (syscall(SYS_sched_setattr, 0, &attr, 0) < 0) {
+        apilog::warn("fail to set SCHED_DEADLINE: {}", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+int32_t cmn::CmnThread::setSelfAffinity(int32_t cpu)
+{
+    cpu_set_t cpuset;
+
+    CPU_ZERO(&cpuset);
+    CPU_SET(cpu % std::thread::hardware_concurrency(), &cpuset);
+    int32_t ret = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+    if (ret)
+        apilog::warn("setSelfAffinity {} failed", cpu);
+
+    return ret;
+}
+
+int32_t cmn::CmnThread::excludeSelfCpu(int32_t cpu)
+{
+    // threads created later by the caller inherit this mask
+    cpu_set_t cpuset;
+    int32_t ret = pthread_getaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+    if (ret) {
+        apilog::warn("excludeSelfCpu: get affinity failed");
+        return ret;
+    }
+
+    CPU_CLR(cpu % std::thread::hardware_concurrency(), &cpuset);
+    if (CPU_COUNT(&cpuset) == 0) {
+        apilog::warn("excludeSelfCpu: no cpu left without {}", cpu);
+        return -1;
+    }
+
+    ret = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &cpuset);
+    if (ret)
+        apilog::warn("excludeSelfCpu {} failed", cpu);
+
+    return ret;
+}
+
+int32_t cmn::CmnThread::lockMemory()
+{
+    if (mlockall(MCL_CURRENT | MCL_FUTURE) < 0) {
+        apilog::warn("mlockall failed: {}", strerror(errno));
+        return -1;
+    }
+    return 0;
+}
+
+void cmn::CmnThread::prefaultStack(size_t size)
+{
+    // touch stack pages once, so no page fault later in the loop
+    volatile char* stack = static_cast<volatile char*>(alloca(size));
+    for (size_t i = 0; i < size; i += 4096) {
+        stack[i] = 0;
+    }
+}
@@ -0,0 +1,89 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <sys/inotify.h>
+#include <unistd.h>
+#include <cstring>
+#include <filesystem>
+#include <xapi/easylog.hpp>
+#include <xapi/iofilewatch.hpp>
+
+IoFileWatch::IoFileWatch(asio::io_context& context,
+                         std::function<void(const asio::error_code &e, void *ctxt)> changeHandler,
+                         void *ctxt) :
+    m_context(context),
+    m_stream(context),
+    m_settleTimer(context),
+    m_changeHandler(std::move(changeHandler)),
+    m_usrContext(ctxt)
+{
+}
+
+IoFileWatch::~IoFileWatch()
+{
+    stop();
+}
+
+bool IoFileWatch::start(const std::string& fileName)
+{
+    std::filesystem::path path = std::filesystem::absolute(fileName);
+    m_dirName = path.parent_path().string();
+    m_baseName = path.filename().string();
+
+    int32_t fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd < 0) {
+        apilog::warn("inotify init failed: {}", strerror(errno));
+        return false;
+    }
+
+    m_watchFd = inotify_add_watch(fd, m_dirName.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE);
+    if (m_watchFd < 0) {
+        apilog::warn("watch {} failed: {}", m_dirName, strerror(errno));
+        close(fd);
+        return false;
+    }
+
+    m_stream.assign(fd);
+    doRead();
+    return true;
+}
+
+void IoFileWatch::stop()
+{
+    asio::error_code ec;
+    m_settleTimer.cancel();
+    if (m_stream.is_open()) {
+        m_stream.close(ec);
+    }
+    m_watchFd = -1;
+}
+
+void IoFileWatch::doRead()
+{
+    m_stream.async_read_some(asio::buffer(m_buffer), [this](const asio::error_code &e, size_t len) {
+        if (e) {
+            if (e != asio::error::operation_aborted)
+                apilog::warn("watch {} read failed: {}", m_baseName, e.message());
+            return;
+        }
+
+        bool changed = false;
+        for (size_t pos = 0; pos + sizeof(struct inotify_event) <= len;) {
+            auto event = reinterpret_cast<const struct inotify_event *>(m_buffer + pos);
+            if (event->len && (m_baseName == event->name)) {
+                changed = true;
+            }
+            pos += sizeof(struct inotify_event) + event->len;
+        }
+
+        if (changed) {
+            // editors write in several steps, wait until the file settles
+            m_settleTimer.expires_from_now(std::chrono::milliseconds(k_settleTime));
+            m_settleTimer.async_wait([this](const asio::error_code &e) {
+                if (e == asio::error::operation_aborted)
+                    return;
+                m_changeHandler(e, m_usrContext);
+            });
+        }
+        doRead();
+    });
+}
@@ -0,0 +1,305 @@
+// SPDX-License-Identifier: GPL-2.0
+
+#include <xapi/metrics.hpp>
+
+#include <algorithm>
+#include <charconv>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace metrics
+{
+
+namespace
+{
+
+struct Registry
+{
+    std::mutex           mutex;
+    std::vector<Metric*> metrics;   // by name, then labels
+};
+
+Registry& getRegistry()
+{
+    static Registry registry;
+    return registry;
+}
+
+bool lessSeries(const Metric* a, const Metric* b)
+{
+    if (a->getName() != b->getName()) {
+        return a->getName() < b->getName();
+    }
+    return a->getLabels() < b->getLabels();
+}
+
+template<typename T>
+void appendNumber(std::string& out, T value)
+{
+    char text[32];
+    const auto result = std::to_chars(text, text + sizeof(text), value);
+    out.append(text, result.ptr);
+}
+
+// name_suffix{labels,extra}, no braces without any label
+void appendSeries(std::string& out, const Metric& metric, std::string_view suffix, std::string_view extra = {})
+{
+    out += metric.getName();
+    out += suffix;
+    const auto& labels = metric.getLabels();
+    if (labels.empty() && extra.empty()) {
+        out += ' ';
+        return;
+    }
+    out += '{';
+    out += labels;
+    if (!labels.empty() && !extra.empty()) {
+        out += ',';
+    }
+    out += extra;
+    out += "} ";
+}
+
+std::string_view getTypeName(Metric::Type type)
+{
+    switch (type) {
+    case Metric::Type::counter: return "counter";
+    case Metric::Type::gauge:   return "gauge";
+    default:                    return "histogram";
+    }
+}
+
+}  // namespace
+
+int32_t shardIndex()
+{
+    static std::atomic<int32_t> nextShard {0};
+    thread_local const int32_t shard = nextShard.fetch_add(1, std::memory_order_relaxed) % k_shardNum;
+    return shard;
+}
+
+Metric::Metric(std::string name, std::string help, std::string labels, Type type) :
+    m_name{std::move(name)},
+    m_help{std::move(help)},
+    m_labels{std::move(labels)},
+    m_type{type}
+{
+}
+
+Metric::~Metric() = default;
+
+void Metric::enroll()
+{
+    auto& registry = getRegistry();
+    std::lock_guard lock(registry.mutex);
+    registry.metrics.insert(std::upper_bound(registry.metrics.begin(), registry.metrics.end(), this, lessSeries),
+                            this);
+}
+
+void Metric::leave()
+{
+    auto& registry = getRegistry();
+    std::lock_guard lock(registry.mutex);
+    std::erase(registry.metrics, this);
+}
+
+Counter::Counter(std::string name, std::string help, std::string labels) :
+    Metric{std::move(name), std::move(help), std::move(labels), Type::counter}
+{
+    enroll();
+}
+
+uint64_t Counter::getValue() const
+{
+    uint64_t value = 0;
+    for (const auto& shard : m_shards) {
+        value += shard.value.load(std::memory_order_relaxed);
+    }
+    return value;
+}
+
+void Counter::render(std::string& out) const
+{
+    appendSeries(out, *this, {});
+    appendNumber(out, getValue());
+    out += '\n';
+}
+
+Gauge::Gauge(std::string name, std::string help, std::string labels) :
+    Metric{std::move(name), std::move(help), std::move(labels), Type::gauge}
+{
+    enroll();
+}
+
+void Gauge::render(std::string& out) const
+{
+    appendSeries(out, *this, {});
+    appendNumber(out, getValue());
+    out += '\n';
+}
+
+Histogram::Histogram(std::string name, std::string help, std::span<const int64_t> bounds, double perUnit,
+                     std::string labels) :
+    Metric{std::move(name), std::move(help), std::move(labels), Type::histogram},
+    m_boundNum{static_cast<int32_t>(std::min<size_t>(bounds.size(), k_maxBuckets))},
+    m_perUnit{perUnit}
+{
+    std::copy_n(bounds.begin(), m_boundNum, m_bounds.begin());
+    enroll();
+}
+
+void Histogram::observe(int64_t value)
+{
+    // a handful of bounds, linear beats a binary search
+    int32_t bucket = 0;
+    while ((bucket < m_boundNum) && (value > m_bounds[bucket])) {
+        bucket++;
+    }
+    auto& shard = m_shards[shardIndex()];
+    shard.buckets[bucket].fetch_add(1, std::memory_order_relaxed);
+    shard.sum.fetch_add(value, std::memory_order_relaxed);
+}
+
+void Histogram::render(std::string& out) const
+{
+    std::array<uint64_t, k_maxBuckets + 1> counts {};
+    int64_t sum = 0;
+    for (const auto& shard : m_shards) {
+        for (int32_t i = 0; i <= m_boundNum; i++) {
+            counts[i] += shard.buckets[i].load(std::memory_order_relaxed);
+        }
+        sum += shard.sum.load(std::memory_order_relaxed);
+    }
+
+    // le="" plus a bound or +Inf
+    char le[48] = "le=\"";
+    uint64_t cumulative = 0;
+    for (int32_t i = 0; i <= m_boundNum; i++) {
+        char* end = le + 4;
+        if (i < m_boundNum) {
+            end = std::to_chars(end, le + sizeof(le) - 2, m_bounds[i] / m_perUnit).ptr;
+        } else {
+            end = std::copy_n("+Inf", 4, end);
+        }
+        *end++ = '"';
+        cumulative += counts[i];
+        appendSeries(out, *this, "_bucket", std::string_view(le, end));
+        appendNumber(out, cumulative);
+        out += '\n';
+    }
+    appendSeries(out, *this, "_sum");
+    appendNumber(out, sum / m_perUnit);
+    out += '\n';
+    appendSeries(out, *this, "_count");
+    appendNumber(out, cumulative);
+    out += '\n';
+}
+
+void render(std::string& out)
+{
+    auto& registry = getRegistry();
+    std::lock_guard lock(registry.mutex);
+    const Metric* family = nullptr;
+    for (const auto* metric : registry.metrics) {
+        if ((family == nullptr) || (family->getName() != metric->getName())) {
+            family = metric;
+            out += "# HELP ";
+            out += metric->getName();
+            out += ' ';
+            out += metric->getHelp();
+            out += "\n# TYPE ";
+            out += metric->getName();
+            out += ' ';
+            out += getTypeName(metric->getType());
+            out += '\n';
+        }
+        metric->render(out);
+    }
+}
+
+void merge(std::span<const Exposition> parts, std::string& out)
+{
+    struct Sample
+    {
+        std::string_view line;
+        std::string_view label;
+    };
+    struct Family
+    {
+        std::string_view    name;
+        std::string_view    help;
+        std::string_view    type;
+        std::vector<Sample> samples;
+    };
+
+    // families in order of first appearance
+    std::vector<Family> families;
+    auto findFamily = [&](std::string_view name) -> Family& {
+        auto it = std::find_if(families.begin(), families.end(), [&](const Family& f) { return f.name == name; });
+        if (it != families.end()) {
+            return *it;
+        }
+        return families.emplace_back(Family{name, {}, {}, {}});
+    };
+    auto commentName = [](std::string_view line) {
+        line.remove_prefix(7);
+        return line.substr(0, line.find(' '));
+    };
+
+    for (const auto& part : parts) {
+        Family* family = nullptr;
+        std::string_view text = part.text;
+        while (!text.empty()) {
+            const auto end = text.find('\n');
+            const auto line = text.substr(0, end);
+            text.remove_prefix((end == std::string_view::npos) ? text.size() : end + 1);
+
+            if (line.starts_with("# HELP ")) {
+                family = &findFamily(commentName(line));
+                if (family->help.empty()) {
+                    family->help = line;
+                }
+            } else if (line.starts_with("# TYPE ")) {
+                family = &findFamily(commentName(line));
+                if (family->type.empty()) {
+                    family->type = line;
+                }
+            } else if (!line.empty() && (line[0] != '#')) {
+                if (family == nullptr) {
+                    family = &findFamily(line.substr(0, line.find_first_of("{ ")));
+                }
+                family->samples.push_back({line, part.label});
+            }
+        }
+    }
+
+    for (const auto& family : families) {
+        for (const auto comment : {family.help, family.type}) {
+            if (!comment.empty()) {
+                out += comment;
+                out += '\n';
+            }
+        }
+        for (const auto& sample : family.samples) {
+            const auto split = sample.line.find_first_of("{ ");
+            if (sample.label.empty() || (split == std::string_view::npos)) {
+                out += sample.line;
+            } else if (sample.line[split] == '{') {
+                out += sample.line.substr(0, split + 1);
+                out += sample.label;
+                out += ',';
+                out += sample.line.substr(split + 1);
+            } else {
+                out += sample.line.substr(0, split);
+                out += '{';
+                out += sample.label;
+                out += '}';
+                out += sample.line.substr(split);
+            }
+            out += '\n';
+        }
+    }
+}
+
+}  // namespace metrics
@@ -2,8 +2,55 @@
 
 #include <xapi/param_json.hpp>
 #include <fstream>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstring>
 
-ParamJson::ParamJson(std::string fileName)
+namespace {
+
+void dumpJson(const Json& obj, int32_t indent, std::string& out)
+{
+    const std::string pad(indent + 4, ' ');
+    auto isScalar = [](const Json& item) { return !item.is_object() && !item.is_array(); };
+
+    if (obj.is_object() && !obj.empty()) {
+        out += "{\n";
+        size_t i = 0;
+        for (const auto& [key, value] : obj.items()) {
+            out += pad + Json(key).dump() + ": ";
+            dumpJson(value, indent + 4, out);
+            out += (++i < obj.size()) ? ",\n" : "\n";
+        }
+        out += std::string(indent, ' ') + "}";
+    } else if (obj.is_array() && !std::all_of(obj.begin(), obj.end(), isScalar)) {
+        out += "[\n";
+        for (size_t i = 0; i < obj.size(); i++) {
+            out += pad;
+            dumpJson(obj[i], indent + 4, out);
+            out += (i + 1 < obj.size()) ? ",\n" : "\n";
+        }
+        out += std::string(indent, ' ') + "]";
+    } else {
+        std::string line = obj.dump();
+        if (obj.is_array()) {
+            // [1,2,3] -> [1, 2, 3]
+            std::string spaced;
+            for (char c : line) {
+                spaced += c;
+                if (c == ',')
+                    spaced += ' ';
+            }
+            line = std::move(spaced);
+        }
+        out += line;
+    }
+}
+
+}  // namespace
+
+ParamJson::ParamJson(std::string fileName) :
+    m_fileName(fileName)
 {
     std::ifstream jsonFile(fileName);
     if (!jsonFile.is_open()) {
@@ -11,7 +58,8 @@ ParamJson::ParamJson(std::string fileName)
         return;
     }
 
-    jsonFile >> m_jsonObj;
+    // no exceptions: a half written file is reported, not thrown into the caller
+    m_jsonObj = Json::parse(jsonFile, nullptr, false);
     if (m_jsonObj.is_discarded()) {
         apilog::warn("parse {} data failed...", fileName);
         return;
@@ -20,6 +68,25 @@ ParamJson::ParamJson(std::string fileName)
     m_jsonState = true;
 }
 
+const Json* ParamJson::findJsonItem(const std::string& item)
+{
+    std::vector<std::string> name;
+    int32_t count = splitStr(item, '.', name);
+    if ((count <= 0) || (m_jsonState == false))
+        return nullptr;
+
+    const Json* obj = &m_jsonObj;
+    for (int32_t i = 0; i < count; i++) {
+        if (!obj->is_object())
+            return nullptr;
+        auto it = obj->find(name[i]);
+        if (it == obj->end())
+            return nullptr;
+        obj = &(*it);
+    }
+    return obj;
+}
+
 int32_t ParamJson::splitStr(std::string strSrc, char splitChar, std::vector<std::string>& output)
 {
     if (strSrc.empty() || !splitChar)
@@ -44,3 +111,36 @@ int32_t ParamJson::splitStr(std::string strSrc, char splitChar, std::vector<std:
 
     return static_cast<int32_t>(output.size());
 }
+
+bool ParamJson::saveFile(std::string fileName)
+{
+    if (fileName.empty())
+        fileName = m_fileName;
+    if (!m_jsonState || fileName.empty()) {
+        apilog::warn("no json to save to {}", fileName);
+        return false;
+    }
+
+    std::string content;
+    dumpJson(m_jsonObj, 0, content);
+    content += "\n";
+
+    // temp file in same directory, rename is atomic on one file system
+    std::string tmpName = fileName + ".tmp";
+    int32_t fd = open(tmpName.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        apilog::warn("open {} failed: {}", tmpName, strerror(errno));
+        return false;
+    }
+
+    bool ret = (write(fd, content.data(), content.size()) == (ssize_t)content.size())
+               && (fsync(fd) == 0);
+    close(fd);
+    if (!ret || (rename(tmpName.c_str(), fileName.c_str()) < 0)) {
+        apilog::warn("write {} failed: {}", fileName, strerror(errno));
+        unlink(tmpName.c_str());
+        return false;
+    }
+
+    return true;
+}